@@ -351,6 +351,8 @@ bool ASObject::has_toJSON()
 	return ASObject::hasPropertyByMultiname(toJSONName, true, true);
 }
 
+static void appendJSONString(std::string& out, const tiny_string& str);
+
 tiny_string ASObject::call_toJSON()
 {
 	multiname toJSONName(NULL);
@@ -367,16 +369,12 @@ tiny_string ASObject::call_toJSON()
 
 	incRef();
 	ASObject *ret=f->call(this,NULL,0);
-	tiny_string res;
+	std::string res;
 	if (ret->is<ASString>())
-	{
-		res += "\"";
-		res += ret->toString();
-		res += "\"";
-	}
-	else 
+		appendJSONString(res,ret->toString());
+	else
 		res = ret->toString();
-	
+	ret->decRef();
 	return res;
 }
 
@@ -659,6 +657,12 @@ void ASObject::setVariableByQName(uint32_t nameId, const nsNameAndKind& ns, ASOb
 	obj->setVar(o);
 }
 
+void ASObject::setDynamicVariableNoCheck(uint32_t nameId, ASObject* o)
+{
+	variable* obj=Variables.findObjVar(nameId,nsNameAndKind(BUILTIN_NAMESPACES::EMPTY_NS),DYNAMIC_TRAIT,DYNAMIC_TRAIT);
+	obj->setVar(o);
+}
+
 void ASObject::initializeVariableByMultiname(const multiname& name, ASObject* o, multiname* typemname,
 		ABCContext* context, TRAIT_KIND traitKind)
 {
@@ -1360,16 +1364,16 @@ void ASObject::constructionComplete()
 {
 }
 
-void ASObject::serializeDynamicProperties(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t> traitsMap) const
+void ASObject::serializeDynamicProperties(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap) const
 {
 	Variables.serialize(out, stringMap, objMap, traitsMap);
 }
 
-void variables_map::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap) const
+void variables_map::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap) const
 {
 	//Pairs of name, value
 	auto it=Variables.begin();
@@ -1386,9 +1390,26 @@ void variables_map::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& s
 	out->writeStringVR(stringMap, "");
 }
 
-void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+/*
+ * Returns the alias registered for the class with registerClassAlias,
+ * or the empty string
+ */
+static tiny_string findClassAlias(const Class_base* type)
+{
+	//Linear search for alias
+	auto aliasIt=getSys()->aliasMap.begin();
+	const auto aliasEnd=getSys()->aliasMap.end();
+	for(;aliasIt!=aliasEnd;++aliasIt)
+	{
+		if(aliasIt->second.getPtr()==type)
+			return aliasIt->first;
+	}
+	return "";
+}
+
+void ASObject::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	//0x0A -> object marker
 	out->writeByte(object_marker);
@@ -1404,28 +1425,23 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 	Class_base* type=getClass();
 	assert_and_throw(type);
 
-	//Check if an alias is registered
-	auto aliasIt=getSys()->aliasMap.begin();
-	const auto aliasEnd=getSys()->aliasMap.end();
-	//Linear search for alias
-	tiny_string alias;
-	for(;aliasIt!=aliasEnd;++aliasIt)
-	{
-		if(aliasIt->second==type)
-		{
-			alias=aliasIt->first;
-			break;
-		}
-	}
-	bool serializeTraits = alias.empty()==false;
-
 	if(type->isSubClass(InterfaceClass<IExternalizable>::getClass()))
 	{
 		//Custom serialization necessary
-		if(!serializeTraits)
-			throwError<TypeError>(kInvalidParamError);
-		out->writeU29(0x7);
-		out->writeStringVR(stringMap, alias);
+		//The object and its traits take an entry in the reference tables like any other
+		objMap.insert(make_pair(this, objMap.size()));
+		auto it2=traitsMap.find(type);
+		if(it2!=traitsMap.end())
+			out->writeU29((it2->second << 2) | 1);
+		else
+		{
+			const tiny_string alias=findClassAlias(type);
+			if(alias.empty())
+				throwError<TypeError>(kInvalidParamError);
+			traitsMap.insert(make_pair(type, traitsMap.size()));
+			out->writeU29(0x7);
+			out->writeStringVR(stringMap, alias);
+		}
 
 		//Invoke writeExternal
 		multiname writeExternalName(NULL);
@@ -1440,7 +1456,7 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 		this->incRef();
 		out->incRef();
 		ASObject* const tmpArg[1] = {out};
-		f->call(this, tmpArg, 1);
+		f->call(this, tmpArg, 1)->decRef();
 		return;
 	}
 
@@ -1471,7 +1487,8 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 		}
 		uint32_t dynamicFlag=(type->isSealed)?0:(1 << 3);
 		out->writeU29((traitsCount << 4) | dynamicFlag | 0x03);
-		out->writeStringVR(stringMap, alias);
+		//The alias is only needed the first time the traits are sent
+		out->writeStringVR(stringMap, findClassAlias(type));
 		for(variables_map::const_var_iterator varIt=beginIt; varIt != endIt; ++varIt)
 		{
 			if(varIt->second.kind==DECLARED_TRAIT)
@@ -1528,129 +1545,156 @@ ASObject *ASObject::describeType() const
 	return Class<XML>::getInstanceS(root);
 }
 
-tiny_string ASObject::toJSON(std::vector<ASObject *> &path, IFunction *replacer, const tiny_string &spaces,const tiny_string& filter)
+/*
+ * Appends the quoted and escaped representation of str to out.
+ * Runs of bytes that don't need escaping are copied at once
+ */
+static void appendJSONString(std::string& out, const tiny_string& str)
+{
+	const char* buf=str.raw_buf();
+	const char* const bufEnd=buf+str.numBytes();
+	out+='"';
+	const char* runStart=buf;
+	while(buf<bufEnd)
+	{
+		unsigned char c=*buf;
+		if(c>=0x20 && c<0x80 && c!='"' && c!='\\')
+		{
+			buf++;
+			continue;
+		}
+		uint32_t ch=g_utf8_get_char(buf);
+		//Characters in the range 0x80-0xff are kept as they are
+		if(ch>=0x80 && ch<=0xff)
+		{
+			buf=g_utf8_next_char(buf);
+			continue;
+		}
+		out.append(runStart,buf-runStart);
+		switch (ch)
+		{
+			case '\b':
+				out+="\\b";
+				break;
+			case '\f':
+				out+="\\f";
+				break;
+			case '\n':
+				out+="\\n";
+				break;
+			case '\r':
+				out+="\\r";
+				break;
+			case '\t':
+				out+="\\t";
+				break;
+			case '\"':
+				out+="\\\"";
+				break;
+			case '\\':
+				out+="\\\\";
+				break;
+			default:
+			{
+				char hexstr[16];
+				//Characters outside the BMP are written as a surrogate pair
+				if(ch>0xffff)
+					sprintf(hexstr,"\\u%04x\\u%04x",0xd800+((ch-0x10000)>>10),0xdc00+((ch-0x10000)&0x3ff));
+				else
+					sprintf(hexstr,"\\u%04x",ch);
+				out+=hexstr;
+				break;
+			}
+		}
+		buf=g_utf8_next_char(buf);
+		runStart=buf;
+	}
+	out.append(runStart,bufEnd-runStart);
+	out+='"';
+}
+
+void ASObject::toJSON(std::string& out, std::vector<ASObject *> &path, IFunction *replacer, const tiny_string &spaces,const tiny_string& filter)
 {
 	if (has_toJSON())
 	{
-		return call_toJSON();
+		const tiny_string res=call_toJSON();
+		out.append(res.raw_buf(),res.numBytes());
+		return;
 	}
 
-	tiny_string newline = (spaces.empty() ? "" : "\n");
-	tiny_string res;
 	if (this->isPrimitive())
 	{
 		switch(this->type)
 		{
 			case T_STRING:
-			{
-				res += "\"";
-				tiny_string sub = this->toString();
-				for (CharIterator it=sub.begin(); it!=sub.end(); it++)
-				{
-					switch (*it)
-					{
-						case '\b':
-							res += "\\b";
-							break;
-						case '\f':
-							res += "\\f";
-							break;
-						case '\n':
-							res += "\\n";
-							break;
-						case '\r':
-							res += "\\r";
-							break;
-						case '\t':
-							res += "\\t";
-							break;
-						case '\"':
-							res += "\\\"";
-							break;
-						case '\\':
-							res += "\\\\";
-							break;
-						default:
-							if (*it < 0x20 || *it > 0xff)
-							{
-								char hexstr[7];
-								sprintf(hexstr,"\\u%04x",*it);
-								res += hexstr;
-							}
-							else
-								res += *it;
-							break;
-					}
-				}
-				res += "\"";
+				appendJSONString(out,this->toString());
 				break;
-			}
 			case T_UNDEFINED:
-				res += "null";
+				out += "null";
 				break;
 			default:
-				res += this->toString();
+			{
+				const tiny_string res=this->toString();
+				out.append(res.raw_buf(),res.numBytes());
 				break;
+			}
 		}
 	}
 	else
 	{
-		res += "{";
+		// check for cylic reference
+		if (std::find(path.begin(),path.end(), this) != path.end())
+			throwError<TypeError>(kJSONCyclicStructure);
+		path.push_back(this);
+		const char* newline = (spaces.empty() ? "" : "\n");
+		const tiny_string innerSpaces = spaces+spaces;
+		out += '{';
 		const variables_map::const_var_iterator beginIt = Variables.Variables.begin();
 		const variables_map::const_var_iterator endIt = Variables.Variables.end();
 		bool bfirst = true;
 		for(variables_map::const_var_iterator varIt=beginIt; varIt != endIt; ++varIt)
 		{
-			// check for cylic reference
-			if (std::find(path.begin(),path.end(), varIt->second.var) != path.end())
-				throwError<TypeError>(kJSONCyclicStructure);
-
-			if (replacer != NULL)
+			const tiny_string& name=getSys()->getStringFromUniqueId(varIt->first.nameId);
+			if (replacer != NULL || filter.empty() || filter.find(tiny_string(" ")+name+" ") != tiny_string::npos)
 			{
-				if (!bfirst)
-					res += ",";
-				res += newline+spaces;
-				res += "\"";
-				res += getSys()->getStringFromUniqueId(varIt->first.nameId);
-				res += "\"";
-				res += ":";
-				if (!spaces.empty())
-					res += " ";
-				ASObject* params[2];
-				
-				params[0] = Class<ASString>::getInstanceS(getSys()->getStringFromUniqueId(varIt->first.nameId));
-				params[1] = varIt->second.var;
-				params[1]->incRef();
-				ASObject *funcret=replacer->call(getSys()->getNullRef(), params, 2);
-				LOG(LOG_ERROR,"funcall:"<<res<<"|"<<funcret);
-				if (funcret)
-					res += funcret->toString();
+				_NR<ASObject> value;
+				if (replacer != NULL)
+				{
+					ASObject* params[2];
+					params[0] = Class<ASString>::getInstanceS(name);
+					params[1] = varIt->second.var;
+					params[1]->incRef();
+					value=_MNR(replacer->call(getSys()->getNullRef(), params, 2));
+					//Members replaced by undefined are left out
+					if (value.isNull() || value->is<Undefined>())
+						continue;
+				}
 				else
-					res += varIt->second.var->toJSON(path,replacer,spaces+spaces,filter);
-				bfirst = false;
-			}
-			else if (filter.empty() || filter.find(tiny_string(" ")+getSys()->getStringFromUniqueId(varIt->first.nameId)+" ") != tiny_string::npos)
-			{
+				{
+					varIt->second.var->incRef();
+					value=_MR(varIt->second.var);
+				}
 				if (!bfirst)
-					res += ",";
-				res += newline+spaces;
-				res += "\"";
-				res += getSys()->getStringFromUniqueId(varIt->first.nameId);
-				res += "\"";
-				res += ":";
+					out += ',';
+				out += newline;
+				out += spaces.raw_buf();
+				appendJSONString(out,name);
+				out += ':';
 				if (!spaces.empty())
-					res += " ";
-				res += varIt->second.var->toJSON(path,replacer,spaces+spaces,filter);
+					out += ' ';
+				value->toJSON(out,path,replacer,innerSpaces,filter);
 				bfirst = false;
 			}
-			path.push_back(varIt->second.var);
 		}
 		if (!bfirst)
-			res += newline+spaces.substr_bytes(0,spaces.numBytes()/2);
+		{
+			out += newline;
+			out.append(spaces.raw_buf(),spaces.numBytes()/2);
+		}
 
-		res += "}";
+		out += '}';
+		path.pop_back();
 	}
-	return res;
 }
 
 bool ASObject::hasprop_prototype()
@@ -26,11 +26,16 @@
 #include "threading.h"
 #include "memory_support.h"
 #include <map>
+#include <unordered_map>
 #include <boost/intrusive/list.hpp>
 
 #define ASFUNCTION(name) \
 	static ASObject* name(ASObject* , ASObject* const* args, const unsigned int argslen)
 
+/* declare the typed entry point of an AS function, see NATIVE_BINDING in argconv.h */
+#define ASNATIVEFUNCTION(ret,name,...) \
+	static ret name##_native(ASObject* , ##__VA_ARGS__)
+
 /* declare setter/getter and associated member variable */
 #define ASPROPERTY_GETTER(type,name) \
 	type name; \
@@ -60,6 +65,10 @@
 #define ASFUNCTIONBODY(c,name) \
 	ASObject* c::name(ASObject* obj, ASObject* const* args, const unsigned int argslen)
 
+/* body for a typed entry point declared by ASNATIVEFUNCTION */
+#define ASNATIVEFUNCTIONBODY(ret,c,name,...) \
+	ret c::name##_native(ASObject* obj, ##__VA_ARGS__)
+
 /* full body for a getter declared by ASPROPERTY_GETTER or ASFUNCTION_GETTER */
 #define ASFUNCTIONBODY_GETTER(c,name) \
 	ASObject* c::_getter_##name(ASObject* obj, ASObject* const* args, const unsigned int argslen) \
@@ -249,9 +258,9 @@ public:
 	int getNextEnumerable(unsigned int i) const;
 	~variables_map();
 	void check() const;
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap) const;
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap) const;
 	void dumpVariables();
 	void destroyContents();
 };
@@ -278,9 +287,9 @@ protected:
 	virtual ~ASObject();
 	SWFOBJECT_TYPE type;
 	bool traitsInitialized:1;
-	void serializeDynamicProperties(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t> traitsMap) const;
+	void serializeDynamicProperties(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap) const;
 	void setClass(Class_base* c);
 	static variable* findSettableImpl(variables_map& map, const multiname& name, bool* has_getter);
 	static const variable* findGettableImpl(const variables_map& map, const multiname& name);
@@ -380,20 +389,26 @@ public:
 	void setVariableByQName(const tiny_string& name, const tiny_string& ns, ASObject* o, TRAIT_KIND traitKind);
 	void setVariableByQName(const tiny_string& name, const nsNameAndKind& ns, ASObject* o, TRAIT_KIND traitKind);
 	void setVariableByQName(uint32_t nameId, const nsNameAndKind& ns, ASObject* o, TRAIT_KIND traitKind);
+	/*
+	 * Sets a dynamic variable in the public namespace without looking for setters
+	 * or declared traits. Only to be used on plain Objects, e.g. the ones built by JSON.parse
+	 */
+	void setDynamicVariableNoCheck(uint32_t nameId, ASObject* o);
 	//NOTE: the isBorrowed flag is used to distinguish methods/setters/getters that are inside a class but on behalf of the instances
 	void setDeclaredMethodByQName(const tiny_string& name, const tiny_string& ns, IFunction* o, METHOD_TYPE type, bool isBorrowed);
 	void setDeclaredMethodByQName(const tiny_string& name, const nsNameAndKind& ns, IFunction* o, METHOD_TYPE type, bool isBorrowed);
 	void setDeclaredMethodByQName(uint32_t nameId, const nsNameAndKind& ns, IFunction* o, METHOD_TYPE type, bool isBorrowed);
 	virtual bool hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype);
-	ASObject* getSlot(unsigned int n)
+	//Activation and catch scopes keep their slots outside of Variables, see ActivationScope
+	virtual ASObject* getSlot(unsigned int n)
 	{
 		return Variables.getSlot(n);
 	}
-	void setSlot(unsigned int n,ASObject* o)
+	virtual void setSlot(unsigned int n,ASObject* o)
 	{
 		Variables.setSlot(n,o);
 	}
-	void setSlotNoCoerce(unsigned int n,ASObject* o)
+	virtual void setSlotNoCoerce(unsigned int n,ASObject* o)
 	{
 		Variables.setSlotNoCoerce(n,o);
 	}
@@ -461,13 +476,14 @@ public:
 
 	  The various maps are used to implement reference type of the AMF3 spec
 	*/
-	virtual void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	virtual void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 
 	virtual ASObject *describeType() const;
 
-	virtual tiny_string toJSON(std::vector<ASObject *> &path, IFunction *replacer, const tiny_string &spaces,const tiny_string& filter);
+	/* Appends the JSON representation of the object to out */
+	virtual void toJSON(std::string& out, std::vector<ASObject *> &path, IFunction *replacer, const tiny_string &spaces,const tiny_string& filter);
 	/* returns true if the current object is of type T */
 	template<class T> bool is() const { return dynamic_cast<const T*>(this); }
 	/* returns this object casted to the given type.
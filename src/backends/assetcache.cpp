@@ -0,0 +1,671 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <zlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include "backends/assetcache.h"
+#include "backends/config.h"
+#include "backends/geometry.h"
+#include "scripting/flash/display/BitmapContainer.h"
+#include "parsing/tags.h"
+#include "swf.h"
+#include "threading.h"
+#include "exceptions.h"
+#include "logger.h"
+
+using namespace std;
+using namespace lightspark;
+
+namespace
+{
+
+struct BundleHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t reserved;
+	//The index is written after the entries
+	uint64_t indexOffset;
+};
+
+struct IndexEntry
+{
+	uint32_t key;
+	uint32_t reserved;
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct BitmapHeader
+{
+	int32_t width;
+	int32_t height;
+	uint32_t stride;
+	uint32_t size;
+};
+
+const char BUNDLE_MAGIC[4]={'L','S','A','B'};
+
+struct CacheEntry
+{
+	string path;
+	time_t lastUsed;
+	uint64_t size;
+	bool operator<(const CacheEntry& r) const { return lastUsed<r.lastUsed; }
+};
+
+//Protects totalSize, which is the size of the cache directory and is
+//computed when the first bundle is added
+Mutex sizeMutex;
+bool sizeKnown=false;
+uint64_t totalSize=0;
+
+uint64_t listEntries(const string& dir, vector<CacheEntry>* entries)
+{
+	GDir* d=g_dir_open(dir.c_str(),0,NULL);
+	if(d==NULL)
+		return 0;
+	uint64_t total=0;
+	const gchar* name;
+	while((name=g_dir_read_name(d))!=NULL)
+	{
+		CacheEntry e;
+		e.path=dir + "/" + name;
+		struct stat st;
+		if(g_stat(e.path.c_str(),&st)!=0 || !S_ISREG(st.st_mode))
+			continue;
+		e.lastUsed=st.st_mtime;
+		e.size=st.st_size;
+		total+=e.size;
+		if(entries)
+			entries->push_back(e);
+	}
+	g_dir_close(d);
+	return total;
+}
+
+/*
+ * Tokens are stored in the byte order of the machine, the cache is
+ * never shared with other machines
+ */
+class TokenWriter
+{
+private:
+	vector<uint8_t>& buf;
+	template<class T> void put(T v)
+	{
+		const uint8_t* p=(const uint8_t*)&v;
+		buf.insert(buf.end(),p,p+sizeof(T));
+	}
+	void putColor(const RGBA& c)
+	{
+		put<uint8_t>(c.Red);
+		put<uint8_t>(c.Green);
+		put<uint8_t>(c.Blue);
+		put<uint8_t>(c.Alpha);
+	}
+	void putRecords(const vector<GRADRECORD>& records)
+	{
+		put<uint32_t>(records.size());
+		for(auto it=records.begin();it!=records.end();++it)
+		{
+			putColor(it->Color);
+			put<uint8_t>(it->version);
+			put<uint8_t>(it->Ratio);
+		}
+	}
+public:
+	TokenWriter(vector<uint8_t>& b):buf(b){}
+	void putMatrix(const MATRIX& m)
+	{
+		put<double>(m.xx);
+		put<double>(m.yx);
+		put<double>(m.xy);
+		put<double>(m.yy);
+		put<double>(m.x0);
+		put<double>(m.y0);
+	}
+	void putFillStyle(const FILLSTYLE& f)
+	{
+		put<uint8_t>(f.FillStyleType);
+		put<uint8_t>(f.version);
+		putMatrix(f.Matrix);
+		putColor(f.Color);
+		put<int32_t>(f.Gradient.SpreadMode);
+		put<int32_t>(f.Gradient.InterpolationMode);
+		put<uint8_t>(f.Gradient.version);
+		putRecords(f.Gradient.GradientRecords);
+		put<int32_t>(f.FocalGradient.version);
+		put<int32_t>(f.FocalGradient.SpreadMode);
+		put<int32_t>(f.FocalGradient.InterpolationMode);
+		put<int32_t>(f.FocalGradient.NumGradient);
+		put<float>(f.FocalGradient.FocalPoint);
+		putRecords(f.FocalGradient.GradientRecords);
+		//Bitmaps are referred to by character id
+		put<int32_t>(f.bitmapTag ? f.bitmapTag->getId() : -1);
+	}
+	void putLineStyle(const LINESTYLE2& l)
+	{
+		put<uint32_t>(l.StartCapStyle);
+		put<uint32_t>(l.JointStyle);
+		put<uint8_t>(l.HasFillFlag);
+		put<uint32_t>(l.NoHScaleFlag);
+		put<uint32_t>(l.NoVScaleFlag);
+		put<uint32_t>(l.PixelHintingFlag);
+		put<uint32_t>(l.NoClose);
+		put<uint32_t>(l.EndCapStyle);
+		put<uint16_t>(l.Width);
+		put<uint16_t>(l.MiterLimitFactor);
+		putColor(l.Color);
+		put<uint8_t>(l.version);
+		putFillStyle(l.FillType);
+	}
+	void putTokens(const vector<GeomToken>& tokens)
+	{
+		put<uint32_t>(tokens.size());
+		for(auto it=tokens.begin();it!=tokens.end();++it)
+		{
+			put<uint8_t>(it->type);
+			put<int32_t>(it->p1.x);
+			put<int32_t>(it->p1.y);
+			put<int32_t>(it->p2.x);
+			put<int32_t>(it->p2.y);
+			put<int32_t>(it->p3.x);
+			put<int32_t>(it->p3.y);
+			if(it->type==SET_FILL)
+				putFillStyle(it->fillStyle);
+			else if(it->type==SET_STROKE)
+				putLineStyle(it->lineStyle);
+			else if(it->type==FILL_TRANSFORM_TEXTURE)
+				putMatrix(it->textureTransform);
+		}
+	}
+};
+
+//Reads what TokenWriter writes, ok becomes false if the data is truncated
+class TokenReader
+{
+private:
+	const uint8_t* buf;
+	size_t len;
+	size_t pos;
+	RootMovieClip* root;
+	template<class T> T get()
+	{
+		T v=T();
+		if(len-pos<sizeof(T))
+		{
+			ok=false;
+			pos=len;
+			return v;
+		}
+		memcpy(&v,buf+pos,sizeof(T));
+		pos+=sizeof(T);
+		return v;
+	}
+	void getColor(RGBA& c)
+	{
+		c.Red=get<uint8_t>();
+		c.Green=get<uint8_t>();
+		c.Blue=get<uint8_t>();
+		c.Alpha=get<uint8_t>();
+	}
+	void getRecords(vector<GRADRECORD>& records)
+	{
+		uint32_t count=get<uint32_t>();
+		//Each record takes 6 bytes
+		if(count>(len-pos)/6)
+		{
+			ok=false;
+			return;
+		}
+		for(uint32_t i=0;i<count;i++)
+		{
+			GRADRECORD r(0);
+			getColor(r.Color);
+			r.version=get<uint8_t>();
+			r.Ratio=get<uint8_t>();
+			records.push_back(r);
+		}
+	}
+public:
+	bool ok;
+	TokenReader(const uint8_t* b, size_t l, RootMovieClip* r):buf(b),len(l),pos(0),root(r),ok(true){}
+	void getMatrix(MATRIX& m)
+	{
+		m.xx=get<double>();
+		m.yx=get<double>();
+		m.xy=get<double>();
+		m.yy=get<double>();
+		m.x0=get<double>();
+		m.y0=get<double>();
+	}
+	void getFillStyle(FILLSTYLE& f)
+	{
+		f.FillStyleType=(FILL_STYLE_TYPE)get<uint8_t>();
+		f.version=get<uint8_t>();
+		getMatrix(f.Matrix);
+		getColor(f.Color);
+		f.Gradient.SpreadMode=get<int32_t>();
+		f.Gradient.InterpolationMode=get<int32_t>();
+		f.Gradient.version=get<uint8_t>();
+		getRecords(f.Gradient.GradientRecords);
+		f.FocalGradient.version=get<int32_t>();
+		f.FocalGradient.SpreadMode=get<int32_t>();
+		f.FocalGradient.InterpolationMode=get<int32_t>();
+		f.FocalGradient.NumGradient=get<int32_t>();
+		f.FocalGradient.FocalPoint=get<float>();
+		getRecords(f.FocalGradient.GradientRecords);
+		int32_t bitmapId=get<int32_t>();
+		if(bitmapId<0 || !ok)
+			return;
+		try
+		{
+			const BitmapTag* b=dynamic_cast<const BitmapTag*>(root->dictionaryLookup(bitmapId));
+			if(b==NULL)
+			{
+				ok=false;
+				return;
+			}
+			//The caller waits for the decoding as for parsed fills
+			f.bitmap=b->getBitmapNoWait();
+			f.bitmapTag=b;
+		}
+		catch(RunTimeException& e)
+		{
+			ok=false;
+		}
+	}
+	void getLineStyle(LINESTYLE2& l)
+	{
+		l.StartCapStyle=UB(get<uint32_t>());
+		l.JointStyle=UB(get<uint32_t>());
+		l.HasFillFlag=get<uint8_t>();
+		l.NoHScaleFlag=UB(get<uint32_t>());
+		l.NoVScaleFlag=UB(get<uint32_t>());
+		l.PixelHintingFlag=UB(get<uint32_t>());
+		l.NoClose=UB(get<uint32_t>());
+		l.EndCapStyle=UB(get<uint32_t>());
+		l.Width=get<uint16_t>();
+		l.MiterLimitFactor=get<uint16_t>();
+		getColor(l.Color);
+		l.version=get<uint8_t>();
+		getFillStyle(l.FillType);
+	}
+	void getTokens(vector<GeomToken>& tokens)
+	{
+		uint32_t count=get<uint32_t>();
+		//Each token takes at least 25 bytes
+		if(count>(len-pos)/25)
+		{
+			ok=false;
+			return;
+		}
+		tokens.reserve(count);
+		for(uint32_t i=0;i<count && ok;i++)
+		{
+			uint8_t type=get<uint8_t>();
+			if(type>FILL_TRANSFORM_TEXTURE)
+			{
+				ok=false;
+				return;
+			}
+			tokens.emplace_back((GEOM_TOKEN_TYPE)type);
+			GeomToken& t=tokens.back();
+			t.p1.x=get<int32_t>();
+			t.p1.y=get<int32_t>();
+			t.p2.x=get<int32_t>();
+			t.p2.y=get<int32_t>();
+			t.p3.x=get<int32_t>();
+			t.p3.y=get<int32_t>();
+			if(t.type==SET_FILL)
+				getFillStyle(t.fillStyle);
+			else if(t.type==SET_STROKE)
+				getLineStyle(t.lineStyle);
+			else if(t.type==FILL_TRANSFORM_TEXTURE)
+				getMatrix(t.textureTransform);
+		}
+		if(pos!=len)
+			ok=false;
+	}
+};
+
+/*
+ * Writes a new bundle with the assets of the tags. Entries the old
+ * bundle already has are copied from its mapping, the others are
+ * encoded again
+ */
+class AssetBundleWriter: public IThreadJob
+{
+private:
+	_R<AssetBundle> old;
+	_R<RootMovieClip> root;
+	vector<const DictionaryTag*> tags;
+	string path;
+	bool encodeBitmap(const BitmapTag* tag, vector<uint8_t>& buf);
+	bool encodeTokens(const DictionaryTag* tag, vector<uint8_t>& buf);
+public:
+	AssetBundleWriter(_R<AssetBundle> o, _R<RootMovieClip> r, vector<const DictionaryTag*>& t, const string& p):
+		old(o),root(r),path(p)
+	{
+		tags.swap(t);
+	}
+	void execute();
+	void jobFence() { delete this; }
+};
+
+bool AssetBundleWriter::encodeBitmap(const BitmapTag* tag, vector<uint8_t>& buf)
+{
+	//The bitmap may still be decoding on another pool thread
+	_R<BitmapContainer> b=tag->getBitmap();
+	//An empty entry records that there are no pixels, so that the
+	//bundle is not written again on every run
+	if(b->isEmpty())
+		return true;
+
+	BitmapHeader header;
+	header.width=b->getWidth();
+	header.height=b->getHeight();
+	header.stride=b->getStride();
+	header.size=header.stride*header.height;
+	uLongf compressedLen=compressBound(header.size);
+	buf.resize(sizeof(header)+compressedLen);
+	memcpy(&buf[0],&header,sizeof(header));
+	if(compress2(&buf[sizeof(header)],&compressedLen,b->getData(),header.size,Z_BEST_SPEED)!=Z_OK)
+		return false;
+	buf.resize(sizeof(header)+compressedLen);
+	return true;
+}
+
+bool AssetBundleWriter::encodeTokens(const DictionaryTag* tag, vector<uint8_t>& buf)
+{
+	vector<GeomToken> tokens;
+	if(const DefineShapeTag* s=dynamic_cast<const DefineShapeTag*>(tag))
+		s->buildTokens(tokens);
+	else if(const DefineTextTag* t=dynamic_cast<const DefineTextTag*>(tag))
+		t->buildTokens(tokens);
+	else
+		return false;
+	TokenWriter(buf).putTokens(tokens);
+	return true;
+}
+
+void AssetBundleWriter::execute()
+{
+	string tmpPath=path + ".XXXXXX";
+	vector<char> tmpName(tmpPath.begin(),tmpPath.end());
+	tmpName.push_back('\0');
+	int fd=g_mkstemp(&tmpName[0]);
+	if(fd==-1)
+	{
+		LOG(LOG_INFO,"Could not create asset bundle " << path);
+		return;
+	}
+	//The file is written through a stream, the descriptor is not needed
+	close(fd);
+	tmpPath=&tmpName[0];
+
+	ofstream out(tmpPath.c_str(),ios_base::binary|ios_base::trunc);
+	BundleHeader header;
+	memcpy(header.magic,BUNDLE_MAGIC,sizeof(BUNDLE_MAGIC));
+	header.version=AssetBundle::VERSION;
+	header.count=0;
+	header.reserved=0;
+	header.indexOffset=0;
+	out.write((const char*)&header,sizeof(header));
+
+	vector<IndexEntry> index;
+	vector<uint8_t> buf;
+	for(auto it=tags.begin();it!=tags.end() && !threadAborting;++it)
+	{
+		const DictionaryTag* tag=*it;
+		const BitmapTag* bitmapTag=dynamic_cast<const BitmapTag*>(tag);
+		AssetBundle::ENTRY_KIND kind=bitmapTag ? AssetBundle::BITMAP : AssetBundle::TOKENS;
+		IndexEntry e;
+		e.key=(kind<<16)|tag->getId();
+		e.reserved=0;
+		e.offset=out.tellp();
+
+		buf.clear();
+		const uint8_t* data=NULL;
+		size_t size=0;
+		//The old mapping stays valid while old is referenced
+		if(!old->getEntry(kind,tag->getId(),data,size))
+		{
+			try
+			{
+				if(!(bitmapTag ? encodeBitmap(bitmapTag,buf) : encodeTokens(tag,buf)))
+					continue;
+			}
+			catch(std::exception& e)
+			{
+				//e.g. a text using a font which is not defined
+				LOG(LOG_INFO,"Not caching asset " << tag->getId() << ": " << e.what());
+				continue;
+			}
+			data=buf.data();
+			size=buf.size();
+		}
+		out.write((const char*)data,size);
+		e.size=size;
+		index.push_back(e);
+	}
+
+	header.count=index.size();
+	header.indexOffset=out.tellp();
+	if(!index.empty())
+		out.write((const char*)&index[0],index.size()*sizeof(IndexEntry));
+	out.seekp(0);
+	out.write((const char*)&header,sizeof(header));
+	out.close();
+	if(threadAborting || out.fail())
+	{
+		g_unlink(tmpPath.c_str());
+		return;
+	}
+	//Readers never see a partial bundle
+	if(g_rename(tmpPath.c_str(),path.c_str())!=0)
+	{
+		g_unlink(tmpPath.c_str());
+		return;
+	}
+	LOG(LOG_INFO,"Wrote asset bundle " << path << " with " << index.size() << " entries");
+	AssetBundle::entryAdded(header.indexOffset+index.size()*sizeof(IndexEntry));
+}
+
+}
+
+AssetBundle::AssetBundle(const string& p):path(p),mapping(NULL)
+{
+}
+
+AssetBundle::~AssetBundle()
+{
+	if(mapping)
+		g_mapped_file_unref(mapping);
+}
+
+bool AssetBundle::isEnabled()
+{
+	return Config::getConfig()->isAssetCacheEnabled();
+}
+
+string AssetBundle::getDirectory()
+{
+	return Config::getConfig()->getCacheDirectory() + "/assets";
+}
+
+void AssetBundle::entryAdded(uint64_t size)
+{
+	uint64_t limit=Config::getConfig()->getAssetCacheLimit();
+	Locker l(sizeMutex);
+	if(!sizeKnown)
+	{
+		//The new bundle is already in the directory
+		totalSize=listEntries(getDirectory(),NULL);
+		sizeKnown=true;
+	}
+	else
+		totalSize+=size;
+	if(totalSize<=limit)
+		return;
+
+	//Evict the least recently used bundles, leaving some room so that
+	//the directory is not scanned again for every new bundle
+	vector<CacheEntry> entries;
+	totalSize=listEntries(getDirectory(),&entries);
+	sort(entries.begin(),entries.end());
+	for(auto it=entries.begin();it!=entries.end() && totalSize>limit/4*3;++it)
+	{
+		if(g_unlink(it->path.c_str())==0)
+			totalSize-=it->size;
+	}
+}
+
+_R<AssetBundle> AssetBundle::open(const uint8_t* file, size_t len)
+{
+	gchar* key=g_compute_checksum_for_data(G_CHECKSUM_SHA1,file,len);
+	_R<AssetBundle> ret=_MR(new AssetBundle(getDirectory() + "/" + key + ".bundle"));
+	g_free(key);
+
+	ret->mapping=g_mapped_file_new(ret->path.c_str(),FALSE,NULL);
+	if(ret->mapping==NULL)
+		return ret;
+
+	const uint8_t* contents=(const uint8_t*)g_mapped_file_get_contents(ret->mapping);
+	size_t mappedLen=g_mapped_file_get_length(ret->mapping);
+	BundleHeader header;
+	bool valid=false;
+	if(mappedLen>=sizeof(header))
+	{
+		memcpy(&header,contents,sizeof(header));
+		valid=memcmp(header.magic,BUNDLE_MAGIC,sizeof(BUNDLE_MAGIC))==0 && header.version==VERSION &&
+			header.indexOffset>=sizeof(header) && header.indexOffset<=mappedLen &&
+			header.count<=(mappedLen-header.indexOffset)/sizeof(IndexEntry);
+	}
+	for(uint32_t i=0;valid && i<header.count;i++)
+	{
+		IndexEntry e;
+		memcpy(&e,contents+header.indexOffset+i*sizeof(IndexEntry),sizeof(e));
+		if(e.offset<sizeof(header) || e.offset>header.indexOffset || e.size>header.indexOffset-e.offset)
+		{
+			valid=false;
+			break;
+		}
+		Entry& entry=ret->entries[e.key];
+		entry.offset=e.offset;
+		entry.size=e.size;
+	}
+	if(!valid)
+	{
+		LOG(LOG_INFO,"Ignoring invalid asset bundle " << ret->path);
+		ret->entries.clear();
+		g_mapped_file_unref(ret->mapping);
+		ret->mapping=NULL;
+		return ret;
+	}
+	LOG(LOG_INFO,"Loaded asset bundle " << ret->path << " with " << header.count << " entries");
+	//The modification time tells eviction which bundles are in use
+	g_utime(ret->path.c_str(),NULL);
+	return ret;
+}
+
+const AssetBundle::Entry* AssetBundle::findEntry(ENTRY_KIND kind, uint32_t id) const
+{
+	auto it=entries.find(getKey(kind,id));
+	if(it==entries.end())
+		return NULL;
+	return &it->second;
+}
+
+bool AssetBundle::getEntry(ENTRY_KIND kind, uint32_t id, const uint8_t*& data, size_t& size) const
+{
+	const Entry* e=findEntry(kind,id);
+	if(e==NULL)
+		return false;
+	data=(const uint8_t*)g_mapped_file_get_contents(mapping)+e->offset;
+	size=e->size;
+	return true;
+}
+
+bool AssetBundle::loadBitmap(uint32_t id, BitmapContainer* b) const
+{
+	const uint8_t* data;
+	size_t size;
+	if(!getEntry(BITMAP,id,data,size))
+		return false;
+
+	BitmapHeader header;
+	if(size<sizeof(header))
+		return false;
+	memcpy(&header,data,sizeof(header));
+	if(header.width<=0 || header.height<=0 || header.stride<uint32_t(header.width)*4 ||
+	   uint64_t(header.stride)*header.height!=header.size)
+		return false;
+	uint8_t* pixels=b->allocateData(header.width,header.height,header.stride);
+	uLongf pixelsLen=header.size;
+	if(uncompress(pixels,&pixelsLen,data+sizeof(header),size-sizeof(header))!=Z_OK ||
+	   pixelsLen!=header.size)
+	{
+		LOG(LOG_INFO,"Ignoring invalid bitmap " << id << " in asset bundle " << path);
+		b->clear();
+		return false;
+	}
+	return true;
+}
+
+bool AssetBundle::loadTokens(uint32_t id, RootMovieClip* root, vector<GeomToken>& tokens) const
+{
+	const uint8_t* data;
+	size_t size;
+	if(!getEntry(TOKENS,id,data,size))
+		return false;
+
+	TokenReader reader(data,size,root);
+	reader.getTokens(tokens);
+	if(!reader.ok)
+	{
+		LOG(LOG_INFO,"Ignoring invalid tokens " << id << " in asset bundle " << path);
+		tokens.clear();
+		return false;
+	}
+	return true;
+}
+
+void AssetBundle::storeAsync(_R<RootMovieClip> root, vector<const DictionaryTag*>& tags)
+{
+	bool missing=false;
+	for(auto it=tags.begin();it!=tags.end() && !missing;++it)
+	{
+		ENTRY_KIND kind=dynamic_cast<const BitmapTag*>(*it) ? BITMAP : TOKENS;
+		missing=!hasEntry(kind,(*it)->getId());
+	}
+	if(!missing)
+		return;
+	g_mkdir_with_parents(getDirectory().c_str(),0700);
+	this->incRef();
+	getSys()->addJob(new AssetBundleWriter(_MR(this),root,tags,path));
+}
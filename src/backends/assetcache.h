@@ -0,0 +1,107 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef BACKENDS_ASSETCACHE_H
+#define BACKENDS_ASSETCACHE_H 1
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <glib.h>
+#include "compat.h"
+#include "smartrefs.h"
+
+namespace lightspark
+{
+
+class BitmapContainer;
+class GeomToken;
+class DictionaryTag;
+class RootMovieClip;
+
+/*
+ * The assets of a SWF file, kept in the cache directory so that a file
+ * which is run again does not decode and build them again.
+ *
+ * There is one bundle per SWF file, keyed by a SHA-1 of the whole file.
+ * It starts with a versioned header and an index of the entries by kind
+ * and character id, followed by the entries:
+ * - the pixels of bitmap tags, compressed with the fastest zlib level
+ * - the tokens of shape and text tags, with bitmap fills referring to
+ *   the character id of their bitmap
+ * The file is read through a memory mapping, and an entry is only
+ * inflated or deserialized when its tag asks for it.
+ *
+ * ParseThread opens the bundle of a local file before reading its tags.
+ * Once the file is parsed and its bitmaps are decoded, a new bundle is
+ * written on the ThreadPool if the old one misses some of the assets.
+ *
+ * The size of the directory is limited by the cache/assetslimit setting.
+ * Opening a bundle updates its modification time, and the least recently
+ * used bundles are deleted when the limit is exceeded.
+ */
+class AssetBundle: public RefCountable
+{
+public:
+	enum ENTRY_KIND { BITMAP=0, TOKENS=1 };
+private:
+	struct Entry
+	{
+		uint64_t offset;
+		uint64_t size;
+	};
+	std::string path;
+	GMappedFile* mapping;
+	//Indexed by getKey
+	std::unordered_map<uint32_t, Entry> entries;
+	AssetBundle(const std::string& p);
+	static uint32_t getKey(ENTRY_KIND kind, uint32_t id) { return (kind<<16)|id; }
+	static std::string getDirectory();
+	const Entry* findEntry(ENTRY_KIND kind, uint32_t id) const;
+public:
+	//Accounts for a new bundle of the given size and evicts old ones if needed
+	static void entryAdded(uint64_t size);
+	//Files written with a different version are ignored
+	static const uint32_t VERSION=2;
+	static bool isEnabled();
+	/*
+	 * Opens the bundle of the SWF file with the given contents. If there
+	 * is no valid bundle yet, the returned one is empty
+	 */
+	static _R<AssetBundle> open(const uint8_t* file, size_t len);
+	~AssetBundle();
+	bool hasEntry(ENTRY_KIND kind, uint32_t id) const { return findEntry(kind,id)!=NULL; }
+	//Returns the raw contents of an entry, they are valid while the bundle is referenced
+	bool getEntry(ENTRY_KIND kind, uint32_t id, const uint8_t*& data, size_t& size) const;
+	//Returns true if the pixels were found and loaded into the empty b
+	bool loadBitmap(uint32_t id, BitmapContainer* b) const;
+	//Returns true if the tokens were found, bitmap fills are looked up in root
+	bool loadTokens(uint32_t id, RootMovieClip* root, std::vector<GeomToken>& tokens) const;
+	/*
+	 * Queues on the ThreadPool the writing of a new bundle with the assets
+	 * of tags, once their bitmaps are decoded. Nothing is written if this
+	 * bundle already has all of them. The job keeps a reference to root,
+	 * which owns the tags
+	 */
+	void storeAsync(_R<RootMovieClip> root, std::vector<const DictionaryTag*>& tags);
+};
+
+};
+
+#endif /* BACKENDS_ASSETCACHE_H */
@@ -19,6 +19,7 @@
 
 #include <glib.h>
 #include <string>
+#include <algorithm>
 #include <boost/filesystem.hpp>
 
 #include "backends/config.h"
@@ -83,9 +84,11 @@ Config::Config():
 	systemConfigDirectories(g_get_system_config_dirs()),userConfigDirectory(g_get_user_config_dir()),
 	//DEFAULT SETTINGS
 	defaultCacheDirectory((string) g_get_user_cache_dir() + "/lightspark"),
-	cacheDirectory(defaultCacheDirectory),cachePrefix("cache"),
+	cacheDirectory(defaultCacheDirectory),cachePrefix("cache"),assetCacheEnabled(false),
+	assetCacheLimit(256*1024*1024),
 	audioBackend(INVALID),audioBackendName(""),
-	renderingEnabled(true)
+	renderingEnabled(true),decompressionBufferSize(4*1024*1024),
+	soundCacheSize(32*1024*1024)
 {
 #ifdef _WIN32
 	const char* exePath = getExectuablePath();
@@ -209,15 +212,27 @@ void Config::handleEntry()
 		audioBackend = SDL;
 	else if(group == "audio" && key == "backend" && value == audioBackendNames[WINMM])
 		 audioBackend = WINMM;
+	//Decoded sound cache, in KiB
+	else if(group == "audio" && key == "soundcache")
+		soundCacheSize = max(atoi(value.c_str()),0)*1024;
 	//Rendering
 	else if(group == "rendering" && key == "enabled")
 		renderingEnabled = atoi(value.c_str());
+	//Decompression buffer, in KiB
+	else if(group == "parsing" && key == "decompressionbuffer")
+		decompressionBufferSize = max(atoi(value.c_str()),0)*1024;
 	//Cache directory
 	else if(group == "cache" && key == "directory")
 		cacheDirectory = value;
 	//Cache prefix
 	else if(group == "cache" && key == "prefix")
 		cachePrefix = value;
+	//Persistent cache of decoded assets
+	else if(group == "cache" && key == "assets")
+		assetCacheEnabled = atoi(value.c_str());
+	//Size limit of the decoded assets cache, in MiB
+	else if(group == "cache" && key == "assetslimit")
+		assetCacheLimit = uint64_t(max(atoi(value.c_str()),0))*1024*1024;
 	else
 		throw ConfigException((string) _("Invalid entry encountered in configuration file") + ": '" + group + "/" + key + "'='" + value + "'");
 }
@@ -20,6 +20,7 @@
 #ifndef BACKENDS_CONFIG_H
 #define BACKENDS_CONFIG_H 1
 
+#include "compat.h"
 #include "parsing/config.h"
 
 namespace lightspark
@@ -47,6 +48,10 @@ namespace lightspark
 		std::string cacheDirectory;
 		//Specifies what prefix the cache files should have, default="cache"
 		std::string cachePrefix;
+		//Specifies if decoded assets are kept in the cache directory
+		bool assetCacheEnabled;
+		//Maximum size in bytes of the decoded assets cache
+		uint64_t assetCacheLimit;
 		//Specifies the filename including full path of the gnash executable
 		std::string gnashPath;
 
@@ -56,6 +61,14 @@ namespace lightspark
 
 		//Specifies if rendering should be done
 		bool renderingEnabled;
+
+		//Size in bytes of the buffer compressed SWFs are uncompressed
+		//into ahead of the parser, 0 uncompresses on the parser thread
+		size_t decompressionBufferSize;
+
+		//Size in bytes of the memory used to keep embedded sounds
+		//decoded between playbacks, 0 decodes them on every playback
+		size_t soundCacheSize;
 		Config();
 		~Config();
 	public:
@@ -64,12 +77,18 @@ namespace lightspark
 
 		const std::string& getCacheDirectory() const { return cacheDirectory; }
 		const std::string& getCachePrefix() const { return cachePrefix; }
+		bool isAssetCacheEnabled() const { return assetCacheEnabled; }
+		uint64_t getAssetCacheLimit() const { return assetCacheLimit; }
 		const std::string& getGnashPath() const { return gnashPath; }
 
 		AUDIOBACKEND getAudioBackend() const { return audioBackend; }
 		const std::string& getAudioBackendName() const { return audioBackendName; }
 
 		bool isRenderingEnabled() const { return renderingEnabled; }
+
+		size_t getDecompressionBufferSize() const { return decompressionBufferSize; }
+
+		size_t getSoundCacheSize() const { return soundCacheSize; }
 	};
 }
 
@@ -450,6 +450,25 @@ void AudioDecoder::skipAll()
 		discardFrame();
 }
 
+PCMAudioDecoder::PCMAudioDecoder(uint32_t _sampleRate, uint32_t channels)
+{
+	sampleRate=_sampleRate;
+	channelCount=channels;
+	status=VALID;
+}
+
+uint32_t PCMAudioDecoder::decodeData(uint8_t* data, int32_t datalen, uint32_t time)
+{
+	assert(datalen>=0 && datalen<=MAX_AUDIO_FRAME_SIZE && datalen%2==0);
+	FrameSamples& curTail=samplesBuffer.acquireLast();
+	memcpy(curTail.samples, data, datalen);
+	curTail.len=datalen;
+	curTail.current=curTail.samples;
+	curTail.time=time;
+	samplesBuffer.commitLast();
+	return datalen;
+}
+
 #ifdef ENABLE_LIBAVCODEC
 FFMpegAudioDecoder::FFMpegAudioDecoder(LS_AUDIO_CODEC audioCodec, uint8_t* initdata, uint32_t datalen):ownedContext(true)
 {
@@ -283,6 +283,16 @@ public:
 	uint32_t decodeData(uint8_t* data, int32_t datalen, uint32_t time){return 0;}
 };
 
+/*
+   Queues samples which are already decoded as signed 16 bit native endian PCM
+*/
+class PCMAudioDecoder: public AudioDecoder
+{
+public:
+	PCMAudioDecoder(uint32_t sampleRate, uint32_t channels);
+	uint32_t decodeData(uint8_t* data, int32_t datalen, uint32_t time);
+};
+
 #ifdef ENABLE_LIBAVCODEC
 class FFMpegAudioDecoder: public AudioDecoder
 {
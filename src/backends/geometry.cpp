@@ -43,7 +43,7 @@ void ShapesBuilder::clear()
 
 void ShapesBuilder::joinOutlines()
 {
-	map< unsigned int, vector< vector <ShapePathSegment> > >::iterator it=filledShapesMap.begin();
+	auto it=filledShapesMap.begin();
 	for(;it!=filledShapesMap.end();++it)
 	{
 		vector< vector<ShapePathSegment> >& outlinesForColor=it->second;
@@ -88,12 +88,13 @@ void ShapesBuilder::joinOutlines()
 }
 
 unsigned int ShapesBuilder::makeVertex(const Vector2& v) {
-	map<Vector2, unsigned int>::const_iterator it=verticesMap.find(v);
+	auto it=verticesMap.find(v);
 	if(it!=verticesMap.end())
 		return it->second;
 
-	unsigned int i = verticesMap.size();
+	unsigned int i = vertices.size();
 	verticesMap.insert(make_pair(v, i));
+	vertices.push_back(v);
 	return i;
 }
 
@@ -158,36 +159,36 @@ void ShapesBuilder::extendFilledOutlineForColorCurve(unsigned int color, const V
 
 const Vector2& ShapesBuilder::getVertex(unsigned int index)
 {
-	//Linear lookup
-	map<Vector2, unsigned int>::const_iterator it=verticesMap.begin();
-	for(;it!=verticesMap.end();++it)
-	{
-		if(it->second==index)
-			return it->first;
-	}
-	::abort();
+	assert(index<vertices.size());
+	return vertices[index];
 }
 
-void ShapesBuilder::outputTokens(const std::list<FILLSTYLE>& styles, tokensVector& tokens)
+void ShapesBuilder::outputTokens(const std::list<FILLSTYLE>& styles, std::vector<GeomToken>& tokens)
 {
 	joinOutlines();
+	//Colors are output in increasing order
+	vector<unsigned int> colors;
+	colors.reserve(filledShapesMap.size());
+	for(auto it=filledShapesMap.begin();it!=filledShapesMap.end();++it)
+		colors.push_back(it->first);
+	sort(colors.begin(),colors.end());
 	//Try to greedily condense as much as possible the output
-	map< unsigned int, vector< vector<ShapePathSegment> > >::iterator it=filledShapesMap.begin();
+	std::list<FILLSTYLE>::const_iterator stylesIt=styles.begin();
+	unsigned int styleIndex=1;
 	//For each color
-	for(;it!=filledShapesMap.end();++it)
+	for(unsigned int c=0;c<colors.size();c++)
 	{
-		assert(!it->second.empty());
+		vector<vector<ShapePathSegment> >& outlinesForColor=filledShapesMap[colors[c]];
+		assert(!outlinesForColor.empty());
 		//Find the style given the index
-		std::list<FILLSTYLE>::const_iterator stylesIt=styles.begin();
-		assert(it->first);
-		for(unsigned int i=0;i<it->first-1;i++)
+		assert(colors[c]);
+		for(;styleIndex<colors[c];styleIndex++)
 		{
 			++stylesIt;
 			assert(stylesIt!=styles.end());
 		}
 		//Set the fill style
 		tokens.emplace_back(GeomToken(SET_FILL,*stylesIt));
-		vector<vector<ShapePathSegment> >& outlinesForColor=it->second;
 		for(unsigned int i=0;i<outlinesForColor.size();i++)
 		{
 			vector<ShapePathSegment>& segments=outlinesForColor[i];
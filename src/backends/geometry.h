@@ -24,6 +24,7 @@
 #include <list>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 namespace lightspark
 {
@@ -85,7 +86,14 @@ public:
 	GeomToken(GEOM_TOKEN_TYPE _t, const MATRIX _m):fillStyle(0xff),lineStyle(0xff),textureTransform(_m),type(_t),p1(0,0),p2(0,0),p3(0,0){}
 };
 
-typedef std::vector<GeomToken, reporter_allocator<GeomToken>> tokensVector;
+/* Tokens built once from the records of a shape or text tag. They are
+ * shared by every object instantiated from the tag, so they must not
+ * be modified after they are built */
+class ShapeTokens: public RefCountable
+{
+public:
+	std::vector<GeomToken> tokens;
+};
 
 enum SHAPE_PATH_SEGMENT_TYPE { PATH_START=0, PATH_STRAIGHT, PATH_CURVE_QUADRATIC };
 
@@ -97,12 +105,22 @@ public:
 	bool operator==(const ShapePathSegment& v)const{return v.i == i;}
 };
 
+struct Vector2Hash
+{
+	size_t operator()(const Vector2& v) const
+	{
+		return std::hash<uint64_t>()((uint64_t(uint32_t(v.x))<<32)|uint32_t(v.y));
+	}
+};
+
 class ShapesBuilder
 {
 private:
-	std::map< Vector2, unsigned int > verticesMap;
-	std::map< unsigned int, std::vector< std::vector<ShapePathSegment> > > filledShapesMap;
-	std::map< unsigned int, std::vector< std::vector<ShapePathSegment> > > strokeShapesMap;
+	std::unordered_map< Vector2, unsigned int, Vector2Hash > verticesMap;
+	//The vertices by index
+	std::vector< Vector2 > vertices;
+	std::unordered_map< unsigned int, std::vector< std::vector<ShapePathSegment> > > filledShapesMap;
+	std::unordered_map< unsigned int, std::vector< std::vector<ShapePathSegment> > > strokeShapesMap;
 	void joinOutlines();
 	static bool isOutlineEmpty(const std::vector<ShapePathSegment>& outline);
 	static void extendOutlineForColor(std::map< unsigned int, std::vector< std::vector<Vector2> > >& map);
@@ -117,7 +135,7 @@ public:
 		@param styles This list is supposed to survive until as long as the returned tokens array
 		@param tokens A vector that will be filled with tokens
 	*/
-	void outputTokens(const std::list<FILLSTYLE>& styles, tokensVector& tokens);
+	void outputTokens(const std::list<FILLSTYLE>& styles, std::vector<GeomToken>& tokens);
 	void clear();
 };
 
@@ -20,6 +20,7 @@
 #include "version.h"
 #include "backends/security.h"
 #include "swf.h"
+#include "parsing/streams.h"
 #include "logger.h"
 #include "platforms/engineutils.h"
 #ifndef _WIN32
@@ -261,11 +262,22 @@ int main(int argc, char* argv[])
 #endif
 
 	Log::setLogLevel(log_level);
-	ifstream f(fileName, ios::in|ios::binary);
-	f.seekg(0, ios::end);
-	uint32_t fileSize=f.tellg();
-	f.seekg(0, ios::beg);
-	if(!f)
+	//Parse straight from a read only mapping of the file when possible,
+	//fall back to a regular file stream otherwise
+	mapped_file_buf* mappedFile=mapped_file_buf::open(fileName);
+	ifstream file;
+	uint32_t fileSize=0;
+	if(mappedFile)
+		fileSize=mappedFile->size();
+	else
+	{
+		file.open(fileName, ios::in|ios::binary);
+		file.seekg(0, ios::end);
+		fileSize=file.tellg();
+		file.seekg(0, ios::beg);
+	}
+	istream f(mappedFile ? static_cast<streambuf*>(mappedFile) : file.rdbuf());
+	if(!mappedFile && !file)
 	{
 		LOG(LOG_ERROR, argv[0] << ": " << fileName << ": No such file or directory");
 		exit(2);
@@ -353,6 +365,7 @@ int main(int argc, char* argv[])
 	sys->destroy();
 	delete pt;
 	delete sys;
+	delete mappedFile;
 
 	SystemState::staticDeinit();
 	EngineData::quitGTKMain();
@@ -26,50 +26,111 @@
 #include "toplevel/XML.h"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include "scripting/flash/utils/ByteArray.h"
 
 using namespace std;
 using namespace lightspark;
 
-_R<ASObject> Amf3Deserializer::readObject() const
+_R<ASObject> Amf3Deserializer::readObject()
 {
-	vector<tiny_string> stringMap;
-	vector<ASObject*> objMap;
-	vector<TraitsRef> traitsMap;
-	return parseValue(stringMap, objMap, traitsMap);
+	stringMap.clear();
+	stringIds.clear();
+	objMap.clear();
+	traitsMap.clear();
+	syncFromInput();
+	try
+	{
+		_R<ASObject> ret=parseValue();
+		syncToInput();
+		return ret;
+	}
+	catch(...)
+	{
+		//Both parse errors and AS exceptions leave input at the failing position
+		syncToInput();
+		throw;
+	}
+}
+
+void Amf3Deserializer::syncFromInput()
+{
+	//The caller already holds the lock of input
+	start=input->bytes;
+	end=start+input->len;
+	cur=start+std::min(input->position, input->len);
 }
 
-_R<ASObject> Amf3Deserializer::parseInteger() const
+void Amf3Deserializer::syncToInput()
 {
-	uint32_t tmp;
-	if(!input->readU29(tmp))
-		throw ParseException("Not enough data to parse integer");
-	return _MR(abstract_i(tmp));
+	input->position=cur-start;
 }
 
-_R<ASObject> Amf3Deserializer::parseDouble() const
+uint8_t Amf3Deserializer::readByte()
+{
+	if(cur==end)
+		throw ParseException("Not enough data to parse AMF3 object");
+	return *cur++;
+}
+
+uint32_t Amf3Deserializer::readU29()
+{
+	//Be careful! This is different from u32 parsing.
+	//Here the most significant bits appears before in the stream!
+	uint32_t ret=0;
+	for(uint32_t i=0;i<4;i++)
+	{
+		if(cur==end)
+			throw ParseException("Not enough data to parse AMF3 object");
+
+		uint8_t tmp=*cur++;
+		ret <<= 7;
+		if(i<3)
+		{
+			ret |= tmp&0x7f;
+			if((tmp&0x80)==0)
+				break;
+		}
+		else
+		{
+			ret |= tmp;
+			//Sign extend
+			if(tmp&0x80)
+				ret|=0xe0000000;
+		}
+	}
+	return ret;
+}
+
+const char* Amf3Deserializer::readBytes(uint32_t len)
+{
+	if((uint32_t)(end-cur) < len)
+		throw ParseException("Not enough data to parse string");
+	const char* ret=reinterpret_cast<const char*>(cur);
+	cur+=len;
+	return ret;
+}
+
+_R<ASObject> Amf3Deserializer::parseInteger()
+{
+	return _MR(abstract_i(readU29()));
+}
+
+_R<ASObject> Amf3Deserializer::parseDouble()
 {
 	union
 	{
 		uint64_t dummy;
 		double val;
 	} tmp;
-	uint8_t* tmpPtr=reinterpret_cast<uint8_t*>(&tmp.dummy);
-
-	for(uint32_t i=0;i<8;i++)
-	{
-		if(!input->readByte(tmpPtr[i]))
-			throw ParseException("Not enough data to parse double");
-	}
+	memcpy(&tmp.dummy, readBytes(8), 8);
 	tmp.dummy=GINT64_FROM_BE(tmp.dummy);
 	return _MR(abstract_d(tmp.val));
 }
 
-tiny_string Amf3Deserializer::parseStringVR(std::vector<tiny_string>& stringMap) const
+tiny_string Amf3Deserializer::parseStringVR()
 {
-	uint32_t strRef;
-	if(!input->readU29(strRef))
-		throw ParseException("Not enough data to parse string");
+	uint32_t strRef=readU29();
 
 	if((strRef&0x01)==0)
 	{
@@ -80,27 +141,45 @@ tiny_string Amf3Deserializer::parseStringVR(std::vector<tiny_string>& stringMap)
 	}
 
 	uint32_t strLen=strRef>>1;
-	string retStr;
-	for(uint32_t i=0;i<strLen;i++)
-	{
-		uint8_t c;
-		if(!input->readByte(c))
-			throw ParseException("Not enough data to parse string");
-		retStr.push_back(c);
-	}
+	tiny_string retStr(std::string(readBytes(strLen), strLen));
 	//Add string to the map, if it's not the empty one
-	if(retStr.size())
+	if(strLen)
+	{
 		stringMap.emplace_back(retStr);
+		stringIds.push_back(UINT32_MAX);
+	}
 	return retStr;
 }
 
-_R<ASObject> Amf3Deserializer::parseArray(std::vector<tiny_string>& stringMap,
-			std::vector<ASObject*>& objMap,
-			std::vector<TraitsRef>& traitsMap) const
+uint32_t Amf3Deserializer::parseStringId()
 {
-	uint32_t arrayRef;
-	if(!input->readU29(arrayRef))
-		throw ParseException("Not enough data to parse AMF3 array");
+	uint32_t strRef=readU29();
+	uint32_t index;
+	if((strRef&0x01)==0)
+	{
+		//Just a reference
+		index=strRef >> 1;
+		if(stringMap.size() <= index)
+			throw ParseException("Invalid string reference in AMF3 data");
+	}
+	else
+	{
+		uint32_t strLen=strRef>>1;
+		if(strLen==0)
+			return BUILTIN_STRINGS::EMPTY;
+		const char* str=readBytes(strLen);
+		index=stringMap.size();
+		stringMap.emplace_back(std::string(str, strLen));
+		stringIds.push_back(UINT32_MAX);
+	}
+	if(stringIds[index]==UINT32_MAX)
+		stringIds[index]=getSys()->getUniqueStringId(stringMap[index]);
+	return stringIds[index];
+}
+
+_R<ASObject> Amf3Deserializer::parseArray()
+{
+	uint32_t arrayRef=readU29();
 
 	if((arrayRef&0x01)==0)
 	{
@@ -119,32 +198,29 @@ _R<ASObject> Amf3Deserializer::parseArray(std::vector<tiny_string>& stringMap,
 	int32_t denseCount = arrayRef >> 1;
 
 	//Read name, value pairs
+	const nsNameAndKind emptyNs(BUILTIN_NAMESPACES::EMPTY_NS);
 	while(1)
 	{
-		const tiny_string& varName=parseStringVR(stringMap);
-		if(varName=="")
+		uint32_t varName=parseStringId();
+		if(varName==BUILTIN_STRINGS::EMPTY)
 			break;
-		_R<ASObject> value=parseValue(stringMap, objMap, traitsMap);
+		_R<ASObject> value=parseValue();
 		value->incRef();
-		ret->setVariableByQName(varName,"",value.getPtr(), DYNAMIC_TRAIT);
+		ret->setVariableByQName(varName,emptyNs,value.getPtr(), DYNAMIC_TRAIT);
 	}
 
 	//Read the dense portion
 	for(int32_t i=0;i<denseCount;i++)
 	{
-		_R<ASObject> value=parseValue(stringMap, objMap, traitsMap);
+		_R<ASObject> value=parseValue();
 		ret->push(value);
 	}
 	return ret;
 }
 
-_R<ASObject> Amf3Deserializer::parseObject(std::vector<tiny_string>& stringMap,
-			std::vector<ASObject*>& objMap,
-			std::vector<TraitsRef>& traitsMap) const
+_R<ASObject> Amf3Deserializer::parseObject()
 {
-	uint32_t objRef;
-	if(!input->readU29(objRef))
-		throw ParseException("Not enough data to parse AMF3 object");
+	uint32_t objRef=readU29();
 	if((objRef&0x01)==0)
 	{
 		//Just a reference
@@ -158,92 +234,108 @@ _R<ASObject> Amf3Deserializer::parseObject(std::vector<tiny_string>& stringMap,
 	if((objRef&0x07)==0x07)
 	{
 		//Custom serialization
-		const tiny_string& className=parseStringVR(stringMap);
+		const tiny_string className=parseStringVR();
 		assert_and_throw(!className.empty());
 		const auto it=getSys()->aliasMap.find(className);
 		assert_and_throw(it!=getSys()->aliasMap.end());
 
 		Class_base* type=it->second.getPtr();
-		traitsMap.push_back(TraitsRef(type));
-
-		_R<ASObject> ret=_MR(type->getInstance(true, NULL, 0));
-		//Invoke readExternal
-		multiname readExternalName(NULL);
-		readExternalName.name_type=multiname::NAME_STRING;
-		readExternalName.name_s_id=getSys()->getUniqueStringId("readExternal");
-		readExternalName.ns.push_back(nsNameAndKind("",NAMESPACE));
-		readExternalName.isAttribute = false;
-
-		_NR<ASObject> o=ret->getVariableByMultiname(readExternalName,ASObject::SKIP_IMPL);
-		assert_and_throw(!o.isNull() && o->getObjectType()==T_FUNCTION);
-		IFunction* f=o->as<IFunction>();
-		ret->incRef();
-		input->incRef();
-		ASObject* const tmpArg[1] = {input};
-		f->call(ret.getPtr(), tmpArg, 1);
-		return ret;
+		TraitsRef traits(type);
+		traits.externalizable=true;
+		traitsMap.push_back(traits);
+		return parseExternal(type);
 	}
 
-	TraitsRef traits(NULL);
+	uint32_t traitsIndex;
 	if((objRef&0x02)==0)
 	{
-		uint32_t traitsRef=objRef>>2;
-		if(traitsMap.size() <= traitsRef)
+		traitsIndex=objRef>>2;
+		if(traitsMap.size() <= traitsIndex)
 			throw ParseException("Invalid traits reference in AMF3 data");
-		traits=traitsMap[traitsRef];
+		if(traitsMap[traitsIndex].externalizable)
+			return parseExternal(traitsMap[traitsIndex].type);
 	}
 	else
 	{
+		TraitsRef traits(NULL);
 		traits.dynamic = objRef&0x08;
 		uint32_t traitsCount=objRef>>4;
-		const tiny_string& className=parseStringVR(stringMap);
-		//Add the type to the traitsMap
+		const tiny_string className=parseStringVR();
 		for(uint32_t i=0;i<traitsCount;i++)
-			traits.traitsNames.emplace_back(parseStringVR(stringMap));
+			traits.traitsNames.push_back(parseStringId());
 
 		const auto it=getSys()->aliasMap.find(className);
 		if(it!=getSys()->aliasMap.end())
 			traits.type=it->second.getPtr();
+		//Add the type to the traitsMap
+		traitsIndex=traitsMap.size();
 		traitsMap.emplace_back(traits);
 	}
+	//Nested objects may add traits, so traitsMap is indexed again after parsing each value
+	Class_base* type=traitsMap[traitsIndex].type;
+	const bool dynamic=traitsMap[traitsIndex].dynamic;
+	const uint32_t traitsCount=traitsMap[traitsIndex].traitsNames.size();
 
-	_R<ASObject> ret=_MR((traits.type)?traits.type->getInstance(true, NULL, 0):
+	_R<ASObject> ret=_MR((type)?type->getInstance(true, NULL, 0):
 		Class<ASObject>::getInstanceS());
 	//Add object to the map
 	objMap.push_back(ret.getPtr());
 
-	for(uint32_t i=0;i<traits.traitsNames.size();i++)
+	multiname name(NULL);
+	name.name_type=multiname::NAME_STRING;
+	name.ns.push_back(nsNameAndKind(BUILTIN_NAMESPACES::EMPTY_NS));
+	name.isAttribute=false;
+	for(uint32_t i=0;i<traitsCount;i++)
 	{
-		_R<ASObject> value=parseValue(stringMap, objMap, traitsMap);
+		_R<ASObject> value=parseValue();
 		value->incRef();
 
-		multiname name(NULL);
-		name.name_type=multiname::NAME_STRING;
-		name.name_s_id=getSys()->getUniqueStringId(traits.traitsNames[i]);
-		name.ns.push_back(nsNameAndKind("",NAMESPACE));
-		name.isAttribute=false;
-
-		ret->setVariableByMultiname(name,value.getPtr(),ASObject::CONST_ALLOWED,traits.type);
+		name.name_s_id=traitsMap[traitsIndex].traitsNames[i];
+		ret->setVariableByMultiname(name,value.getPtr(),ASObject::CONST_ALLOWED,type);
 	}
 
 	//Read dynamic name, value pairs
-	while(traits.dynamic)
+	while(dynamic)
 	{
-		const tiny_string& varName=parseStringVR(stringMap);
-		if(varName=="")
+		uint32_t varName=parseStringId();
+		if(varName==BUILTIN_STRINGS::EMPTY)
 			break;
-		_R<ASObject> value=parseValue(stringMap, objMap, traitsMap);
+		_R<ASObject> value=parseValue();
 		value->incRef();
-		ret->setVariableByQName(varName,"",value.getPtr(),DYNAMIC_TRAIT);
+		ret->setDynamicVariableNoCheck(varName,value.getPtr());
 	}
 	return ret;
 }
 
-_R<ASObject> Amf3Deserializer::parseXML(std::vector<ASObject*>& objMap, bool legacyXML) const
+_R<ASObject> Amf3Deserializer::parseExternal(Class_base* type)
 {
-	uint32_t xmlRef;
-	if(!input->readU29(xmlRef))
-		throw ParseException("Not enough data to parse XML");
+	_R<ASObject> ret=_MR(type->getInstance(true, NULL, 0));
+	//Add object to the map
+	objMap.push_back(ret.getPtr());
+
+	//Invoke readExternal
+	multiname readExternalName(NULL);
+	readExternalName.name_type=multiname::NAME_STRING;
+	readExternalName.name_s_id=getSys()->getUniqueStringId("readExternal");
+	readExternalName.ns.push_back(nsNameAndKind("",NAMESPACE));
+	readExternalName.isAttribute = false;
+
+	_NR<ASObject> o=ret->getVariableByMultiname(readExternalName,ASObject::SKIP_IMPL);
+	assert_and_throw(!o.isNull() && o->getObjectType()==T_FUNCTION);
+	IFunction* f=o->as<IFunction>();
+	ret->incRef();
+	input->incRef();
+	ASObject* const tmpArg[1] = {input};
+	//readExternal reads from input using its own position
+	syncToInput();
+	f->call(ret.getPtr(), tmpArg, 1)->decRef();
+	syncFromInput();
+	return ret;
+}
+
+_R<ASObject> Amf3Deserializer::parseXML(bool legacyXML)
+{
+	uint32_t xmlRef=readU29();
 
 	if((xmlRef&0x01)==0)
 	{
@@ -256,14 +348,7 @@ _R<ASObject> Amf3Deserializer::parseXML(std::vector<ASObject*>& objMap, bool leg
 	}
 
 	uint32_t strLen=xmlRef>>1;
-	string xmlStr;
-	for(uint32_t i=0;i<strLen;i++)
-	{
-		uint8_t c;
-		if(!input->readByte(c))
-			throw ParseException("Not enough data to parse string");
-		xmlStr.push_back(c);
-	}
+	string xmlStr(readBytes(strLen), strLen);
 
 	ASObject *xmlObj;
 	if(legacyXML)
@@ -274,14 +359,10 @@ _R<ASObject> Amf3Deserializer::parseXML(std::vector<ASObject*>& objMap, bool leg
 	return _MR(xmlObj);
 }
 
-_R<ASObject> Amf3Deserializer::parseValue(std::vector<tiny_string>& stringMap,
-			std::vector<ASObject*>& objMap,
-			std::vector<TraitsRef>& traitsMap) const
+_R<ASObject> Amf3Deserializer::parseValue()
 {
 	//Read the first byte as it contains the object marker
-	uint8_t marker;
-	if(!input->readByte(marker))
-		throw ParseException("Not enough data to parse AMF3 object");
+	uint8_t marker=readByte();
 
 	switch(marker)
 	{
@@ -298,15 +379,15 @@ _R<ASObject> Amf3Deserializer::parseValue(std::vector<tiny_string>& stringMap,
 		case double_marker:
 			return parseDouble();
 		case string_marker:
-			return _MR(Class<ASString>::getInstanceS(parseStringVR(stringMap)));
+			return _MR(Class<ASString>::getInstanceS(parseStringVR()));
 		case xml_doc_marker:
-			return parseXML(objMap, true);
+			return parseXML(true);
 		case array_marker:
-			return parseArray(stringMap, objMap, traitsMap);
+			return parseArray();
 		case object_marker:
-			return parseObject(stringMap, objMap, traitsMap);
+			return parseObject();
 		case xml_marker:
-			return parseXML(objMap, false);
+			return parseXML(false);
 		default:
 			LOG(LOG_ERROR,"Unsupported marker " << (uint32_t)marker);
 			throw UnsupportedException("Unsupported marker");
@@ -54,31 +54,47 @@ class TraitsRef
 {
 public:
 	Class_base* type;
-	std::vector<tiny_string> traitsNames;
+	//The ids of the names are resolved once, when the traits are defined
+	std::vector<uint32_t> traitsNames;
 	bool dynamic;
-	TraitsRef(Class_base* t):type(t),dynamic(false){}
+	//The objects are read by readExternal
+	bool externalizable;
+	TraitsRef(Class_base* t):type(t),dynamic(false),externalizable(false){}
 };
 
+/*
+ * Parses AMF3 data directly from the buffer of the ByteArray, the position
+ * of the ByteArray is updated when parsing ends and around readExternal calls
+ */
 class Amf3Deserializer
 {
 private:
 	ByteArray* input;
-	tiny_string parseStringVR(std::vector<tiny_string>& stringMap) const;
-	_R<ASObject> parseObject(std::vector<tiny_string>& stringMap,
-			std::vector<ASObject*>& objMap,
-			std::vector<TraitsRef>& traitsMap) const;
-	_R<ASObject> parseArray(std::vector<tiny_string>& stringMap,
-			std::vector<ASObject*>& objMap,
-			std::vector<TraitsRef>& traitsMap) const;
-	_R<ASObject> parseValue(std::vector<tiny_string>& stringMap,
-			std::vector<ASObject*>& objMap,
-			std::vector<TraitsRef>& traitsMap) const;
-	_R<ASObject> parseInteger() const;
-	_R<ASObject> parseDouble() const;
-	_R<ASObject> parseXML(std::vector<ASObject*>& objMap, bool legacyXML) const;
+	const uint8_t* start;
+	const uint8_t* cur;
+	const uint8_t* end;
+	std::vector<tiny_string> stringMap;
+	//Unique ids of the strings in stringMap used as names, resolved on first use
+	std::vector<uint32_t> stringIds;
+	std::vector<ASObject*> objMap;
+	std::vector<TraitsRef> traitsMap;
+	void syncFromInput();
+	void syncToInput();
+	uint8_t readByte();
+	uint32_t readU29();
+	const char* readBytes(uint32_t len);
+	tiny_string parseStringVR();
+	uint32_t parseStringId();
+	_R<ASObject> parseObject();
+	_R<ASObject> parseExternal(Class_base* type);
+	_R<ASObject> parseArray();
+	_R<ASObject> parseValue();
+	_R<ASObject> parseInteger();
+	_R<ASObject> parseDouble();
+	_R<ASObject> parseXML(bool legacyXML);
 public:
-	Amf3Deserializer(ByteArray* i):input(i) {}
-	_R<ASObject> readObject() const;
+	Amf3Deserializer(ByteArray* i):input(i),start(NULL),cur(NULL),end(NULL) {}
+	_R<ASObject> readObject();
 };
 
 };
@@ -25,6 +25,7 @@
 #include "toplevel/Error.h"
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include <assert.h>
 
 #define LZMA_PROP_LENGTH 5
@@ -47,6 +48,9 @@ int uncompressing_filter::underflow()
 
 	int available=fillBuffer();
 	setg(buffer,buffer,buffer+available);
+	//The stream may end exactly at a buffer boundary
+	if(available==0)
+		return -1;
 	
 	//Cast to unsigned, otherwise 0xff would become eof
 	return (unsigned char)buffer[0];
@@ -61,14 +65,15 @@ streampos uncompressing_filter::seekoff(off_type off, ios_base::seekdir dir,ios_
 	return ret;
 }
 
-zlib_filter::zlib_filter(streambuf* b):uncompressing_filter(b)
+zlib_filter::zlib_filter(streambuf* b, bool raw):uncompressing_filter(b)
 {
 	strm.zalloc = Z_NULL;
 	strm.zfree = Z_NULL;
 	strm.opaque = Z_NULL;
 	strm.avail_in = 0;
 	strm.next_in = Z_NULL;
-	int ret = inflateInit(&strm);
+	//Negative window bits select raw deflate data
+	int ret = inflateInit2(&strm, raw ? -MAX_WBITS : MAX_WBITS);
 	if (ret != Z_OK)
 		throw lightspark::RunTimeException("Failed to initialize ZLib");
 	setg(buffer,buffer,buffer);
@@ -125,7 +130,200 @@ bytes_buf::pos_type bytes_buf::seekoff(off_type off, ios_base::seekdir dir,ios_b
 	return ret;
 }
 
-liblzma_filter::liblzma_filter(streambuf* b):uncompressing_filter(b)
+pipelined_filter::pipelined_filter(uncompressing_filter* s, size_t size):
+	source(s),ring(new char[size]),ringSize(size),produced(0),released(0),eof(false),stopped(false)
+{
+	base=source->pubseekoff(0, ios_base::cur, ios_base::in);
+	setg(ring,ring,ring);
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+	t = lightspark::Thread::create(sigc::mem_fun(this,&pipelined_filter::worker));
+#else
+	t = lightspark::Thread::create(sigc::mem_fun(this,&pipelined_filter::worker),true);
+#endif
+}
+
+pipelined_filter::~pipelined_filter()
+{
+	stop();
+	delete source;
+	delete[] ring;
+}
+
+void pipelined_filter::stop()
+{
+	if(t==NULL)
+		return;
+	{
+		lightspark::Locker l(mutex);
+		stopped=true;
+		//Nothing will be produced anymore, don't let the reader wait
+		eof=true;
+		spaceAvailable.signal();
+		dataAvailable.signal();
+	}
+	//The worker may still be waiting for the compressed data,
+	//it checks stopped before every new chunk
+	t->join();
+	t=NULL;
+}
+
+void pipelined_filter::worker()
+{
+	lightspark::Locker l(mutex);
+	while(!stopped && !eof)
+	{
+		size_t space=ringSize-(produced-released);
+		if(space==0)
+		{
+			spaceAvailable.wait(mutex);
+			continue;
+		}
+		size_t offset=produced%ringSize;
+		size_t len=min(min(space,ringSize-offset),(size_t)CHUNK_LENGTH);
+		l.release();
+		streamsize count=0;
+		string failure;
+		try
+		{
+			count=source->sgetn(ring+offset,len);
+		}
+		catch(lightspark::LightsparkException& e)
+		{
+			failure=e.cause;
+		}
+		catch(std::exception& e)
+		{
+			failure=e.what();
+		}
+		l.acquire();
+		produced+=count;
+		if(!failure.empty())
+		{
+			error=failure;
+			eof=true;
+		}
+		else if(count==0)
+			eof=true;
+		dataAvailable.signal();
+	}
+}
+
+int pipelined_filter::underflow()
+{
+	assert(gptr()==egptr());
+	lightspark::Locker l(mutex);
+	//Give the bytes of the previous get area back to the worker
+	released+=(egptr()-eback());
+	setg(ring,ring,ring);
+	spaceAvailable.signal();
+	while(produced==released && !eof)
+		dataAvailable.wait(mutex);
+	if(produced==released)
+	{
+		if(!error.empty())
+			throw lightspark::ParseException(error);
+		return -1;
+	}
+	size_t offset=released%ringSize;
+	size_t available=min((size_t)(produced-released),ringSize-offset);
+	setg(ring+offset,ring+offset,ring+offset+available);
+	//Cast to unsigned, otherwise 0xff would become eof
+	return (unsigned char)ring[offset];
+}
+
+streampos pipelined_filter::seekoff(off_type off, ios_base::seekdir dir,ios_base::openmode mode)
+{
+	assert(off==0);
+	assert(dir==ios_base::cur);
+	return base+released+(gptr()-eback());
+}
+
+mapped_file_buf::mapped_file_buf(GMappedFile* m):
+	bytes_buf((const uint8_t*)g_mapped_file_get_contents(m),g_mapped_file_get_length(m)),mapping(m)
+{
+}
+
+mapped_file_buf* mapped_file_buf::open(const char* fileName)
+{
+	GError* error=NULL;
+	GMappedFile* m=g_mapped_file_new(fileName,FALSE,&error);
+	if(m==NULL)
+	{
+		LOG(LOG_INFO,"Could not map " << fileName << ": " << error->message);
+		g_error_free(error);
+		return NULL;
+	}
+	return new mapped_file_buf(m);
+}
+
+mapped_file_buf::~mapped_file_buf()
+{
+	g_mapped_file_unref(mapping);
+}
+
+uint32_t mapped_file_buf::size() const
+{
+	return g_mapped_file_get_length(mapping);
+}
+
+const uint8_t* mapped_file_buf::consume(size_t n)
+{
+	if((size_t)(egptr()-gptr())<n)
+		return NULL;
+	const uint8_t* ret=(const uint8_t*)gptr();
+	//gbump takes an int, the length of a mapping may not fit
+	setg(eback(),gptr()+n,egptr());
+	return ret;
+}
+
+stream_bytes::stream_bytes():mapping(NULL),ptr(NULL),len(0)
+{
+}
+
+stream_bytes::~stream_bytes()
+{
+	clear();
+}
+
+void stream_bytes::read(istream& in, size_t n)
+{
+	clear();
+	mapped_file_buf* m=in.good() ? dynamic_cast<mapped_file_buf*>(in.rdbuf()) : NULL;
+	const uint8_t* p=m ? m->consume(n) : NULL;
+	if(p)
+	{
+		mapping=g_mapped_file_ref(m->getMapping());
+		ptr=p;
+		len=n;
+		return;
+	}
+	//Not mapped, or too few bytes left: let the stream copy and
+	//report the error
+	copy.resize(n);
+	in.read((char*)copy.data(),n);
+	ptr=copy.data();
+	len=n;
+}
+
+void stream_bytes::clear()
+{
+	if(mapping)
+		g_mapped_file_unref(mapping);
+	mapping=NULL;
+	std::vector<uint8_t>().swap(copy);
+	ptr=NULL;
+	len=0;
+}
+
+void stream_bytes::swap(stream_bytes& r)
+{
+	std::swap(mapping,r.mapping);
+	copy.swap(r.copy);
+	std::swap(ptr,r.ptr);
+	std::swap(len,r.len);
+}
+
+liblzma_filter::liblzma_filter(streambuf* b, bool swfHeader):uncompressing_filter(b),remaining(UINT64_MAX)
 {
 	strm = LZMA_STREAM_INIT;
 	lzma_ret ret = lzma_alone_decoder(&strm, UINT64_MAX);
@@ -133,6 +331,30 @@ liblzma_filter::liblzma_filter(streambuf* b):uncompressing_filter(b)
 		throw lightspark::RunTimeException("Failed to initialize lzma decoder");
 	setg((char*)buffer, (char*)buffer, (char*)buffer);
 	consumed+=pubseekoff(0, ios_base::cur, ios_base::in);
+	strm.next_in = compressed_buffer;
+	strm.avail_in = 0;
+	if (!swfHeader)
+	{
+		/* Streams written by flash have the uncompressed size
+		 * and no end marker, the ones written by liblzma have
+		 * both. The decoder is told that the size is unknown,
+		 * so that it accepts the marker, and the output is
+		 * stopped at the size instead.
+		 */
+		const unsigned int headerLength = LZMA_PROP_LENGTH + sizeof(int64_t);
+		streamsize nbytes=backend->sgetn((char *)compressed_buffer,headerLength);
+		if (nbytes != (streamsize)headerLength)
+			throw lightspark::ParseException("Unexpected end of file");
+		uint64_t size = 0;
+		for (unsigned int i=0; i<sizeof(int64_t); i++)
+		{
+			size |= uint64_t(compressed_buffer[LZMA_PROP_LENGTH + i]) << (8*i);
+			compressed_buffer[LZMA_PROP_LENGTH + i] = 0xFF;
+		}
+		remaining = size;
+		strm.avail_in = headerLength;
+		return;
+	}
 
 	// First 32 bit uint is the compressed file length, which we
 	// ignore
@@ -159,7 +381,6 @@ liblzma_filter::liblzma_filter(streambuf* b):uncompressing_filter(b)
 	for (unsigned int i=0; i<sizeof(int64_t); i++)
 		compressed_buffer[LZMA_PROP_LENGTH + i] = 0xFF;
 
-	strm.next_in = compressed_buffer;
 	strm.avail_in = LZMA_PROP_LENGTH + sizeof(int64_t);
 }
 
@@ -170,8 +391,14 @@ liblzma_filter::~liblzma_filter()
 
 int liblzma_filter::fillBuffer()
 {
-	strm.avail_out = sizeof(buffer);
+	if (remaining == 0)
+	{
+		eof=true;
+		return 0;
+	}
+	strm.avail_out = std::min((uint64_t)sizeof(buffer), remaining);
 	strm.next_out = (uint8_t *)buffer;
+	const size_t requested = strm.avail_out;
 	do
 	{
 		if(strm.avail_in==0)
@@ -203,7 +430,10 @@ int liblzma_filter::fillBuffer()
 	}
 	while(strm.avail_out!=0);
 
-	return sizeof(buffer) - strm.avail_out;
+	const size_t produced = requested - strm.avail_out;
+	if (remaining != UINT64_MAX)
+		remaining -= produced;
+	return produced;
 }
 
 memorystream::memorystream(const char* const b, unsigned int l)
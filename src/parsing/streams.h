@@ -23,7 +23,9 @@
 #include "compat.h"
 #include "abctypes.h"
 #include "swftypes.h"
+#include "threading.h"
 #include <streambuf>
+#include <vector>
 #include <fstream>
 #include <cinttypes>
 #include <zlib.h>
@@ -32,7 +34,7 @@
 class uncompressing_filter: public std::streambuf
 {
 protected:
-	static const unsigned int BUFFER_LENGTH = 4096;
+	static const unsigned int BUFFER_LENGTH = 32768;
 
 	// The compressed input data stream
 	std::streambuf* backend;
@@ -63,7 +65,9 @@ private:
 protected:
 	virtual int fillBuffer();
 public:
-	zlib_filter(std::streambuf* b);
+	// When raw is true the input is a bare deflate stream without
+	// the zlib header and checksum
+	zlib_filter(std::streambuf* b, bool raw=false);
 	~zlib_filter();
 };
 
@@ -73,13 +77,60 @@ private:
 	lzma_stream strm;
 	// Temporary buffer for data before it is uncompressed
 	uint8_t compressed_buffer[BUFFER_LENGTH];
+	// Uncompressed bytes left when the header records the size.
+	// The data may still end with an end marker, which is not read
+	uint64_t remaining;
 protected:
 	virtual int fillBuffer();
 public:
-	liblzma_filter(std::streambuf* b);
+	// When swfHeader is true the input uses the SWF layout (length
+	// and properties without the uncompressed size), otherwise it is
+	// a standard lzma_alone stream
+	liblzma_filter(std::streambuf* b, bool swfHeader=true);
 	~liblzma_filter();
 };
 
+// Runs an uncompressing_filter on a thread of its own, ahead of the
+// reader.
+//
+// The worker fills a ring buffer of uncompressed bytes while the reader
+// consumes them, so inflating overlaps with parsing. The bytes exposed
+// to the reader are only given back to the worker on the next
+// underflow. Errors raised by the source are rethrown to the reader as
+// ParseException.
+class pipelined_filter: public std::streambuf
+{
+private:
+	static const unsigned int CHUNK_LENGTH = 65536;
+	// Owned by this filter
+	uncompressing_filter* source;
+	char* ring;
+	size_t ringSize;
+	lightspark::Mutex mutex;
+	lightspark::Cond dataAvailable;
+	lightspark::Cond spaceAvailable;
+	// Total bytes written by the worker and given back by the reader
+	uint64_t produced;
+	uint64_t released;
+	// Offset of the first uncompressed byte in the source stream
+	uint64_t base;
+	bool eof;
+	bool stopped;
+	std::string error;
+	lightspark::Thread* t;
+	void worker();
+protected:
+	virtual int underflow();
+	virtual std::streampos seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode);
+public:
+	pipelined_filter(uncompressing_filter* s, size_t size);
+	~pipelined_filter();
+	// Aborts the worker and waits for it. If the worker is blocked
+	// reading the source, the owner of the underlying stream has to
+	// terminate it (e.g. by stopping the Downloader) to wake it up
+	void stop();
+};
+
 class bytes_buf:public std::streambuf
 {
 private:
@@ -91,6 +142,55 @@ public:
 	virtual pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode);
 };
 
+// A read-only memory mapping of a local file, exposed as a streambuf.
+//
+// The parser reads directly from the mapped pages instead of copying
+// every byte through a filebuf. This object must outlive any stream
+// using it, the payloads taken with stream_bytes keep their own
+// reference to the mapping.
+class mapped_file_buf:public bytes_buf
+{
+private:
+	GMappedFile* mapping;
+	mapped_file_buf(GMappedFile* m);
+public:
+	// Returns NULL if the file can not be mapped
+	static mapped_file_buf* open(const char* fileName);
+	~mapped_file_buf();
+	uint32_t size() const;
+	GMappedFile* getMapping() const { return mapping; }
+	// Returns the next n bytes of the mapping and skips them, or
+	// NULL if less than n bytes are left
+	const uint8_t* consume(size_t n);
+};
+
+// A block of bytes read from a stream.
+//
+// If the stream reads from a mapped_file_buf the bytes are not
+// copied: they point into the mapping, which is kept alive until
+// the block is cleared. Otherwise they are read into a private copy.
+class stream_bytes
+{
+private:
+	GMappedFile* mapping;
+	std::vector<uint8_t> copy;
+	const uint8_t* ptr;
+	size_t len;
+	stream_bytes(const stream_bytes&);
+	stream_bytes& operator=(const stream_bytes&);
+public:
+	stream_bytes();
+	~stream_bytes();
+	// Reads n bytes, errors are reported by the stream as for
+	// istream::read
+	void read(std::istream& in, size_t n);
+	void clear();
+	void swap(stream_bytes& r);
+	const uint8_t* data() const { return ptr; }
+	size_t size() const { return len; }
+	bool empty() const { return len==0; }
+};
+
 // A lightweight, istream-like interface for reading from a memory
 // buffer.
 // 
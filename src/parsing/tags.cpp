@@ -24,11 +24,6 @@
 #include <list>
 #include <algorithm>
 #include <sstream>
-#ifdef __MINGW32__
-#include <malloc.h>
-#else
-#include <alloca.h>
-#endif
 #include "scripting/abc.h"
 #include "parsing/tags.h"
 #include "backends/geometry.h"
@@ -42,6 +37,7 @@
 #include "scripting/flash/text/flashtext.h"
 #include "scripting/flash/media/flashmedia.h"
 #include "backends/audio.h"
+#include "backends/assetcache.h"
 
 #undef RGB
 
@@ -56,6 +52,18 @@ using namespace lightspark;
 uint8_t* JPEGTablesTag::JPEGTables = NULL;
 int JPEGTablesTag::tableSize = 0;
 
+/*
+ * Loads the tokens of a shape or text tag from the asset bundle of its
+ * file. Only the first definition of an id is stored in the bundle
+ */
+static bool loadTokensFromBundle(const DictionaryTag* tag, std::vector<GeomToken>& tokens)
+{
+	RootMovieClip* root=tag->loadedFrom;
+	if(root->assetBundle.isNull() || root->dictionaryLookup(tag->getId())!=tag)
+		return false;
+	return root->assetBundle->loadTokens(tag->getId(),root,tokens);
+}
+
 Tag* TagFactory::readTag(RootMovieClip* root)
 {
 	RECORDHEADER h;
@@ -279,6 +287,11 @@ void RemoveObject2Tag::execute(DisplayObjectContainer* parent) const
 	parent->deleteLegacyChildAt(Depth);
 }
 
+void RemoveObject2Tag::updateSnapshot(DisplayListSnapshot& snapshot) const
+{
+	snapshot.remove(Depth);
+}
+
 SetBackgroundColorTag::SetBackgroundColorTag(RECORDHEADER h, std::istream& in):ControlTag(h)
 {
 	in >> BackgroundColor;
@@ -428,6 +441,16 @@ DefineSpriteTag::~DefineSpriteTag()
 		it->destroyTags();
 }
 
+void DefineSpriteTag::requestDecoding() const
+{
+	//Only the first frame of the sprite is needed to display it
+	if(frames.empty())
+		return;
+	const std::list<const DisplayListTag*>& blueprint=frames.front().blueprint;
+	for(auto it=blueprint.begin();it!=blueprint.end();++it)
+		(*it)->requestDecoding();
+}
+
 ASObject* DefineSpriteTag::instance(Class_base* c) const
 {
 	Class_base* retClass=NULL;
@@ -761,29 +784,134 @@ ASObject* DefineFont4Tag::instance(Class_base* c) const
 	return ret;
 }
 
-BitmapTag::BitmapTag(RECORDHEADER h,RootMovieClip* root):DictionaryTag(h,root),bitmap(_MR(new BitmapContainer(getSys()->tagsMemory)))
+BitmapDecoder::BitmapDecoder(_R<BitmapContainer> b):status(PENDING),id(0),bitmap(b)
 {
 }
 
-_R<BitmapContainer> BitmapTag::getBitmap() const {
-	return bitmap;
+void BitmapDecoder::run()
+{
+	try
+	{
+		if(assetBundle.isNull() || !assetBundle->loadBitmap(id,bitmap.getPtr()))
+			decode();
+	}
+	catch(std::exception& e)
+	{
+		LOG(LOG_ERROR,"Exception while decoding bitmap: " << e.what());
+	}
+	Locker l(mutex);
+	status=DONE;
+	decoded.broadcast();
 }
 
-DefineBitsLosslessTag::DefineBitsLosslessTag(RECORDHEADER h, istream& in, int version, RootMovieClip* root):BitmapTag(h,root),BitmapColorTableSize(0)
+void BitmapDecoder::execute()
 {
-	int dest=in.tellg();
-	dest+=h.getLength();
-	in >> CharacterId >> BitmapFormat >> BitmapWidth >> BitmapHeight;
+	{
+		Locker l(mutex);
+		//The data may have been decoded already by a waiting thread
+		if(status!=PENDING)
+			return;
+		status=RUNNING;
+	}
+	run();
+}
 
-	if(BitmapFormat==LOSSLESS_BITMAP_PALETTE)
-		in >> BitmapColorTableSize;
+void BitmapDecoder::jobFence()
+{
+	decRef();
+}
 
-	string cData;
-	size_t cSize = dest-in.tellg(); //rest of this tag
-	cData.resize(cSize);
-	in.read(&cData[0], cSize);
-	istringstream cDataStream(cData);
-	zlib_filter zf(cDataStream.rdbuf());
+void BitmapDecoder::wait()
+{
+	Locker l(mutex);
+	if(status==PENDING)
+	{
+		//The parser only queues decoders, decoding there would
+		//serialize the bitmaps of the first frame
+		assert(!isParseThread());
+		status=RUNNING;
+		l.release();
+		run();
+		return;
+	}
+	while(status!=DONE)
+		decoded.wait(mutex);
+}
+
+class JPEGDecoder: public BitmapDecoder
+{
+private:
+	stream_bytes data;
+	const uint8_t* tables;
+	int tablesLen;
+	//zlib compressed alpha channel of DefineBitsJPEG3
+	stream_bytes alpha;
+protected:
+	void decode();
+public:
+	JPEGDecoder(_R<BitmapContainer> b, stream_bytes& d, const uint8_t* t=NULL, int tl=0):
+		BitmapDecoder(b),tables(t),tablesLen(tl)
+	{
+		data.swap(d);
+	}
+	void setAlpha(stream_bytes& a) { alpha.swap(a); }
+};
+
+void JPEGDecoder::decode()
+{
+	//TODO: check header. Could also be PNG or GIF
+	if(data.empty())
+		return;
+	bitmap->fromJPEG(data.data(),data.size(),tables,tablesLen);
+	data.clear();
+	if(alpha.empty())
+		return;
+
+	bytes_buf alphaBuf(alpha.data(),alpha.size());
+	zlib_filter zf(&alphaBuf);
+	istream zfstream(&zf);
+	zfstream.exceptions ( istream::eofbit | istream::failbit | istream::badbit );
+
+	//Catch the exception if the stream ends
+	try
+	{
+		//Set alpha
+		for(int32_t i=0;i<bitmap->getHeight();i++)
+		{
+			for(int32_t j=0;j<bitmap->getWidth();j++)
+				bitmap->setAlpha(i, j, zfstream.get());
+		}
+	}
+	catch(std::exception& e)
+	{
+		LOG(LOG_ERROR, "Exception while parsing Alpha data in DefineBitsJPEG3");
+	}
+	alpha.clear();
+}
+
+class LosslessDecoder: public BitmapDecoder
+{
+private:
+	stream_bytes cData;
+	uint8_t BitmapFormat;
+	uint16_t BitmapWidth;
+	uint16_t BitmapHeight;
+	uint8_t BitmapColorTableSize;
+	int version;
+protected:
+	void decode();
+public:
+	LosslessDecoder(_R<BitmapContainer> b, stream_bytes& d, uint8_t f, uint16_t w, uint16_t h, uint8_t c, int v):
+		BitmapDecoder(b),BitmapFormat(f),BitmapWidth(w),BitmapHeight(h),BitmapColorTableSize(c),version(v)
+	{
+		cData.swap(d);
+	}
+};
+
+void LosslessDecoder::decode()
+{
+	bytes_buf cDataBuf(cData.data(),cData.size());
+	zlib_filter zf(&cDataBuf);
 	istream zfstream(&zf);
 
 	if (BitmapFormat == LOSSLESS_BITMAP_RGB15 ||
@@ -829,14 +957,80 @@ DefineBitsLosslessTag::DefineBitsLosslessTag(RECORDHEADER h, istream& in, int ve
 		bitmap->fromPalette(pixelData, BitmapWidth, BitmapHeight, stride, palette, numColors, paletteBPP);
 		delete[] inData;
 	}
+	cData.clear();
+}
+
+BitmapTag::BitmapTag(RECORDHEADER h,RootMovieClip* root):DictionaryTag(h,root),decoder(NULL),decodeQueued(false),bitmap(_MR(new BitmapContainer(getSys()->tagsMemory)))
+{
+}
+
+BitmapTag::~BitmapTag()
+{
+	//A pool thread may still be decoding, it keeps its own reference
+	if(decoder)
+		decoder->decRef();
+}
+
+void BitmapTag::decodeAsync(BitmapDecoder* d)
+{
+	decoder=d;
+	if(!loadedFrom->assetBundle.isNull())
+		decoder->setAssetBundle(loadedFrom->assetBundle,getId());
+	ParseThread* pt=getParseThread();
+	if(pt->isParsingFirstFrame())
+		pt->deferDecoding(this);
 	else
+		requestDecoding();
+}
+
+void BitmapTag::requestDecoding() const
+{
+	if(decoder==NULL || decodeQueued)
+		return;
+	decodeQueued=true;
+	//The reference is released by jobFence
+	decoder->incRef();
+	getSys()->addJob(decoder);
+}
+
+void BitmapTag::waitDecoded() const
+{
+	if(decoder)
+		decoder->wait();
+}
+
+_R<BitmapContainer> BitmapTag::getBitmap() const {
+	waitDecoded();
+	return bitmap;
+}
+
+DefineBitsLosslessTag::DefineBitsLosslessTag(RECORDHEADER h, istream& in, int version, RootMovieClip* root):BitmapTag(h,root),BitmapColorTableSize(0)
+{
+	int dest=in.tellg();
+	dest+=h.getLength();
+	in >> CharacterId >> BitmapFormat >> BitmapWidth >> BitmapHeight;
+
+	if(BitmapFormat==LOSSLESS_BITMAP_PALETTE)
+		in >> BitmapColorTableSize;
+
+	//Only the compressed data is read here, it is inflated on the ThreadPool
+	size_t cSize = dest-in.tellg(); //rest of this tag
+	stream_bytes cData;
+	cData.read(in, cSize);
+
+	if (BitmapFormat != LOSSLESS_BITMAP_RGB15 &&
+	    BitmapFormat != LOSSLESS_BITMAP_RGB24 &&
+	    BitmapFormat != LOSSLESS_BITMAP_PALETTE)
 	{
 		LOG(LOG_NOT_IMPLEMENTED,"DefineBitsLossless(2)Tag with unsupported BitmapFormat " << BitmapFormat);
+		return;
 	}
+	decodeAsync(new LosslessDecoder(bitmap, cData, BitmapFormat, BitmapWidth, BitmapHeight, BitmapColorTableSize, version));
 }
 
 ASObject* BitmapTag::instance(Class_base* c) const
 {
+	waitDecoded();
 	//Flex imports bitmaps using BitmapAsset as the base class, which is derived from bitmap
 	//Also BitmapData is used in the wild though, so support both cases
 
@@ -862,7 +1056,7 @@ ASObject* BitmapTag::instance(Class_base* c) const
 }
 
 DefineTextTag::DefineTextTag(RECORDHEADER h, istream& in, RootMovieClip* root,int v):DictionaryTag(h,root),
-	tokens(reporter_allocator<GeomToken>(getSys()->tagsMemory)),version(v)
+	version(v)
 {
 	in >> CharacterId >> TextBounds >> TextMatrix >> GlyphBits >> AdvanceBits;
 	assert(v==1 || v==2);
@@ -886,7 +1080,7 @@ ASObject* DefineTextTag::instance(Class_base* c) const
 	/* we cannot call computeCached in the constructor
 	 * because loadedFrom is not available there for dictionary lookups
 	 */
-	if(tokens.empty())
+	if(tokens.isNull())
 		computeCached();
 
 	if(c==NULL)
@@ -898,9 +1092,17 @@ ASObject* DefineTextTag::instance(Class_base* c) const
 
 void DefineTextTag::computeCached() const
 {
-	if(!tokens.empty())
+	if(!tokens.isNull())
 		return;
 
+	_R<ShapeTokens> cached=_MR(new ShapeTokens);
+	if(!loadTokensFromBundle(this,cached->tokens))
+		buildTokens(cached->tokens);
+	tokens=cached;
+}
+
+void DefineTextTag::buildTokens(std::vector<GeomToken>& ret) const
+{
 	const FontTag* curFont = NULL;
 	std::list<FILLSTYLE> fillStyles;
 	Vector2 curPos;
@@ -965,37 +1167,62 @@ void DefineTextTag::computeCached() const
 			//Apply glyphMatrix first, then scaledTextMatrix
 			glyphMatrix = scaledTextMatrix.multiplyMatrix(glyphMatrix);
 
-			TokenContainer::FromShaperecordListToShapeVector(sr,tokens,fillStyles,glyphMatrix);
+			TokenContainer::FromShaperecordListToShapeVector(sr,ret,fillStyles,glyphMatrix);
 			curPos.x += ge.GlyphAdvance;
 		}
 	}
 }
 
-DefineShapeTag::DefineShapeTag(RECORDHEADER h,int v,RootMovieClip* root):DictionaryTag(h,root),Shapes(v),
-	tokens(reporter_allocator<GeomToken>(getSys()->tagsMemory))
+DefineShapeTag::DefineShapeTag(RECORDHEADER h,int v,RootMovieClip* root):DictionaryTag(h,root),Shapes(v)
 {
 }
 
-DefineShapeTag::DefineShapeTag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DictionaryTag(h,root),Shapes(1),
-	tokens(reporter_allocator<GeomToken>(getSys()->tagsMemory))
+DefineShapeTag::DefineShapeTag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DictionaryTag(h,root),Shapes(1)
 {
 	LOG(LOG_TRACE,_("DefineShapeTag"));
 	in >> ShapeId >> ShapeBounds >> Shapes;
-	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles);
+}
+
+ASObject* DefineShapeTag::instance(Class_base* c) const
+{
+	if(tokens.isNull())
+	{
+		_R<ShapeTokens> cached=_MR(new ShapeTokens);
+		if(!loadTokensFromBundle(this,cached->tokens))
+			buildTokens(cached->tokens);
+		//Bitmap fills are decoded on the ThreadPool since the tag was parsed,
+		//they must be ready before the shape is rendered
+		for(auto it=cached->tokens.begin();it!=cached->tokens.end();++it)
+		{
+			if(it->type==SET_FILL && it->fillStyle.bitmapTag)
+				it->fillStyle.bitmapTag->waitDecoded();
+			else if(it->type==SET_STROKE && it->lineStyle.FillType.bitmapTag)
+				it->lineStyle.FillType.bitmapTag->waitDecoded();
+		}
+		tokens=cached;
+	}
+
+	if(c==NULL)
+		c=Class<Shape>::getClass();
+	Shape* ret=new (c->memoryAccount) Shape(c, tokens, 1.0f/20.0f);
+	return ret;
+}
+
+void DefineShapeTag::buildTokens(std::vector<GeomToken>& ret) const
+{
+	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,ret,Shapes.FillStyles.FillStyles);
 }
 
 DefineShape2Tag::DefineShape2Tag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DefineShapeTag(h,2,root)
 {
 	LOG(LOG_TRACE,_("DefineShape2Tag"));
 	in >> ShapeId >> ShapeBounds >> Shapes;
-	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles);
 }
 
 DefineShape3Tag::DefineShape3Tag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DefineShape2Tag(h,3,root)
 {
 	LOG(LOG_TRACE,"DefineShape3Tag");
 	in >> ShapeId >> ShapeBounds >> Shapes;
-	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles);
 }
 
 DefineShape4Tag::DefineShape4Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):DefineShape3Tag(h,4,root)
@@ -1008,7 +1235,6 @@ DefineShape4Tag::DefineShape4Tag(RECORDHEADER h, std::istream& in, RootMovieClip
 	UsesNonScalingStrokes=UB(1,bs);
 	UsesScalingStrokes=UB(1,bs);
 	in >> Shapes;
-	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles);
 }
 
 DefineMorphShapeTag::DefineMorphShapeTag(RECORDHEADER h, std::istream& in, RootMovieClip* root):DictionaryTag(h, root),
@@ -1249,6 +1475,24 @@ void PlaceObject2Tag::execute(DisplayObjectContainer* parent) const
 	}
 }
 
+/* Mirrors the cases handled by execute */
+void PlaceObject2Tag::requestDecoding() const
+{
+	if(placedTag)
+		placedTag->requestDecoding();
+}
+
+void PlaceObject2Tag::updateSnapshot(DisplayListSnapshot& snapshot) const
+{
+	if(ClipDepth!=0)
+		return;
+
+	if(PlaceFlagHasCharacter)
+		snapshot.place(Depth,this,PlaceFlagMove);
+	else if(PlaceFlagMove)
+		snapshot.move(Depth,this);
+}
+
 PlaceObject2Tag::PlaceObject2Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):DisplayListTag(h),placedTag(NULL)
 {
 	LOG(LOG_TRACE,_("PlaceObject2"));
@@ -1505,15 +1749,15 @@ DefineBinaryDataTag::DefineBinaryDataTag(RECORDHEADER h,std::istream& s,RootMovi
 	int size=h.getLength();
 	s >> Tag >> Reserved;
 	size -= sizeof(Tag)+sizeof(Reserved);
-	bytes=new uint8_t[size];
-	len=size;
-	s.read((char*)bytes,size);
+	bytes.read(s,size);
 }
 
 ASObject* DefineBinaryDataTag::instance(Class_base* c) const
 {
+	//The ByteArray is writable, so it can not share the mapped bytes
+	uint32_t len=bytes.size();
 	uint8_t* b = new uint8_t[len];
-	memcpy(b,bytes,len);
+	memcpy(b,bytes.data(),len);
 
 	Class_base* classRet = NULL;
 	if(c)
@@ -1541,7 +1785,60 @@ FileAttributesTag::FileAttributesTag(RECORDHEADER h, std::istream& in):Tag(h)
 	UB(24,bs);
 }
 
-DefineSoundTag::DefineSoundTag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DictionaryTag(h,root),SoundData(new MemoryStreamCache)
+/*
+ * The data of an embedded sound. It is complete when the tag is
+ * parsed, and when the file is mapped it is not copied.
+ */
+class SoundDataCache: public StreamCache
+{
+private:
+	class Reader: public std::streambuf
+	{
+	private:
+		_R<SoundDataCache> cache;
+		virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode mode)
+		{
+			if(dir==std::ios_base::cur)
+				off+=gptr()-eback();
+			else if(dir==std::ios_base::end)
+				off+=egptr()-eback();
+			return seekpos(off,mode);
+		}
+		virtual pos_type seekpos(pos_type pos, std::ios_base::openmode mode)
+		{
+			if(mode!=std::ios_base::in || pos<0 || pos>egptr()-eback())
+				return -1;
+			setg(eback(),eback()+pos,egptr());
+			return pos;
+		}
+	public:
+		Reader(_R<SoundDataCache> c):cache(c)
+		{
+			char* b=(char*)cache->bytes.data();
+			setg(b,b,b+cache->getReceivedLength());
+		}
+	};
+	stream_bytes bytes;
+	void handleAppend(const unsigned char* buffer, size_t length)
+	{
+		assert(false && "SoundDataCache is read from the tag");
+	}
+public:
+	SoundDataCache(istream& in, size_t length)
+	{
+		bytes.read(in,length);
+		//The stream reports how much it could actually read
+		receivedLength=in ? bytes.size() : in.gcount();
+		markFinished();
+	}
+	std::streambuf* createReader()
+	{
+		incRef();
+		return new Reader(_MR(this));
+	}
+};
+
+DefineSoundTag::DefineSoundTag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DictionaryTag(h,root)
 {
 	LOG(LOG_TRACE,_("DefineSound Tag"));
 	in >> SoundId;
@@ -1552,12 +1849,12 @@ DefineSoundTag::DefineSoundTag(RECORDHEADER h, std::istream& in,RootMovieClip* r
 	SoundType=UB(1,bs);
 	in >> SoundSampleCount;
 
-	//TODO: get rid of the temporary copy
 	unsigned int soundDataLength = h.getLength()-7;
-	unsigned char *tmp = (unsigned char *)alloca(soundDataLength);
-	in.read((char *)tmp, soundDataLength);
-	SoundData->append(tmp, in.gcount());
-	SoundData->markFinished();
+	SoundData=_MNR(new SoundDataCache(in, soundDataLength));
+
+	//The sample count comes from the file, don't let it overflow
+	uint64_t decodedSize=uint64_t(SoundSampleCount)*getChannels()*2;
+	decodedSound=_MNR(new DecodedSound(min(decodedSize,(uint64_t)UINT32_MAX)));
 }
 
 ASObject* DefineSoundTag::instance(Class_base* c) const
@@ -1571,7 +1868,7 @@ ASObject* DefineSoundTag::instance(Class_base* c) const
 		retClass=Class<Sound>::getClass();
 
 	return new (retClass->memoryAccount) Sound(retClass, SoundData,
-		AudioFormat(getAudioCodec(), getSampleRate(), getChannels()));
+		AudioFormat(getAudioCodec(), getSampleRate(), getChannels()), decodedSound);
 }
 
 LS_AUDIO_CODEC DefineSoundTag::getAudioCodec() const
@@ -1603,11 +1900,16 @@ int DefineSoundTag::getChannels() const
 	return (int)SoundType + 1;
 }
 
-_R<MemoryStreamCache> DefineSoundTag::getSoundData() const
+_R<StreamCache> DefineSoundTag::getSoundData() const
 {
 	return SoundData;
 }
 
+_NR<DecodedSound> DefineSoundTag::getDecodedSound() const
+{
+	return decodedSound;
+}
+
 std::streambuf *DefineSoundTag::createSoundStream() const
 {
 	return SoundData->createReader();
@@ -1641,7 +1943,8 @@ void StartSoundTag::play(const DefineSoundTag *soundTag) const
 		soundTag->getSoundData(),
 		AudioFormat(soundTag->getAudioCodec(),
 			    soundTag->getSampleRate(),
-			    soundTag->getChannels()));
+			    soundTag->getChannels()),
+		soundTag->getDecodedSound());
 
 	// SoundChannel thread keeps one reference, which will be
 	// removed thread is finished
@@ -1754,10 +2057,10 @@ DefineBitsTag::DefineBitsTag(RECORDHEADER h, std::istream& in,RootMovieClip* roo
 	in >> CharacterId;
 	//Read image data
 	int dataSize=Header.getLength()-2;
-	uint8_t *inData=new(nothrow) uint8_t[dataSize];
-	in.read((char*)inData,dataSize);
-	bitmap->fromJPEG(inData,dataSize,JPEGTablesTag::getJPEGTables(),JPEGTablesTag::getJPEGTableSize());
-	delete[] inData;
+	stream_bytes inData;
+	inData.read(in,dataSize);
+	//The tables are never freed, so the decoder can keep a pointer
+	decodeAsync(new JPEGDecoder(bitmap,inData,JPEGTablesTag::getJPEGTables(),JPEGTablesTag::getJPEGTableSize()));
 }
 
 DefineBitsJPEG2Tag::DefineBitsJPEG2Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):BitmapTag(h,root)
@@ -1766,59 +2069,30 @@ DefineBitsJPEG2Tag::DefineBitsJPEG2Tag(RECORDHEADER h, std::istream& in, RootMov
 	in >> CharacterId;
 	//Read image data
 	int dataSize=Header.getLength()-2;
-	uint8_t* inData=new(nothrow) uint8_t[dataSize];
-	in.read((char*)inData,dataSize);
-
-	bitmap->fromJPEG(inData,dataSize);
-	delete[] inData;
+	stream_bytes inData;
+	inData.read(in,dataSize);
+	decodeAsync(new JPEGDecoder(bitmap,inData));
 }
 
-DefineBitsJPEG3Tag::DefineBitsJPEG3Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):BitmapTag(h,root),alphaData(NULL)
+DefineBitsJPEG3Tag::DefineBitsJPEG3Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):BitmapTag(h,root)
 {
 	LOG(LOG_TRACE,_("DefineBitsJPEG3Tag Tag"));
 	UI32_SWF dataSize;
 	in >> CharacterId >> dataSize;
 	//Read image data
-	uint8_t* inData=new(nothrow) uint8_t[dataSize];
-	in.read((char*)inData,dataSize);
-
-	//TODO: check header. Could also be PNG or GIF
-	bitmap->fromJPEG(inData,dataSize);
-	delete[] inData;
+	stream_bytes inData;
+	inData.read(in,dataSize);
+	JPEGDecoder* jpegDecoder=new JPEGDecoder(bitmap,inData);
 
 	//Read alpha data (if any)
 	int alphaSize=Header.getLength()-dataSize-6;
 	if(alphaSize>0) //If less that 0 the consistency check on tag size will stop later
 	{
-		//Create a zlib filter
-		string alphaData;
-		alphaData.resize(alphaSize);
-		in.read(&alphaData[0], alphaSize);
-		istringstream alphaStream(alphaData);
-		zlib_filter zf(alphaStream.rdbuf());
-		istream zfstream(&zf);
-		zfstream.exceptions ( istream::eofbit | istream::failbit | istream::badbit );
-
-		//Catch the exception if the stream ends
-		try
-		{
-			//Set alpha
-			for(int32_t i=0;i<bitmap->getHeight();i++)
-			{
-				for(int32_t j=0;j<bitmap->getWidth();j++)
-					bitmap->setAlpha(i, j, zfstream.get());
-			}
-		}
-		catch(std::exception& e)
-		{
-			LOG(LOG_ERROR, "Exception while parsing Alpha data in DefineBitsJPEG3");
-		}
+		stream_bytes alphaData;
+		alphaData.read(in, alphaSize);
+		jpegDecoder->setAlpha(alphaData);
 	}
-}
-
-DefineBitsJPEG3Tag::~DefineBitsJPEG3Tag()
-{
-	delete[] alphaData;
+	decodeAsync(jpegDecoder);
 }
 
 DefineSceneAndFrameLabelDataTag::DefineSceneAndFrameLabelDataTag(RECORDHEADER h, std::istream& in):ControlTag(h)
@@ -24,13 +24,17 @@
 #include <vector>
 #include <iostream>
 #include "swftypes.h"
+#include "parsing/streams.h"
 #include "backends/geometry.h"
+#include "backends/assetcache.h"
 #include "scripting/flash/utils/flashutils.h"
 #include "scripting/class.h"
 
 namespace lightspark
 {
 
+class DisplayListSnapshot;
+
 enum TAGTYPE {TAG=0,DISPLAY_LIST_TAG,SHOW_TAG,CONTROL_TAG,DICT_TAG,FRAMELABEL_TAG,SYMBOL_CLASS_TAG,ACTION_TAG,ABC_TAG,END_TAG};
 
 void ignore(std::istream& i, int count);
@@ -62,6 +66,10 @@ public:
 	DisplayListTag(RECORDHEADER h):Tag(h){}
 	virtual TAGTYPE getType() const{ return DISPLAY_LIST_TAG; }
 	virtual void execute(DisplayObjectContainer* parent) const=0;
+	//Records the effect execute would have on the legacy children
+	virtual void updateSnapshot(DisplayListSnapshot& snapshot) const=0;
+	//Starts decoding the assets this tag displays, see DictionaryTag::requestDecoding
+	virtual void requestDecoding() const {}
 };
 
 class DictionaryTag: public Tag
@@ -80,6 +88,11 @@ public:
 	virtual TAGTYPE getType()const{ return DICT_TAG; }
 	virtual int getId() const=0;
 	virtual ASObject* instance(Class_base* c=NULL) const { return NULL; };
+	/*
+	   Queues the decoding of the tag's assets (and of the tags it
+	   displays) if it has been held back while parsing the first frame
+	*/
+	virtual void requestDecoding() const {}
 };
 
 /*
@@ -111,19 +124,16 @@ protected:
 	UI16_SWF ShapeId;
 	RECT ShapeBounds;
 	SHAPEWITHSTYLE Shapes;
-	/* tokens are computed from Shapes */
-	tokensVector tokens;
+	/* tokens are computed from Shapes (or loaded from the asset
+	 * bundle) on the first instance, and shared by all the instances */
+	mutable _NR<ShapeTokens> tokens;
 	DefineShapeTag(RECORDHEADER h,int v,RootMovieClip* root);
 public:
 	DefineShapeTag(RECORDHEADER h,std::istream& in, RootMovieClip* root);
 	virtual int getId() const{ return ShapeId; }
-	ASObject* instance(Class_base* c=NULL) const
-	{
-		if(c==NULL)
-			c=Class<Shape>::getClass();
-		Shape* ret=new (c->memoryAccount) Shape(c, tokens, 1.0f/20.0f);
-		return ret;
-	}
+	ASObject* instance(Class_base* c=NULL) const;
+	//Only reads the parsed records, so it may run on any thread
+	void buildTokens(std::vector<GeomToken>& ret) const;
 };
 
 class DefineShape2Tag: public DefineShapeTag
@@ -223,7 +233,8 @@ public:
 	ASObject* instance(Class_base* c=NULL) const;
 };
 
-class MemoryStreamCache;
+class StreamCache;
+class DecodedSound;
 
 class DefineSoundTag: public DictionaryTag
 {
@@ -234,7 +245,9 @@ private:
 	char SoundSize;
 	char SoundType;
 	UI32_SWF SoundSampleCount;
-	_R<MemoryStreamCache> SoundData;
+	_NR<StreamCache> SoundData;
+	//Shared by all the playbacks of the sound
+	_NR<DecodedSound> decodedSound;
 public:
 	DefineSoundTag(RECORDHEADER h, std::istream& s, RootMovieClip* root);
 	virtual int getId() const { return SoundId; }
@@ -242,7 +255,8 @@ public:
 	LS_AUDIO_CODEC getAudioCodec() const;
 	int getSampleRate() const;
 	int getChannels() const;
-	_R<MemoryStreamCache> getSoundData() const;
+	_R<StreamCache> getSoundData() const;
+	_NR<DecodedSound> getDecodedSound() const;
 	std::streambuf *createSoundStream() const;
 };
 
@@ -290,6 +304,7 @@ private:
 public:
 	RemoveObject2Tag(RECORDHEADER h, std::istream& in);
 	void execute(DisplayObjectContainer* parent) const;
+	void updateSnapshot(DisplayListSnapshot& snapshot) const;
 };
 
 class PlaceObject2Tag: public DisplayListTag
@@ -317,6 +332,8 @@ public:
 	STRING Name;
 	PlaceObject2Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root);
 	void execute(DisplayObjectContainer* parent) const;
+	void updateSnapshot(DisplayListSnapshot& snapshot) const;
+	void requestDecoding() const;
 };
 
 class PlaceObject3Tag: public PlaceObject2Tag
@@ -382,11 +399,9 @@ class DefineBinaryDataTag: public DictionaryTag
 private:
 	UI16_SWF Tag;
 	UI32_SWF Reserved;
-	uint8_t* bytes;
-	uint32_t len;
+	stream_bytes bytes;
 public:
 	DefineBinaryDataTag(RECORDHEADER h,std::istream& s,RootMovieClip* root);
-	~DefineBinaryDataTag() { delete[] bytes; }
 	virtual int getId() const {return Tag;}
 	ASObject* instance(Class_base* c=NULL) const;
 };
@@ -513,13 +528,15 @@ private:
 	UI8 GlyphBits;
 	UI8 AdvanceBits;
 	std::vector < TEXTRECORD > TextRecords;
-	mutable tokensVector tokens;
+	mutable _NR<ShapeTokens> tokens;
 	void computeCached() const;
 public:
 	int version;
 	DefineTextTag(RECORDHEADER h, std::istream& in,RootMovieClip* root,int v=1);
 	int getId() const { return CharacterId; }
 	ASObject* instance(Class_base* c=NULL) const;
+	//Only reads the parsed records and fonts, so it may run on any thread
+	void buildTokens(std::vector<GeomToken>& ret) const;
 };
 
 class DefineText2Tag: public DefineTextTag
@@ -538,6 +555,7 @@ public:
 	~DefineSpriteTag();
 	virtual int getId() const { return SpriteID; }
 	virtual ASObject* instance(Class_base* c=NULL) const;
+	void requestDecoding() const;
 };
 
 class ProtectTag: public ControlTag
@@ -549,14 +567,60 @@ public:
 
 class BitmapContainer;
 
+/*
+ * Decodes the pixels of a bitmap tag on the ThreadPool, so that parsing goes
+ * on while images are decompressed. The decoder owns the compressed data and
+ * a reference to the target container, it never accesses the tag itself.
+ */
+class BitmapDecoder: public IThreadJob, public RefCountable
+{
+private:
+	enum STATUS { PENDING=0, RUNNING, DONE };
+	Mutex mutex;
+	Cond decoded;
+	STATUS status;
+	//The pixels are loaded from the bundle if it has them
+	_NR<AssetBundle> assetBundle;
+	uint32_t id;
+	void run();
+protected:
+	_R<BitmapContainer> bitmap;
+	//Fills bitmap from the compressed data, it is called exactly once
+	virtual void decode()=0;
+public:
+	BitmapDecoder(_R<BitmapContainer> b);
+	void setAssetBundle(_R<AssetBundle> a, uint32_t i) { assetBundle=a; id=i; }
+	void execute();
+	void jobFence();
+	/*
+	 * Blocks until the pixels are available. If no pool thread has taken
+	 * the job yet, the caller decodes it right away, so a busy pool never
+	 * stalls it.
+	 */
+	void wait();
+};
+
 class BitmapTag: public DictionaryTag
 {
+private:
+	BitmapDecoder* decoder;
+	//Only accessed by the parsing thread
+	mutable bool decodeQueued;
 protected:
         _R<BitmapContainer> bitmap;
+	/* Takes ownership of d and queues it on the ThreadPool. While the
+	 * first frame is parsed, it is queued only once that frame places
+	 * the tag, a shape uses it as a fill, or the frame has been committed */
+	void decodeAsync(BitmapDecoder* d);
 public:
 	BitmapTag(RECORDHEADER h,RootMovieClip* root);
+	~BitmapTag();
 	ASObject* instance(Class_base* c=NULL) const;
         _R<BitmapContainer> getBitmap() const;
+	//The bitmap may still be decoding, see waitDecoded
+	_R<BitmapContainer> getBitmapNoWait() const { return bitmap; }
+	void waitDecoded() const;
+	void requestDecoding() const;
 };
 
 class JPEGTablesTag: public Tag
@@ -606,10 +670,8 @@ class DefineBitsJPEG3Tag: public BitmapTag
 {
 private:
 	UI16_SWF CharacterId;
-	uint8_t* alphaData;
 public:
 	DefineBitsJPEG3Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root);
-	~DefineBitsJPEG3Tag();
 	int getId() const{ return CharacterId; }
 };
 
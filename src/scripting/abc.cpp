@@ -540,8 +540,7 @@ multiname* ABCContext::s_getMultiname_d(call_context* th, number_t rtd, int n)
 					ret->ns.push_back(nsNameAndKind(th->context, s->ns[i]));
 				}
 				sort(ret->ns.begin(),ret->ns.end());
-				ret->name_d=rtd;
-				ret->name_type=multiname::NAME_NUMBER;
+				ret->setName(rtd);
 				break;
 			}
 			default:
@@ -557,8 +556,7 @@ multiname* ABCContext::s_getMultiname_d(call_context* th, number_t rtd, int n)
 		{
 			case 0x1b:
 			{
-				ret->name_d=rtd;
-				ret->name_type=multiname::NAME_NUMBER;
+				ret->setName(rtd);
 				break;
 			}
 			default:
@@ -592,8 +590,7 @@ multiname* ABCContext::s_getMultiname_i(call_context* th, uint32_t rti, int n)
 					ret->ns.push_back(nsNameAndKind(th->context, s->ns[i]));
 				}
 				sort(ret->ns.begin(),ret->ns.end());
-				ret->name_i=rti;
-				ret->name_type=multiname::NAME_INT;
+				ret->setName((number_t)rti);
 				break;
 			}
 			default:
@@ -609,8 +606,13 @@ multiname* ABCContext::s_getMultiname_i(call_context* th, uint32_t rti, int n)
 		{
 			case 0x1b:
 			{
-				ret->name_i=rti;
-				ret->name_type=multiname::NAME_INT;
+				if(rti<=INT32_MAX)
+				{
+					ret->name_i=rti;
+					ret->name_type=multiname::NAME_INT;
+				}
+				else
+					ret->setName((number_t)rti);
 				break;
 			}
 			default:
@@ -621,6 +623,23 @@ multiname* ABCContext::s_getMultiname_i(call_context* th, uint32_t rti, int n)
 	}
 }
 
+/*
+ * Sets the runtime name part of 'ret' from the stack value 'n'.
+ * String names are looked up in the per-site cache of 'm' first,
+ * as the same key is usually used over and over from the same site.
+ */
+static void setRuntimeName(multiname_info* m, multiname* ret, ASObject* n)
+{
+	if(n->getObjectType()==T_STRING)
+	{
+		ret->resetNameIfObject();
+		ret->name_s_id=m->getRuntimeStringId(static_cast<ASString*>(n)->data);
+		ret->name_type=multiname::NAME_STRING;
+	}
+	else
+		ret->setName(n);
+}
+
 /*
  * Gets a multiname. May pop one value of the runtime stack
  * This is a helper called from interpreter.
@@ -676,6 +695,7 @@ multiname* ABCContext::getMultinameImpl(ASObject* n, ASObject* n2, unsigned int
 			ret->name_type=multiname::NAME_STRING;
 			ret->ns.emplace_back(nsNameAndKind("",NAMESPACE));
 			ret->isAttribute=false;
+			ret->isStatic=true;
 			return ret;
 		}
 		ret->isAttribute=m->isAttributeName();
@@ -688,6 +708,7 @@ multiname* ABCContext::getMultinameImpl(ASObject* n, ASObject* n2, unsigned int
 
 				ret->name_s_id=getSys()->getUniqueStringId(getString(m->name));
 				ret->name_type=multiname::NAME_STRING;
+				ret->isStatic=true;
 				break;
 			}
 			case 0x09: //Multiname
@@ -703,6 +724,7 @@ multiname* ABCContext::getMultinameImpl(ASObject* n, ASObject* n2, unsigned int
 
 				ret->name_s_id=getSys()->getUniqueStringId(getString(m->name));
 				ret->name_type=multiname::NAME_STRING;
+				ret->isStatic=true;
 				break;
 			}
 			case 0x1b: //MultinameL
@@ -745,6 +767,7 @@ multiname* ABCContext::getMultinameImpl(ASObject* n, ASObject* n2, unsigned int
 				ret->ns.push_back(nsNameAndKind(this, td->ns));
 				ret->name_s_id=getSys()->getUniqueStringId(name);
 				ret->name_type=multiname::NAME_STRING;
+				ret->isStatic=true;
 				break;
 			}
 			default:
@@ -787,7 +810,7 @@ multiname* ABCContext::getMultinameImpl(ASObject* n, ASObject* n2, unsigned int
 				ret->ns.clear();
 				ret->ns.push_back(nsNameAndKind(qname->getURI(),NAMESPACE));
 			}
-			ret->setName(n);
+			setRuntimeName(m,ret,n);
 			n->decRef();
 			break;
 		}
@@ -811,7 +834,7 @@ multiname* ABCContext::getMultinameImpl(ASObject* n, ASObject* n2, unsigned int
 			Namespace* tmpns=static_cast<Namespace*>(n2);
 			ret->ns.clear();
 			ret->ns.push_back(nsNameAndKind(tmpns->uri,NAMESPACE));
-			ret->setName(n);
+			setRuntimeName(m,ret,n);
 			n->decRef();
 			n2->decRef();
 			break;
@@ -1389,7 +1412,58 @@ bool ABCContext::isinstance(ASObject* obj, multiname* name)
 		return false;
 	}
 
-	ASObject* type=ret;
+	return isInstanceOfType(obj, ret);
+}
+
+ASObject* ABCContext::findGlobalTarget(const multiname* name)
+{
+	const uint32_t generation=ApplicationDomain::getScopesGeneration();
+	if(name->isStatic)
+	{
+		auto it=globalLookupCache.find(name);
+		//The name may have been deleted from the target since it was cached,
+		//in that case fall back to the full lookup
+		if(it!=globalLookupCache.end() && it->second.generation==generation &&
+		   it->second.target->hasPropertyByMultiname(*name, true, true))
+			return it->second.target;
+	}
+	//NOTE: The lookup also runs the script init of the target if needed, so cache
+	//hits never have to do that
+	ASObject* target;
+	ASObject* o=root->applicationDomain->getVariableAndTargetByMultiname(*name, target);
+	if(o==NULL)
+		return NULL;
+	if(name->isStatic)
+		globalLookupCache[name]=global_lookup(target,generation);
+	return target;
+}
+
+bool ABCContext::handlerCatches(ASObject* obj, exception_info& exc)
+{
+	if(!exc.resolved)
+	{
+		multiname* name=getMultiname(exc.exc_type, NULL);
+		if(exc.exc_type!=0 && name->qualifiedString() != "any")
+		{
+			ASObject* target;
+			ASObject* type=root->applicationDomain->getVariableAndTargetByMultiname(*name, target);
+			if(!type) //Could not retrieve type, try again next time
+			{
+				LOG(LOG_ERROR,_("Cannot retrieve type"));
+				return false;
+			}
+			assert_and_throw(type->getObjectType()==T_CLASS);
+			exc.excClass=static_cast<Class_base*>(type);
+		}
+		exc.resolved=true;
+	}
+	if(exc.excClass==NULL)
+		return true;
+	return isInstanceOfType(obj, exc.excClass);
+}
+
+bool ABCContext::isInstanceOfType(ASObject* obj, ASObject* type)
+{
 	bool real_ret=false;
 	Class_base* objc=obj->classdef;
 	Class_base* c=static_cast<Class_base*>(type);
@@ -2105,6 +2179,34 @@ void ABCContext::buildTrait(ASObject* obj, const traits_info* t, bool isBorrowed
 	}
 }
 
+void ABCContext::buildActivationLayout(scope_layout& l, const method_body_info* body)
+{
+	const uint32_t count=body->trait_count;
+	l.status=scope_layout::INVALID;
+	l.names.assign(count,varName(0,nsNameAndKind("",NAMESPACE)));
+	l.typenames.assign(count,NULL);
+	l.types.assign(count,NULL);
+	l.traits.assign(count,NULL);
+	for(unsigned int i=0;i<count;i++)
+	{
+		const traits_info* t=&body->traits[i];
+		uint32_t kind=t->kind&0xf;
+		if(kind!=traits_info::Slot && kind!=traits_info::Const)
+			return;
+		//Slots ids must be a permutation of 1..count
+		if(t->slot_id==0 || t->slot_id>count || l.traits[t->slot_id-1]!=NULL)
+			return;
+		multiname* mname=getMultiname(t->name,NULL);
+		if(mname->ns.size()!=1 || mname->name_type!=multiname::NAME_STRING)
+			return;
+		const uint32_t index=t->slot_id-1;
+		l.names[index]=varName(mname->normalizedNameId(),mname->ns[0]);
+		l.typenames[index]=getMultiname(t->type_name,NULL);
+		l.types[index]=Type::getBuiltinType(l.typenames[index]);
+		l.traits[index]=t;
+	}
+	l.status=scope_layout::VALID;
+}
 
 ASObject* method_info::getOptional(unsigned int i)
 {
@@ -2135,6 +2237,16 @@ ASFUNCTIONBODY(lightspark,undefinedFunction)
 }
 
 /* Multiname types that end in 'A' are attributes names */
+uint32_t multiname_info::getRuntimeStringId(const tiny_string& s)
+{
+	if(runtimeStringId==(uint32_t)-1 || runtimeString!=s)
+	{
+		runtimeString=s;
+		runtimeStringId=getSys()->getUniqueStringId(s);
+	}
+	return runtimeStringId;
+}
+
 bool multiname_info::isAttributeName() const
 {
 	switch(kind)
@@ -63,6 +63,37 @@ inline stack_entry make_stack_entry(llvm::Value* v, STACK_TYPE t)
 	return std::make_pair(v, t);
 }
 
+/*
+ * Layout of an activation or catch scope. It is computed once per method
+ * and shared by all the ActivationScope objects of the method
+ */
+struct scope_layout
+{
+	enum STATUS { NOT_BUILT=0, VALID, INVALID };
+	STATUS status;
+	//All the following are indexed by slot id - 1
+	std::vector<varName> names;
+	std::vector<multiname*> typenames;
+	std::vector<const Type*> types;
+	std::vector<const traits_info*> traits;
+	scope_layout():status(NOT_BUILT){}
+};
+
+/*
+ * State of a callproperty compiled by the JIT. The first call binds the site to the
+ * builtin method with a native binding found on its receiver, if any. Later calls to
+ * the same class object, or on objects of the same class, take the direct path like
+ * CALL_NATIVE does in the fast interpreter
+ */
+struct native_call_site
+{
+	const ASObject* receiver;
+	const Class_base* guard;
+	const Function* f;
+	bool resolved;
+	native_call_site():receiver(NULL),guard(NULL),f(NULL),resolved(false){}
+};
+
 class method_info
 {
 friend std::istream& operator>>(std::istream& in, method_info& v);
@@ -113,6 +144,11 @@ public:
 	std::vector<const Type*> paramTypes;
 	const Type* returnType;
 	bool hasExplicitTypes;
+	scope_layout activationLayout;
+	//One for each exception handler in the body
+	std::vector<scope_layout> catchLayouts;
+	//Referenced by the JITted code, so elements must never move
+	std::deque<native_call_site> nativeCallSites;
 	method_info():
 		llvmf(NULL),
 #ifdef PROFILING_SUPPORT
@@ -133,7 +169,7 @@ struct opcode_handler
 enum ARGS_TYPE { ARGS_OBJ_OBJ=0, ARGS_OBJ_INT, ARGS_OBJ, ARGS_INT, ARGS_OBJ_OBJ_INT, ARGS_NUMBER, ARGS_OBJ_NUMBER,
 	ARGS_BOOL, ARGS_INT_OBJ, ARGS_NONE, ARGS_NUMBER_OBJ, ARGS_INT_INT, ARGS_CONTEXT, ARGS_CONTEXT_INT, ARGS_CONTEXT_INT_INT,
 	ARGS_CONTEXT_INT_INT_INT, ARGS_CONTEXT_INT_INT_INT_BOOL, ARGS_CONTEXT_OBJ_OBJ_INT, ARGS_CONTEXT_OBJ, ARGS_CONTEXT_OBJ_OBJ,
-	ARGS_CONTEXT_OBJ_OBJ_OBJ, ARGS_OBJ_OBJ_OBJ_INT, ARGS_OBJ_OBJ_OBJ };
+	ARGS_CONTEXT_OBJ_OBJ_OBJ, ARGS_OBJ_OBJ_OBJ_INT, ARGS_OBJ_OBJ_OBJ, ARGS_CONTEXT_INT_NUMBER, ARGS_CONTEXT_INT_INT_OBJ_BOOL };
 
 struct typed_opcode_handler
 {
@@ -174,6 +210,17 @@ public:
 	uint32_t namespaceBaseId;
 
 	std::vector<bool> hasRunScriptInit;
+	struct global_lookup
+	{
+		ASObject* target;
+		uint32_t generation;
+		global_lookup():target(NULL),generation(0){}
+		global_lookup(ASObject* t, uint32_t g):target(t),generation(g){}
+	};
+	/* Global objects of the application domain defining static multinames of this context,
+	 * valid as long as no new script is registered (see ApplicationDomain::getScopesGeneration)
+	 * and the target still defines the name */
+	std::map<const multiname*, global_lookup> globalLookupCache;
 	/**
 		Construct and insert in the a object a given trait
 		@param obj the tarhget object
@@ -182,6 +229,11 @@ public:
 		@param deferred_initialization A pointer to a function that can be used to build the given trait later
 	*/
 	void buildTrait(ASObject* obj, const traits_info* t, bool isBorrowed, int scriptid=-1);
+	/*
+	 * Computes the layout of the activation scope of the given body. The layout is
+	 * INVALID if the traits are not all slots or constants with consecutive ids
+	 */
+	void buildActivationLayout(scope_layout& l, const method_body_info* body);
 	void runScriptInit(unsigned int scriptid, ASObject* g);
 
 	void linkTrait(Class_base* obj, const traits_info* t);
@@ -194,6 +246,17 @@ public:
 	void exec(bool lazy);
 
 	bool isinstance(ASObject* obj, multiname* name);
+	/*
+	 * Finds the global object of the application domain where name is defined,
+	 * or NULL. Lookups of static multinames are cached
+	 */
+	ASObject* findGlobalTarget(const multiname* name);
+	/*
+	 * Checks if the handler catches obj. The class of the handler is resolved
+	 * only once and cached in exc
+	 */
+	bool handlerCatches(ASObject* obj, exception_info& exc);
+	static bool isInstanceOfType(ASObject* obj, ASObject* type);
 
 	std::map<const multiname*, Class_base*> classesBeingDefined;
 
@@ -224,15 +287,19 @@ private:
 	//Interpreted AS instructions
 	//If you change a definition here, update the opcode_table_* entry in abc_codesynth
 	static bool hasNext2(call_context* th, int n, int m); 
+	//Alchemy opcodes, the domain memory is reached through the context
+	//without taking a reference to the application domain
+	static ApplicationDomain* getDomainMemoryOwner(call_context* th)
+	{
+		return th->context->root->applicationDomain.getPtr();
+	}
 	template<class T>
 	static void loadIntN(call_context* th)
 	{
 		ASObject* arg1=th->runtime_stack_pop();
 		uint32_t addr=arg1->toUInt();
 		arg1->decRef();
-		_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-		T ret=appDomain->readFromDomainMemory<T>(addr);
-		th->runtime_stack_push(abstract_ui(ret));
+		th->runtime_stack_push(abstract_i(loadIntN_i<T>(th, addr)));
 	}
 	template<class T>
 	static void storeIntN(call_context* th)
@@ -241,13 +308,67 @@ private:
 		ASObject* arg2=th->runtime_stack_pop();
 		uint32_t addr=arg1->toUInt();
 		arg1->decRef();
-		uint32_t val=arg2->toUInt();
+		int32_t val=arg2->toInt();
+		arg2->decRef();
+		storeIntN_i<T>(th, addr, val);
+	}
+	template<class T>
+	static void loadFloatN(call_context* th)
+	{
+		ASObject* arg1=th->runtime_stack_pop();
+		uint32_t addr=arg1->toUInt();
+		arg1->decRef();
+		th->runtime_stack_push(abstract_d(loadFloatN_d<T>(th, addr)));
+	}
+	template<class T>
+	static void storeFloatN(call_context* th)
+	{
+		ASObject* arg1=th->runtime_stack_pop();
+		ASObject* arg2=th->runtime_stack_pop();
+		uint32_t addr=arg1->toUInt();
+		arg1->decRef();
+		number_t val=arg2->toNumber();
 		arg2->decRef();
-		_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-		appDomain->writeToDomainMemory<T>(addr, val);
+		storeFloatN_d<T>(th, addr, val);
+	}
+	template<int bits>
+	static void signExtend(call_context* th)
+	{
+		ASObject* arg1=th->runtime_stack_pop();
+		int32_t val=arg1->toInt();
+		arg1->decRef();
+		th->runtime_stack_push(abstract_i(signExtend_i<bits>(val)));
+	}
+	//Unboxed variants, also called directly by the JIT
+	template<class T>
+	static int32_t loadIntN_i(call_context* th, uint32_t addr)
+	{
+		return getDomainMemoryOwner(th)->readFromDomainMemory<T>(addr);
+	}
+	template<class T>
+	static void storeIntN_i(call_context* th, uint32_t addr, int32_t val)
+	{
+		getDomainMemoryOwner(th)->writeToDomainMemory<T>(addr, val);
+	}
+	template<class T>
+	static number_t loadFloatN_d(call_context* th, uint32_t addr)
+	{
+		return getDomainMemoryOwner(th)->readFromDomainMemory<T>(addr);
+	}
+	template<class T>
+	static void storeFloatN_d(call_context* th, uint32_t addr, number_t val)
+	{
+		getDomainMemoryOwner(th)->writeToDomainMemory<T>(addr, val);
+	}
+	//Sign extends the lowest bits of val, as sxi1, sxi8 and sxi16 do
+	template<int bits>
+	static int32_t signExtend_i(int32_t val)
+	{
+		return ((int32_t)((uint32_t)val<<(32-bits)))>>(32-bits);
 	}
 	static void callSuper(call_context* th, int n, int m, method_info** called_mi, bool keepReturn);
 	static void callProperty(call_context* th, int n, int m, method_info** called_mi, bool keepReturn);
+	static void callPropertyNative(call_context* th, int n, int m, native_call_site* site, bool keepReturn);
 	static void callImpl(call_context* th, ASObject* f, ASObject* obj, ASObject** args, int m, method_info** called_mi, bool keepReturn);
 	static void constructProp(call_context* th, int n, int m); 
 	static void setLocal(int n); 
@@ -326,6 +447,13 @@ private:
 	static void pop();
 	static ASObject* typeOf(ASObject*);
 	static void _throw(call_context* th);
+	/*
+	 * Looks for a handler of excobj in the method being executed, using the current
+	 * position of the context. If found the context is prepared to resume at the
+	 * handler and its exec_pos is set to the handler address, otherwise false is returned.
+	 * The reference to excobj is consumed only on success
+	 */
+	static bool findExceptionHandler(const SyntheticFunction* f, call_context* th, ASObject* excobj);
 	static ASObject* asType(ABCContext* context, ASObject* obj, multiname* name);
 	static ASObject* asTypelate(ASObject* type, ASObject* obj);
 	static bool isTypelate(ASObject* type, ASObject* obj);
@@ -364,6 +492,7 @@ private:
 	static void label();
 	static void lookupswitch();
 	static int32_t convert_i(ASObject*);
+	static int32_t convert_di(number_t);
 	static uint32_t convert_u(ASObject*);
 	static number_t convert_d(ASObject*);
 	static ASObject* convert_s(ASObject*);
@@ -465,6 +594,14 @@ public:
 			const std::vector<InferenceData>& scopeStack, const multiname* name);
 	static EARLY_BIND_STATUS earlyBindForScopeStack(std::ostream& out, const SyntheticFunction* f,
 			const std::vector<InferenceData>& scopeStack, const multiname* name, InferenceData& inferredData);
+	/* Returns the builtin function called by a callproperty on base, if it has a native binding
+	 * accepting argc arguments. guard is set to the class the object must have at runtime,
+	 * or NULL if base is already known */
+	static const Function* earlyBindNativeCall(const InferenceData& base, const multiname* name, uint32_t argc,
+			const Class_base*& guard);
+	/* Returns the method of the builtin class c, or the static one if isStatic, if it
+	 * has a native binding accepting argc arguments */
+	static const Function* findNativeMethod(const Class_base* c, bool isStatic, const multiname* name, uint32_t argc);
 	static const Type* getLocalType(const SyntheticFunction* f, unsigned localIndex);
 
 	bool addEvent(_NR<EventDispatcher>,_R<Event> ) DLL_PUBLIC;
@@ -148,7 +148,11 @@ typed_opcode_handler ABCVm::opcode_table_uint32_t[]={
 	{"urShift_io",(void*)&ABCVm::urShift_io,ARGS_INT_OBJ},
 	{"getProperty_i",(void*)&ABCVm::getProperty_i,ARGS_OBJ_OBJ},
 	{"convert_i",(void*)&ABCVm::convert_i,ARGS_OBJ},
+	{"convert_di",(void*)&ABCVm::convert_di,ARGS_NUMBER},
 	{"convert_u",(void*)&ABCVm::convert_u,ARGS_OBJ},
+	{"li8",(void*)&ABCVm::loadIntN_i<uint8_t>,ARGS_CONTEXT_INT},
+	{"li16",(void*)&ABCVm::loadIntN_i<uint16_t>,ARGS_CONTEXT_INT},
+	{"li32",(void*)&ABCVm::loadIntN_i<uint32_t>,ARGS_CONTEXT_INT},
 };
 
 typed_opcode_handler ABCVm::opcode_table_number_t[]={
@@ -163,6 +167,8 @@ typed_opcode_handler ABCVm::opcode_table_number_t[]={
 	{"subtract_do",(void*)&ABCVm::subtract_do,ARGS_NUMBER_OBJ},
 	{"convert_d",(void*)&ABCVm::convert_d,ARGS_OBJ},
 	{"negate",(void*)&ABCVm::negate,ARGS_OBJ},
+	{"lf32",(void*)&ABCVm::loadFloatN_d<float>,ARGS_CONTEXT_INT},
+	{"lf64",(void*)&ABCVm::loadFloatN_d<double>,ARGS_CONTEXT_INT},
 };
 
 typed_opcode_handler ABCVm::opcode_table_void[]={
@@ -205,6 +211,7 @@ typed_opcode_handler ABCVm::opcode_table_void[]={
 	{"kill",(void*)&ABCVm::kill,ARGS_INT},
 	{"jump",(void*)&ABCVm::jump,ARGS_INT},
 	{"callProperty",(void*)&ABCVm::callProperty,ARGS_CONTEXT_INT_INT_INT_BOOL},
+	{"callPropertyNative",(void*)&ABCVm::callPropertyNative,ARGS_CONTEXT_INT_INT_OBJ_BOOL},
 	{"constructProp",(void*)&ABCVm::constructProp,ARGS_CONTEXT_INT_INT},
 	{"callSuper",(void*)&ABCVm::callSuper,ARGS_CONTEXT_INT_INT_INT_BOOL},
 	{"not_impl",(void*)&ABCVm::not_impl,ARGS_INT},
@@ -214,6 +221,11 @@ typed_opcode_handler ABCVm::opcode_table_void[]={
 	{"wrong_exec_pos",(void*)&ABCVm::wrong_exec_pos,ARGS_NONE},
 	{"dxns",(void*)&ABCVm::dxns,ARGS_CONTEXT_INT},
 	{"dxnslate",(void*)&ABCVm::dxnslate,ARGS_CONTEXT_OBJ},
+	{"si8",(void*)&ABCVm::storeIntN_i<uint8_t>,ARGS_CONTEXT_INT_INT},
+	{"si16",(void*)&ABCVm::storeIntN_i<uint16_t>,ARGS_CONTEXT_INT_INT},
+	{"si32",(void*)&ABCVm::storeIntN_i<uint32_t>,ARGS_CONTEXT_INT_INT},
+	{"sf32",(void*)&ABCVm::storeFloatN_d<float>,ARGS_CONTEXT_INT_NUMBER},
+	{"sf64",(void*)&ABCVm::storeFloatN_d<double>,ARGS_CONTEXT_INT_NUMBER},
 };
 
 typed_opcode_handler ABCVm::opcode_table_voidptr[]={
@@ -440,6 +452,11 @@ void ABCVm::register_table(LLVMTYPE ret_type,typed_opcode_handler* table, int ta
 	sig_context_int_int.push_back(int_type);
 	sig_context_int_int.push_back(int_type);
 
+	vector<LLVMTYPE> sig_context_int_number;
+	sig_context_int_number.push_back(context_type);
+	sig_context_int_number.push_back(int_type);
+	sig_context_int_number.push_back(number_type);
+
 	vector<LLVMTYPE> sig_context_int_int_int;
 	sig_context_int_int_int.push_back(context_type);
 	sig_context_int_int_int.push_back(int_type);
@@ -453,6 +470,13 @@ void ABCVm::register_table(LLVMTYPE ret_type,typed_opcode_handler* table, int ta
 	sig_context_int_int_int_bool.push_back(int_type);
 	sig_context_int_int_int_bool.push_back(bool_type);
 
+	vector<LLVMTYPE> sig_context_int_int_obj_bool;
+	sig_context_int_int_obj_bool.push_back(context_type);
+	sig_context_int_int_obj_bool.push_back(int_type);
+	sig_context_int_int_obj_bool.push_back(int_type);
+	sig_context_int_int_obj_bool.push_back(voidptr_type);
+	sig_context_int_int_obj_bool.push_back(bool_type);
+
 	vector<LLVMTYPE> sig_context_obj;
 	sig_context_obj.push_back(context_type);
 	sig_context_obj.push_back(voidptr_type);
@@ -530,12 +554,18 @@ void ABCVm::register_table(LLVMTYPE ret_type,typed_opcode_handler* table, int ta
 			case ARGS_CONTEXT_INT_INT:
 				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_int_int), false);
 				break;
+			case ARGS_CONTEXT_INT_NUMBER:
+				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_int_number), false);
+				break;
 			case ARGS_CONTEXT_INT_INT_INT:
 				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_int_int_int), false);
 				break;
 			case ARGS_CONTEXT_INT_INT_INT_BOOL:
 				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_int_int_int_bool), false);
 				break;
+			case ARGS_CONTEXT_INT_INT_OBJ_BOOL:
+				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_int_int_obj_bool), false);
+				break;
 			case ARGS_CONTEXT_OBJ_OBJ_INT:
 				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_obj_obj_int), false);
 				break;
@@ -795,6 +825,25 @@ static llvm::Value* llvm_ToNumber(llvm::ExecutionEngine* ex, llvm::IRBuilder<>&
 	}
 }
 
+/* Implements ECMA's ToInt32 algorithm
+ * fptosi is undefined for NaN and for values outside the int range,
+ * so Numbers go through the same modular conversion as Number::toInt */
+static llvm::Value* llvm_ToInt(llvm::ExecutionEngine* ex, llvm::IRBuilder<>& Builder, stack_entry& e)
+{
+	switch(e.second)
+	{
+	case STACK_BOOLEAN:
+		return Builder.CreateZExt(e.first,int_type);
+	case STACK_INT:
+	case STACK_UINT:
+		return e.first;
+	case STACK_NUMBER:
+		return Builder.CreateCall(ex->FindFunctionNamed("convert_di"), e.first);
+	default:
+		return Builder.CreateCall(ex->FindFunctionNamed("convert_i"), e.first);
+	}
+}
+
 /* Adds instructions to the builder to resolve the given multiname */
 inline llvm::Value* getMultiname(llvm::ExecutionEngine* ex,llvm::IRBuilder<>& Builder, vector<stack_entry>& static_stack,
 				llvm::Value* dynamic_stack,llvm::Value* dynamic_stack_index,
@@ -1242,6 +1291,36 @@ void method_info::doAnalysis(std::map<unsigned int,block_info>& blocks, BuilderW
 					cur_block->checkProactiveCasting(local_ip,STACK_BOOLEAN);
 					break;
 				}
+				case 0x35: //li8
+				case 0x36: //li16
+				case 0x37: //li32
+				case 0x50: //sxi1
+				case 0x51: //sxi8
+				case 0x52: //sxi16
+				{
+					popTypeFromStack(static_stack_types,local_ip);
+					static_stack_types.push_back(make_pair(local_ip,STACK_INT));
+					cur_block->checkProactiveCasting(local_ip,STACK_INT);
+					break;
+				}
+				case 0x38: //lf32
+				case 0x39: //lf64
+				{
+					popTypeFromStack(static_stack_types,local_ip);
+					static_stack_types.push_back(make_pair(local_ip,STACK_NUMBER));
+					cur_block->checkProactiveCasting(local_ip,STACK_NUMBER);
+					break;
+				}
+				case 0x3a: //si8
+				case 0x3b: //si16
+				case 0x3c: //si32
+				case 0x3d: //sf32
+				case 0x3e: //sf64
+				{
+					popTypeFromStack(static_stack_types,local_ip);
+					popTypeFromStack(static_stack_types,local_ip);
+					break;
+				}
 				case 0x40: //newfunction
 				{
 					u30 t;
@@ -3003,6 +3082,63 @@ SyntheticFunction::synt_function method_info::synt_method()
 				static_stack_push(static_stack,stack_entry(value,STACK_BOOLEAN));
 				break;
 			}
+			//Alchemy opcodes, addresses and values are passed unboxed
+			case 0x35:
+			case 0x36:
+			case 0x37:
+			{
+				//li8
+				//li16
+				//li32
+				LOG(LOG_TRACE, _("synt li") );
+				static const char* loaders[]={"li8","li16","li32"};
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+				value=Builder.CreateCall2(ex->FindFunctionNamed(loaders[opcode-0x35]), context, addr);
+				static_stack_push(static_stack,stack_entry(value,STACK_INT));
+				break;
+			}
+			case 0x38:
+			case 0x39:
+			{
+				//lf32
+				//lf64
+				LOG(LOG_TRACE, _("synt lf") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+				value=Builder.CreateCall2(ex->FindFunctionNamed(opcode==0x38 ? "lf32" : "lf64"), context, addr);
+				static_stack_push(static_stack,stack_entry(value,STACK_NUMBER));
+				break;
+			}
+			case 0x3a:
+			case 0x3b:
+			case 0x3c:
+			{
+				//si8
+				//si16
+				//si32
+				LOG(LOG_TRACE, _("synt si") );
+				static const char* storers[]={"si8","si16","si32"};
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				stack_entry v2=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+				llvm::Value* val=llvm_ToInt(ex,Builder,v2);
+				Builder.CreateCall3(ex->FindFunctionNamed(storers[opcode-0x3a]), context, addr, val);
+				break;
+			}
+			case 0x3d:
+			case 0x3e:
+			{
+				//sf32
+				//sf64
+				LOG(LOG_TRACE, _("synt sf") );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				stack_entry v2=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1);
+				llvm::Value* val=llvm_ToNumber(ex,Builder,v2);
+				Builder.CreateCall3(ex->FindFunctionNamed(opcode==0x3d ? "sf32" : "sf64"), context, addr, val);
+				break;
+			}
 			case 0x40:
 			{
 				//newfunction
@@ -3056,22 +3192,31 @@ SyntheticFunction::synt_function method_info::synt_method()
 			case 0x46: //callproperty
 			{
 				//Both opcodes are fully equal
-				//TODO: Implement static resolution where possible
 				LOG(LOG_TRACE, _("synt callproperty") );
 				syncStacks(ex,Builder,static_stack,dynamic_stack,dynamic_stack_index);
 				u30 t;
 				code >> t;
+				const bool staticName=(this->context->getMultinameRTData(t)==0);
 				constant = llvm::ConstantInt::get(int_type, t);
 				code >> t;
 				constant2 = llvm::ConstantInt::get(int_type, t);
-				constant3 = llvm::ConstantInt::get(int_type, 0);
 				constant4 = llvm::ConstantInt::get(bool_type, 1);
 	/*				//Pop the stack arguments
 				vector<llvm::Value*> args(t+1);
 				for(int i=0;i<t;i++)
 					args[t-i]=static_stack_pop(Builder,static_stack,m).first;*/
-				//Call the function resolver, static case could be resolved at this time (TODO)
-				Builder.CreateCall5(ex->FindFunctionNamed("callProperty"), context, constant, constant2, constant3, constant4);
+				//Calls to methods with a native binding are bound at the first call
+				if(staticName)
+				{
+					nativeCallSites.push_back(native_call_site());
+					value = llvm::ConstantExpr::getIntToPtr(llvm::ConstantInt::get(ptr_type, (intptr_t)&nativeCallSites.back()), voidptr_type);
+					Builder.CreateCall5(ex->FindFunctionNamed("callPropertyNative"), context, constant, constant2, value, constant4);
+				}
+				else
+				{
+					constant3 = llvm::ConstantInt::get(int_type, 0);
+					Builder.CreateCall5(ex->FindFunctionNamed("callProperty"), context, constant, constant2, constant3, constant4);
+				}
 	/*				//Pop the function object, and then the object itself
 				llvm::Value* fun=static_stack_pop(Builder,static_stack,m).first;
 
@@ -3178,12 +3323,38 @@ SyntheticFunction::synt_function method_info::synt_method()
 				syncStacks(ex,Builder,static_stack,dynamic_stack,dynamic_stack_index);
 				u30 t;
 				code >> t;
+				const bool staticName=(this->context->getMultinameRTData(t)==0);
 				constant = llvm::ConstantInt::get(int_type, t);
 				code >> t;
 				constant2 = llvm::ConstantInt::get(int_type, t);
-				constant3 = llvm::ConstantInt::get(int_type, 0);
 				constant4 = llvm::ConstantInt::get(bool_type, 0);
-				Builder.CreateCall5(ex->FindFunctionNamed("callProperty"), context, constant, constant2, constant3, constant4);
+				if(staticName)
+				{
+					nativeCallSites.push_back(native_call_site());
+					value = llvm::ConstantExpr::getIntToPtr(llvm::ConstantInt::get(ptr_type, (intptr_t)&nativeCallSites.back()), voidptr_type);
+					Builder.CreateCall5(ex->FindFunctionNamed("callPropertyNative"), context, constant, constant2, value, constant4);
+				}
+				else
+				{
+					constant3 = llvm::ConstantInt::get(int_type, 0);
+					Builder.CreateCall5(ex->FindFunctionNamed("callProperty"), context, constant, constant2, constant3, constant4);
+				}
+				break;
+			}
+			case 0x50:
+			case 0x51:
+			case 0x52:
+			{
+				//sxi1
+				//sxi8
+				//sxi16
+				LOG(LOG_TRACE, _("synt sxi") );
+				static const unsigned int widths[]={1,8,16};
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* val=llvm_ToInt(ex,Builder,v1);
+				LLVMTYPE narrow_type=llvm::IntegerType::get(llvm_context,widths[opcode-0x50]);
+				value=Builder.CreateSExt(Builder.CreateTrunc(val,narrow_type),int_type);
+				static_stack_push(static_stack,stack_entry(value,STACK_INT));
 				break;
 			}
 			case 0x53:
@@ -3484,7 +3655,7 @@ SyntheticFunction::synt_function method_info::synt_method()
 				LOG(LOG_TRACE, _("synt convert_i") );
 				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
 				if(v1.second==STACK_NUMBER)
-					value=Builder.CreateFPToSI(v1.first,int_type);
+					value=llvm_ToInt(ex,Builder,v1);
 				else if(v1.second==STACK_INT) //Nothing to do
 					value=v1.first;
 				else
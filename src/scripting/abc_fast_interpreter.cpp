@@ -37,6 +37,7 @@ struct OpcodeData
 		ASObject* objs[0];
 		const multiname* names[0];
 		const Type* types[0];
+		const Class_base* classes[0];
 	};
 };
 
@@ -83,7 +84,12 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 			case 0x03:
 			{
 				//throw
-				_throw(context);
+				LOG(LOG_CALLS,_("throw"));
+				ASObject* excobj=context->runtime_stack_pop();
+				//If the handler is in this method jump there, without unwinding
+				if(!findExceptionHandler(function,context,excobj))
+					throw excobj;
+				instructionPointer=context->exec_pos;
 				break;
 			}
 			case 0x04:
@@ -565,6 +571,20 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				loadIntN<uint32_t>(context);
 				break;
 			}
+			case 0x38:
+			{
+				//lf32
+				LOG(LOG_CALLS, "lf32");
+				loadFloatN<float>(context);
+				break;
+			}
+			case 0x39:
+			{
+				//lf64
+				LOG(LOG_CALLS, "lf64");
+				loadFloatN<double>(context);
+				break;
+			}
 			case 0x3a:
 			{
 				//si8
@@ -586,6 +606,20 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				storeIntN<uint32_t>(context);
 				break;
 			}
+			case 0x3d:
+			{
+				//sf32
+				LOG(LOG_CALLS, "sf32");
+				storeFloatN<float>(context);
+				break;
+			}
+			case 0x3e:
+			{
+				//sf64
+				LOG(LOG_CALLS, "sf64");
+				storeFloatN<double>(context);
+				break;
+			}
 			case 0x40:
 			{
 				//newfunction
@@ -706,6 +740,27 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer+=8;
 				break;
 			}
+			case 0x50:
+			{
+				//sxi1
+				LOG(LOG_CALLS, "sxi1");
+				signExtend<1>(context);
+				break;
+			}
+			case 0x51:
+			{
+				//sxi8
+				LOG(LOG_CALLS, "sxi8");
+				signExtend<8>(context);
+				break;
+			}
+			case 0x52:
+			{
+				//sxi16
+				LOG(LOG_CALLS, "sxi16");
+				signExtend<16>(context);
+				break;
+			}
 			case 0x53:
 			{
 				//constructgenerictype
@@ -1379,6 +1434,42 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				break;
 			}
 			//lightspark custom opcodes
+			case 0xf9:
+			case 0xfa:
+			{
+				//callnative
+				//callnativevoid
+				Function* f=static_cast<Function*>(data->objs[0]);
+				const Class_base* guard=data->classes[1];
+				uint32_t t=data->uints[4];
+				uint32_t t2=data->uints[5];
+				assert_and_throw(context->stack_index>t2);
+				ASObject* obj=context->stack[context->stack_index-t2-1];
+				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
+				if(guard && (obj->getClass()!=guard || (!guard->isSealed && obj->Variables.size()!=0)))
+				{
+					//The object is not of the class seen by the optimizer, or it may have
+					//a dynamic property hiding the method, do the full lookup
+					method_info* called_mi=NULL;
+					callProperty(context,t,t2,&called_mi,opcode==0xf9);
+				}
+				else
+				{
+					LOG(LOG_CALLS,_("callNative ") << t2);
+					ASObject** args=g_newa(ASObject*,t2);
+					for(uint32_t i=0;i<t2;i++)
+						args[t2-i-1]=context->runtime_stack_pop();
+					obj=context->runtime_stack_pop();
+					ASObject* ret=f->callNative(obj,args,t2);
+					if(opcode==0xf9)
+						context->runtime_stack_push(ret);
+					else
+						ret->decRef();
+				}
+				PROF_IGNORE_TIME(profilingCheckpoint(startTime));
+				instructionPointer+=24;
+				break;
+			}
 			case 0xfb:
 			{
 				//setslot_no_coerce
@@ -81,7 +81,12 @@ ASObject* ABCVm::executeFunction(const SyntheticFunction* function, call_context
 			case 0x03:
 			{
 				//throw
-				_throw(context);
+				LOG(LOG_CALLS,_("throw"));
+				ASObject* excobj=context->runtime_stack_pop();
+				//If the handler is in this method jump there, without unwinding
+				if(!findExceptionHandler(function,context,excobj))
+					throw excobj;
+				code.seekg(context->exec_pos);
 				break;
 			}
 			case 0x04:
@@ -663,6 +668,20 @@ ASObject* ABCVm::executeFunction(const SyntheticFunction* function, call_context
 				loadIntN<uint32_t>(context);
 				break;
 			}
+			case 0x38:
+			{
+				//lf32
+				LOG(LOG_CALLS, "lf32");
+				loadFloatN<float>(context);
+				break;
+			}
+			case 0x39:
+			{
+				//lf64
+				LOG(LOG_CALLS, "lf64");
+				loadFloatN<double>(context);
+				break;
+			}
 			case 0x3a:
 			{
 				//si8
@@ -684,6 +703,20 @@ ASObject* ABCVm::executeFunction(const SyntheticFunction* function, call_context
 				storeIntN<uint32_t>(context);
 				break;
 			}
+			case 0x3d:
+			{
+				//sf32
+				LOG(LOG_CALLS, "sf32");
+				storeFloatN<float>(context);
+				break;
+			}
+			case 0x3e:
+			{
+				//sf64
+				LOG(LOG_CALLS, "sf64");
+				storeFloatN<double>(context);
+				break;
+			}
 			case 0x40:
 			{
 				//newfunction
@@ -807,6 +840,27 @@ ASObject* ABCVm::executeFunction(const SyntheticFunction* function, call_context
 					PROF_IGNORE_TIME(profilingCheckpoint(startTime));
 				break;
 			}
+			case 0x50:
+			{
+				//sxi1
+				LOG(LOG_CALLS, "sxi1");
+				signExtend<1>(context);
+				break;
+			}
+			case 0x51:
+			{
+				//sxi8
+				LOG(LOG_CALLS, "sxi8");
+				signExtend<8>(context);
+				break;
+			}
+			case 0x52:
+			{
+				//sxi16
+				LOG(LOG_CALLS, "sxi16");
+				signExtend<16>(context);
+				break;
+			}
 			case 0x53:
 			{
 				//constructgenerictype
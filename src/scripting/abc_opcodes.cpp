@@ -100,6 +100,12 @@ int32_t ABCVm::convert_i(ASObject* o)
 	return ret;
 }
 
+int32_t ABCVm::convert_di(number_t val)
+{
+	LOG(LOG_CALLS, _("convert_di") );
+	return Number::toInt(val);
+}
+
 ASObject* ABCVm::convert_s(ASObject* o)
 {
 	LOG(LOG_CALLS, _("convert_s") );
@@ -354,6 +360,52 @@ void ABCVm::callProperty(call_context* th, int n, int m, method_info** called_mi
 	LOG(LOG_CALLS,_("End of calling ") << *name);
 }
 
+void ABCVm::callPropertyNative(call_context* th, int n, int m, native_call_site* site, bool keepReturn)
+{
+	assert_and_throw(th->stack_index>(uint32_t)m);
+	ASObject* obj=th->stack[th->stack_index-m-1];
+	if(!site->resolved)
+	{
+		site->resolved=true;
+		const multiname* name=th->context->getMultiname(n,NULL);
+		const Class_base* c=dynamic_cast<const Class_base*>(obj);
+		if(c)
+		{
+			site->receiver=c;
+			site->f=findNativeMethod(c, true, name, m);
+		}
+		else
+		{
+			site->guard=obj->getClass();
+			site->f=findNativeMethod(site->guard, false, name, m);
+		}
+	}
+	bool direct=false;
+	if(site->f)
+	{
+		if(site->receiver)
+			direct=(obj==site->receiver);
+		else
+			direct=(obj->getClass()==site->guard && (site->guard->isSealed || obj->Variables.size()==0));
+	}
+	if(!direct)
+	{
+		callProperty(th,n,m,NULL,keepReturn);
+		return;
+	}
+
+	LOG(LOG_CALLS,_("callNative ") << m);
+	ASObject** args=g_newa(ASObject*,m);
+	for(int i=0;i<m;i++)
+		args[m-i-1]=th->runtime_stack_pop();
+	obj=th->runtime_stack_pop();
+	ASObject* ret=const_cast<Function*>(site->f)->callNative(obj,args,m);
+	if(keepReturn)
+		th->runtime_stack_push(ret);
+	else
+		ret->decRef();
+}
+
 int32_t ABCVm::getProperty_i(ASObject* obj, multiname* name)
 {
 	LOG(LOG_CALLS, _("getProperty_i ") << *name );
@@ -1236,6 +1288,29 @@ void ABCVm::_throw(call_context* th)
 	throw th->runtime_stack_pop();
 }
 
+bool ABCVm::findExceptionHandler(const SyntheticFunction* f, call_context* th, ASObject* excobj)
+{
+	method_info* mi=f->mi;
+	const uint32_t pos=th->exec_pos;
+	LOG(LOG_TRACE, "got an " << excobj->toString());
+	LOG(LOG_TRACE, "pos=" << pos);
+	for(unsigned int i=0;i<mi->body->exceptions.size();i++)
+	{
+		exception_info& exc=mi->body->exceptions[i];
+		LOG(LOG_TRACE, "f=" << exc.from << " t=" << exc.to << " type=" << exc.exc_type);
+		if(pos >= exc.from && pos <= exc.to && th->context->handlerCatches(excobj, exc))
+		{
+			th->exec_pos = exc.target;
+			th->runtime_stack_clear();
+			th->runtime_stack_push(excobj);
+			th->scope_stack=f->func_scope;
+			th->initialScopeStack=f->func_scope.size();
+			return true;
+		}
+	}
+	return false;
+}
+
 void ABCVm::setSuper(call_context* th, int n)
 {
 	ASObject* value=th->runtime_stack_pop();
@@ -1313,16 +1388,19 @@ void ABCVm::getLex(call_context* th, int n)
 
 	if(o==NULL)
 	{
-		ASObject* target;
-		o=getCurrentApplicationDomain(th)->getVariableAndTargetByMultiname(*name, target);
-		if(o==NULL)
+		ASObject* target=th->context->findGlobalTarget(name);
+		_NR<ASObject> prop;
+		if(target)
+			prop=target->getVariableByMultiname(*name);
+		if(prop.isNull())
 		{
 			LOG(LOG_NOT_IMPLEMENTED,"getLex: " << *name<< " not found, pushing Undefined");
 			th->runtime_stack_push(getSys()->getUndefinedRef());
 			name->resetNameIfObject();
 			return;
 		}
-		o->incRef();
+		prop->incRef();
+		o=prop.getPtr();
 	}
 
 	name->resetNameIfObject();
@@ -1370,11 +1448,8 @@ ASObject* ABCVm::findProperty(call_context* th, multiname* name)
 	if(!found)
 	{
 		//try to find a global object where this is defined
-		ASObject* target;
-		ASObject* o=getCurrentApplicationDomain(th)->getVariableAndTargetByMultiname(*name, target);
-		if(o)
-			ret=target;
-		else //else push the current global object
+		ret=th->context->findGlobalTarget(name);
+		if(ret==NULL) //else push the current global object
 			ret=th->scope_stack[0].object.getPtr();
 	}
 
@@ -1404,11 +1479,8 @@ ASObject* ABCVm::findPropStrict(call_context* th, multiname* name)
 	}
 	if(!found)
 	{
-		ASObject* target;
-		ASObject* o=getCurrentApplicationDomain(th)->getVariableAndTargetByMultiname(*name, target);
-		if(o)
-			ret=target;
-		else
+		ret=th->context->findGlobalTarget(name);
+		if(ret==NULL)
 		{
 			LOG(LOG_NOT_IMPLEMENTED,"findPropStrict: " << *name << " not found, pushing Undefined");
 			return getSys()->getUndefinedRef();
@@ -2142,6 +2214,29 @@ void ABCVm::swap()
 ASObject* ABCVm::newActivation(call_context* th,method_info* info)
 {
 	LOG(LOG_CALLS,"newActivation");
+	scope_layout& layout=info->activationLayout;
+	if(layout.status==scope_layout::NOT_BUILT)
+		th->context->buildActivationLayout(layout,info->body);
+	if(layout.status==scope_layout::VALID && !layout.traits.empty())
+	{
+		//Fast path: the slots are stored in an array, no map is built
+		Class_base* c=Class<ASObject>::getClass();
+		ActivationScope* act=new (c->memoryAccount) ActivationScope(c,&layout.names);
+		c->handleConstruction(act,NULL,0,true);
+		for(unsigned int i=0;i<layout.traits.size();i++)
+		{
+			const traits_info* t=layout.traits[i];
+			ASObject* value;
+			if(t->vindex)
+				value=th->context->getConstant(t->vkind,t->vindex);
+			else
+				value=getSys()->getUndefinedRef();
+			TRAIT_KIND kind=((t->kind&0xf)==traits_info::Const)?CONSTANT_TRAIT:DECLARED_TRAIT;
+			act->initSlotValue(i+1,value,layout.typenames[i],layout.types[i],kind);
+		}
+		return act;
+	}
+
 	//TODO: Should create a real activation object
 	//TODO: Should method traits be added to the activation context?
 	ASObject* act=Class<ASObject>::getInstanceS();
@@ -2285,9 +2380,32 @@ ASObject* ABCVm::pushString(call_context* th, int n)
 
 ASObject* ABCVm::newCatch(call_context* th, int n)
 {
+	method_info* mi=th->mi;
+	assert_and_throw(n >= 0 && (unsigned int)n < mi->body->exceptions.size());
+	if(mi->catchLayouts.empty())
+		mi->catchLayouts.resize(mi->body->exceptions.size());
+	scope_layout& layout=mi->catchLayouts[n];
+	multiname* name = th->context->getMultiname(mi->body->exceptions[n].var_name, NULL);
+	if(layout.status==scope_layout::NOT_BUILT)
+	{
+		//The catch scope has a single untyped slot
+		if(name->ns.size()==1 && name->name_type==multiname::NAME_STRING)
+		{
+			layout.names.push_back(varName(name->normalizedNameId(),name->ns[0]));
+			layout.status=scope_layout::VALID;
+		}
+		else
+			layout.status=scope_layout::INVALID;
+	}
+	if(layout.status==scope_layout::VALID)
+	{
+		Class_base* c=Class<ASObject>::getClass();
+		ActivationScope* catchScope=new (c->memoryAccount) ActivationScope(c,&layout.names);
+		c->handleConstruction(catchScope,NULL,0,true);
+		catchScope->initSlotValue(1,getSys()->getUndefinedRef(),NULL,NULL,DECLARED_TRAIT);
+		return catchScope;
+	}
 	ASObject* catchScope = Class<ASObject>::getInstanceS();
-	assert_and_throw(n >= 0 && (unsigned int)n < th->mi->body->exceptions.size());
-	multiname* name = th->context->getMultiname(th->mi->body->exceptions[n].var_name, NULL);
 	catchScope->setVariableByMultiname(*name, getSys()->getUndefinedRef(),ASObject::CONST_NOT_ALLOWED);
 	catchScope->initSlot(1, *name);
 	return catchScope;
@@ -22,13 +22,14 @@
 #include "abcutils.h"
 #include "toplevel/toplevel.h"
 #include "toplevel/ASString.h"
+#include "scripting/class.h"
 #include <string>
 #include <sstream>
 
 using namespace std;
 using namespace lightspark;
 
-enum SPECIAL_OPCODES { SET_SLOT_NO_COERCE = 0xfb, COERCE_EARLY = 0xfc, GET_SCOPE_AT_INDEX = 0xfd, GET_LEX_ONCE = 0xfe, PUSH_EARLY = 0xff };
+enum SPECIAL_OPCODES { CALL_NATIVE = 0xf9, CALL_NATIVE_VOID = 0xfa, SET_SLOT_NO_COERCE = 0xfb, COERCE_EARLY = 0xfc, GET_SCOPE_AT_INDEX = 0xfd, GET_LEX_ONCE = 0xfe, PUSH_EARLY = 0xff };
 
 struct lightspark::InferenceData
 {
@@ -264,6 +265,42 @@ InferenceData ABCVm::earlyBindGetLex(ostream& out, const SyntheticFunction* f, c
 	return ret;
 }
 
+const Function* ABCVm::earlyBindNativeCall(const InferenceData& base, const multiname* name, uint32_t argc,
+		const Class_base*& guard)
+{
+	guard=NULL;
+	if(base.obj)
+	{
+		//Static methods of builtin classes, like Math.floor
+		return findNativeMethod(dynamic_cast<const Class_base*>(base.obj), true, name, argc);
+	}
+	else if(base.type)
+	{
+		//Methods of builtin classes, like String.charCodeAt. The object may still be null
+		//or of a derived class at runtime, so the class of the object is checked before the call.
+		//Objects of dynamic classes are also checked for properties that would shadow the method
+		const Class_base* c=dynamic_cast<const Class_base*>(base.type);
+		const Function* f=findNativeMethod(c, false, name, argc);
+		if(f)
+			guard=c;
+		return f;
+	}
+	return NULL;
+}
+
+const Function* ABCVm::findNativeMethod(const Class_base* c, bool isStatic, const multiname* name, uint32_t argc)
+{
+	if(c==NULL || dynamic_cast<const Class_inherit*>(c))
+		return NULL;
+	const variable* var=isStatic ? c->findGettable(*name) : c->findBorrowedGettable(*name);
+	if(var==NULL || var->getter || var->kind!=DECLARED_TRAIT || var->var==NULL || !var->var->is<Function>())
+		return NULL;
+	const Function* f=var->var->as<Function>();
+	if(f->isBound() || !f->getNativeBinding().accepts(argc))
+		return NULL;
+	return f;
+}
+
 const Type* ABCVm::getLocalType(const SyntheticFunction* f, unsigned localIndex)
 {
 	if(localIndex==0 && f->isMethod())
@@ -875,18 +912,36 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				//li8
 				//li16
 				//li32
+				//The fast interpreter stack only holds boxed values, so
+				//the domain memory opcodes are copied as they are and
+				//only their result types are recorded. The unboxed
+				//loadIntN_i/storeIntN_i variants are reached from the JIT
 				out << (uint8_t)opcode;
 				curBlock->popStack(1);
 				curBlock->pushStack(Class<Integer>::getClass());
 				break;
 			}
+			case 0x38:
+			case 0x39:
+			{
+				//lf32
+				//lf64
+				out << (uint8_t)opcode;
+				curBlock->popStack(1);
+				curBlock->pushStack(Class<Number>::getClass());
+				break;
+			}
 			case 0x3a:
 			case 0x3b:
 			case 0x3c:
+			case 0x3d:
+			case 0x3e:
 			{
 				//si8
 				//si16
 				//si32
+				//sf32
+				//sf64
 				out << (uint8_t)opcode;
 				curBlock->popStack(2);
 				break;
@@ -947,13 +1002,24 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				u30 t,t2;
 				code >> t;
 				code >> t2;
-				out << (uint8_t)opcode;
-				writeInt32(out,t);
-				writeInt32(out,t2);
 				
 				int numRT=mi->context->getMultinameRTData(t);
 				curBlock->popStack(numRT+t2);
 				InferenceData baseData=curBlock->peekStack();
+				const Function* nativeFunc=NULL;
+				const Class_base* guard=NULL;
+				if(opcode!=0x45 && baseData.isValid() && numRT==0)
+					nativeFunc=earlyBindNativeCall(baseData, mi->context->getMultiname(t,NULL), t2, guard);
+				if(nativeFunc)
+				{
+					out << (uint8_t)CALL_NATIVE;
+					writePtr(out,nativeFunc);
+					writePtr(out,guard);
+				}
+				else
+					out << (uint8_t)opcode;
+				writeInt32(out,t);
+				writeInt32(out,t2);
 				//Try to infer the return type
 				InferenceData inferredData;
 				if(baseData.isValid() && numRT==0)
@@ -1016,12 +1082,37 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				u30 t,t2;
 				code >> t;
 				code >> t2;
-				out << (uint8_t)opcode;
-				writeInt32(out,t);
-				writeInt32(out,t2);
 				
 				int numRT=mi->context->getMultinameRTData(t);
-				curBlock->popStack(numRT+1+t2);
+				curBlock->popStack(numRT+t2);
+				InferenceData baseData=curBlock->peekStack();
+				const Function* nativeFunc=NULL;
+				const Class_base* guard=NULL;
+				if(opcode==0x4f && baseData.isValid() && numRT==0)
+					nativeFunc=earlyBindNativeCall(baseData, mi->context->getMultiname(t,NULL), t2, guard);
+				if(nativeFunc)
+				{
+					out << (uint8_t)CALL_NATIVE_VOID;
+					writePtr(out,nativeFunc);
+					writePtr(out,guard);
+				}
+				else
+					out << (uint8_t)opcode;
+				writeInt32(out,t);
+				writeInt32(out,t2);
+				curBlock->popStack(1);
+				break;
+			}
+			case 0x50:
+			case 0x51:
+			case 0x52:
+			{
+				//sxi1
+				//sxi8
+				//sxi16
+				out << (uint8_t)opcode;
+				curBlock->popStack(1);
+				curBlock->pushStack(Class<Integer>::getClass());
 				break;
 			}
 			case 0x53:
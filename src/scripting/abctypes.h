@@ -28,6 +28,8 @@ class memorystream;
 namespace lightspark
 {
 
+class Class_base;
+
 class u8
 {
 friend std::istream& operator>>(std::istream& in, u8& v);
@@ -123,9 +125,13 @@ struct multiname_info
 	std::vector<u30> param_types;
 	multiname* cached;
 	multiname* dynamic;
-	multiname_info():cached(NULL),dynamic(NULL){}
+	//Last string used as a runtime name at this site and its unique id
+	tiny_string runtimeString;
+	uint32_t runtimeStringId;
+	multiname_info():cached(NULL),dynamic(NULL),runtimeStringId(-1){}
 	~multiname_info(){delete cached;if (dynamic) {delete dynamic;};}
 	bool isAttributeName() const;
+	uint32_t getRuntimeStringId(const tiny_string& s);
 };
 
 struct cpool_info
@@ -220,11 +226,16 @@ struct script_info
 
 struct exception_info
 {
+	exception_info():from(0),to(0),target(0),excClass(NULL),resolved(false){}
 	uint32_t from;
 	uint32_t to;
 	uint32_t target;
 	u30 exc_type;
 	u30 var_name;
+	//The class caught by this handler, resolved the first time an exception
+	//is dispatched to it. NULL means that everything is caught
+	Class_base* excClass;
+	bool resolved;
 };
 
 struct method_info_simple
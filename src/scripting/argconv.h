@@ -215,6 +215,79 @@ inline ASObject* lightspark::ArgumentConversion<RGB>::toAbstract(const RGB& val)
 	return abstract_ui(val.toUInt());
 }
 
+/* Native bindings:
+ * A builtin may expose, next to its ASFUNCTION, a typed entry point
+ * declared with ASNATIVEFUNCTION, for example
+ *   ASNATIVEFUNCTION(number_t,floor,number_t n);
+ * and register both with
+ *   Class<IFunction>::getFunction(floor,1,NATIVE_BINDING(floor))
+ * The typed entry point always receives the 'this' object first, followed by
+ * the unboxed arguments. Its arguments and return value are converted with the
+ * ArgumentConversion templates above. It must behave exactly like the
+ * ASFUNCTION called with the same number of arguments, the usual way to ensure
+ * this is to implement the ASFUNCTION in terms of the typed entry point.
+ * When the optimizer resolves a call to such a builtin early, the interpreter
+ * calls the typed entry point directly, skipping the property lookup.
+ * Builtins taking a variable number of arguments, like Array.push, have no
+ * typed entry point: NATIVE_VARIADIC_BINDING(name) binds the ASFUNCTION itself
+ * so that only the lookup is skipped.
+ */
+#define NATIVE_BINDING(name) makeNativeBinding(name##_native)
+#define NATIVE_VARIADIC_BINDING(name) makeVariadicBinding(name)
+
+template<class R>
+ASObject* invokeNative0(native_binding::generic_function f, ASObject* obj, ASObject* const* args, uint32_t argslen)
+{
+	R (*typed)(ASObject*)=reinterpret_cast<R (*)(ASObject*)>(f);
+	return ArgumentConversion<R>::toAbstract(typed(obj));
+}
+
+template<class R, class A1>
+ASObject* invokeNative1(native_binding::generic_function f, ASObject* obj, ASObject* const* args, uint32_t argslen)
+{
+	R (*typed)(ASObject*,A1)=reinterpret_cast<R (*)(ASObject*,A1)>(f);
+	A1 a1=ArgumentConversion<A1>::toConcrete(args[0]);
+	return ArgumentConversion<R>::toAbstract(typed(obj,a1));
+}
+
+template<class R, class A1, class A2>
+ASObject* invokeNative2(native_binding::generic_function f, ASObject* obj, ASObject* const* args, uint32_t argslen)
+{
+	R (*typed)(ASObject*,A1,A2)=reinterpret_cast<R (*)(ASObject*,A1,A2)>(f);
+	//Arguments must be converted in order, as conversion may call valueOf
+	A1 a1=ArgumentConversion<A1>::toConcrete(args[0]);
+	A2 a2=ArgumentConversion<A2>::toConcrete(args[1]);
+	return ArgumentConversion<R>::toAbstract(typed(obj,a1,a2));
+}
+
+template<class R>
+native_binding makeNativeBinding(R (*f)(ASObject*))
+{
+	return native_binding(reinterpret_cast<native_binding::generic_function>(f),&invokeNative0<R>,0);
+}
+
+template<class R, class A1>
+native_binding makeNativeBinding(R (*f)(ASObject*,A1))
+{
+	return native_binding(reinterpret_cast<native_binding::generic_function>(f),&invokeNative1<R,A1>,1);
+}
+
+template<class R, class A1, class A2>
+native_binding makeNativeBinding(R (*f)(ASObject*,A1,A2))
+{
+	return native_binding(reinterpret_cast<native_binding::generic_function>(f),&invokeNative2<R,A1,A2>,2);
+}
+
+inline ASObject* invokeVariadic(native_binding::generic_function f, ASObject* obj, ASObject* const* args, uint32_t argslen)
+{
+	return reinterpret_cast<Function::as_function>(f)(obj,args,argslen);
+}
+
+inline native_binding makeVariadicBinding(Function::as_function f)
+{
+	return native_binding(reinterpret_cast<native_binding::generic_function>(f),&invokeVariadic,0,true);
+}
+
 #define ARG_UNPACK ArgUnpack(args,argslen)
 
 class ArgUnpack
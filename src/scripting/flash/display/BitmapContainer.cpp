@@ -52,6 +52,16 @@ bool BitmapContainer::fromRGB(uint8_t* rgb, uint32_t w, uint32_t h, BITMAP_FORMA
 	return true;
 }
 
+uint8_t* BitmapContainer::allocateData(int32_t w, int32_t h, size_t s)
+{
+	assert(data.empty());
+	width=w;
+	height=h;
+	stride=s;
+	data.resize(stride*height);
+	return &data[0];
+}
+
 bool BitmapContainer::fromJPEG(uint8_t *inData, int len, const uint8_t *tablesData, int tablesLen)
 {
 	assert(data.empty());
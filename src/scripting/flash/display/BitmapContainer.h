@@ -51,6 +51,9 @@ public:
 	bool fromJPEG(std::istream& s);
 	bool fromPNG(std::istream& s);
 	bool fromPalette(uint8_t* inData, uint32_t width, uint32_t height, uint32_t inStride, uint8_t* palette, unsigned numColors, unsigned paletteBPP);
+	// Sizes the container and returns the buffer to be filled with
+	// stride*height bytes of pixels in the internal format
+	uint8_t* allocateData(int32_t width, int32_t height, size_t stride);
 	// Clip sourceRect coordinates to this BitmapContainer. The
 	// output coordinates can be used to access pixels in data
 	// without out-of-bounds errors.
@@ -73,6 +76,7 @@ public:
 	void floodFill(int32_t x, int32_t y, uint32_t color);
 	int getWidth() const { return width; }
 	int getHeight() const { return height; }
+	size_t getStride() const { return stride; }
 	bool isEmpty() const { return data.empty(); }
 	void clear();
 };
@@ -69,6 +69,8 @@ void Graphics::checkAndSetScaling()
 	{
 		owner->scaling = 1.0f;
 		owner->tokens.clear();
+		//Stop using the tokens of the tag
+		owner->sharedTokens.reset();
 	}
 }
 
@@ -914,10 +916,13 @@ ASFUNCTIONBODY(Graphics,copyFrom)
 	Graphics* th=static_cast<Graphics*>(obj);
 	_NR<Graphics> source;
 	ARG_UNPACK(source);
-	if (source.isNull())
+	if (source.isNull() || source.getPtr()==th)
 		return NULL;
 
-	th->owner->tokens.assign(source->owner->tokens.begin(),
-				 source->owner->tokens.end());
+	th->checkAndSetScaling();
+	//The source may still be drawn from the tokens of its tag
+	const std::vector<GeomToken>& sourceTokens=source->owner->getTokens();
+	th->owner->tokens.assign(sourceTokens.begin(), sourceTokens.end());
+	th->owner->owner->requestInvalidation(getSys());
 	return NULL;
 }
@@ -29,8 +29,8 @@ TokenContainer::TokenContainer(DisplayObject* _o) : owner(_o), scaling(1.0f)
 {
 }
 
-TokenContainer::TokenContainer(DisplayObject* _o, const tokensVector& _tokens, float _scaling) :
-	owner(_o), tokens(_tokens.begin(),_tokens.end()), scaling(_scaling)
+TokenContainer::TokenContainer(DisplayObject* _o, _R<ShapeTokens> _tokens, float _scaling) :
+	owner(_o), scaling(_scaling), sharedTokens(_tokens)
 
 {
 }
@@ -45,7 +45,7 @@ void TokenContainer::renderImpl(RenderContext& ctxt) const
 * * \param shapes a vector to be populated with the shapes */
 
 void TokenContainer::FromShaperecordListToShapeVector(const std::vector<SHAPERECORD>& shapeRecords,
-								  tokensVector& tokens,
+								  std::vector<GeomToken>& tokens,
 								  const std::list<FILLSTYLE>& fillStyles,
 								  const MATRIX& matrix)
 {
@@ -116,7 +116,7 @@ void TokenContainer::FromShaperecordListToShapeVector(const std::vector<SHAPEREC
 
 void TokenContainer::requestInvalidation(InvalidateQueue* q)
 {
-	if(tokens.empty())
+	if(getTokens().empty())
 		return;
 	owner->incRef();
 	q->addToInvalidateQueue(_MR(owner));
@@ -141,7 +141,7 @@ IDrawable* TokenContainer::invalidate(DisplayObject* target, const MATRIX& initi
 	owner->computeBoundsForTransformedRect(bxmin,bxmax,bymin,bymax,x,y,width,height,totalMatrix);
 	if(width==0 || height==0)
 		return NULL;
-	return new CairoTokenRenderer(tokens,
+	return new CairoTokenRenderer(getTokens(),
 				totalMatrix, x, y, width, height, scaling,
 				owner->getConcatenatedAlpha(), masks);
 }
@@ -150,7 +150,7 @@ _NR<DisplayObject> TokenContainer::hitTestImpl(_NR<DisplayObject> last, number_t
 {
 	//Masks have been already checked along the way
 
-	if(CairoTokenRenderer::hitTest(tokens, scaling, x, y))
+	if(CairoTokenRenderer::hitTest(getTokens(), scaling, x, y))
 		return last;
 	return NullRef;
 }
@@ -164,6 +164,7 @@ bool TokenContainer::boundsRect(number_t& xmin, number_t& xmax, number_t& ymin,
 		ymin=dmin(v.y-strokeWidth,ymin); \
 		ymax=dmax(v.y+strokeWidth,ymax);
 
+	const std::vector<GeomToken>& tokens=getTokens();
 	if(tokens.size()==0)
 		return false;
 
@@ -258,6 +259,7 @@ void TokenContainer::getTextureSize(std::vector<GeomToken>& tokens, int *width,
 /* Return the width of the latest SET_STROKE */
 uint16_t TokenContainer::getCurrentLineWidth() const
 {
+	const std::vector<GeomToken>& tokens=getTokens();
 	for(int i=tokens.size()-1;i>=0;i--)
 	{
 		if(tokens[i].type==SET_STROKE)
@@ -48,20 +48,28 @@ public:
 	 */
 	std::vector<GeomToken> tokens;
 	static void FromShaperecordListToShapeVector(const std::vector<SHAPERECORD>& shapeRecords,
-					 tokensVector& tokens, const std::list<FILLSTYLE>& fillStyles,
+					 std::vector<GeomToken>& tokens, const std::list<FILLSTYLE>& fillStyles,
 					 const MATRIX& matrix = MATRIX());
 	static void getTextureSize(std::vector<GeomToken>& tokens, int *width, int *height);
 	uint16_t getCurrentLineWidth() const;
 	float scaling;
+private:
+	/* The tokens of the tag this object was created from, used
+	 * instead of 'tokens' until the first drawing operation */
+	_NR<ShapeTokens> sharedTokens;
+	const std::vector<GeomToken>& getTokens() const
+	{
+		return sharedTokens.isNull() ? tokens : sharedTokens->tokens;
+	}
 protected:
 	TokenContainer(DisplayObject* _o);
-	TokenContainer(DisplayObject* _o, const tokensVector& _tokens, float _scaling);
+	TokenContainer(DisplayObject* _o, _R<ShapeTokens> _tokens, float _scaling);
 	IDrawable* invalidate(DisplayObject* target, const MATRIX& initialMatrix);
 	void requestInvalidation(InvalidateQueue* q);
 	bool boundsRect(number_t& xmin, number_t& xmax, number_t& ymin, number_t& ymax) const;
 	_NR<DisplayObject> hitTestImpl(_NR<DisplayObject> last, number_t x, number_t y, DisplayObject::HIT_TYPE type) const;
 	void renderImpl(RenderContext& ctxt) const;
-	bool tokensEmpty() const { return tokens.empty(); }
+	bool tokensEmpty() const { return getTokens().empty(); }
 };
 
 };
@@ -18,6 +18,7 @@
 **************************************************************************/
 
 #include <list>
+#include <algorithm>
 
 #include "backends/security.h"
 #include "scripting/abc.h"
@@ -974,6 +975,53 @@ void Frame::execute(_R<DisplayObjectContainer> displayList)
 		(*it)->execute(displayList.getPtr());
 }
 
+void Frame::updateSnapshot(DisplayListSnapshot& snapshot) const
+{
+	auto it=blueprint.begin();
+	for(;it!=blueprint.end();++it)
+		(*it)->updateSnapshot(snapshot);
+}
+
+/* A placement replaces the character at its depth only when moving,
+ * otherwise it is ignored if the depth is taken, like in execute */
+void DisplayListSnapshot::place(uint32_t depth, const DisplayListTag* t, bool replace)
+{
+	auto it=depths.find(depth);
+	if(it!=depths.end() && !replace)
+		return;
+	Entry e={t,NULL,nextOrder++};
+	depths[depth]=e;
+}
+
+/* Moves only set the matrix, so the last one wins */
+void DisplayListSnapshot::move(uint32_t depth, const DisplayListTag* t)
+{
+	auto it=depths.find(depth);
+	if(it!=depths.end())
+		it->second.moved=t;
+}
+
+void DisplayListSnapshot::remove(uint32_t depth)
+{
+	depths.erase(depth);
+}
+
+void DisplayListSnapshot::apply(DisplayObjectContainer* parent) const
+{
+	std::vector<const Entry*> sorted;
+	sorted.reserve(depths.size());
+	for(auto it=depths.begin();it!=depths.end();++it)
+		sorted.push_back(&it->second);
+	std::sort(sorted.begin(),sorted.end(),
+		[](const Entry* a, const Entry* b) { return a->order<b->order; });
+	for(auto it=sorted.begin();it!=sorted.end();++it)
+	{
+		(*it)->placed->execute(parent);
+		if((*it)->moved)
+			(*it)->moved->execute(parent);
+	}
+}
+
 void Frame::bindClasses(RootMovieClip *root)
 {
 	ABCVm *vm = getVm();
@@ -1002,6 +1050,50 @@ void FrameContainer::addToFrame(const DisplayListTag* t)
 	frames.back().blueprint.push_back(t);
 }
 
+/* This runs in vm thread context, and only covers loaded frames */
+void FrameContainer::buildKeyframes(uint32_t n)
+{
+	assert(n<getFramesLoaded());
+	if(keyframes.empty())
+	{
+		Keyframe k;
+		k.frame=frames.begin();
+		k.frame->updateSnapshot(k.snapshot);
+		keyframes.push_back(k);
+	}
+	while(keyframes.size()<=n/KEYFRAME_INTERVAL)
+	{
+		Keyframe k=keyframes.back();
+		for(uint32_t i=0;i<KEYFRAME_INTERVAL;i++)
+		{
+			++k.frame;
+			k.frame->updateSnapshot(k.snapshot);
+		}
+		keyframes.push_back(k);
+	}
+}
+
+std::list<Frame>::iterator FrameContainer::getFrame(uint32_t n)
+{
+	buildKeyframes(n);
+	auto it=keyframes[n/KEYFRAME_INTERVAL].frame;
+	for(uint32_t i=0;i<n%KEYFRAME_INTERVAL;i++)
+		++it;
+	return it;
+}
+
+const DisplayListSnapshot& FrameContainer::getKeyframeSnapshot(uint32_t n)
+{
+	buildKeyframes(n*KEYFRAME_INTERVAL);
+	return keyframes[n].snapshot;
+}
+
+void FrameContainer::clearFrames()
+{
+	keyframes.clear();
+	frames.clear();
+}
+
 /**
  * Find the scene to which the given frame belongs and
  * adds the frame label to that scene.
@@ -1059,7 +1151,7 @@ MovieClip::MovieClip(Class_base* c, const FrameContainer& f, bool defineSpriteTa
 void MovieClip::finalize()
 {
 	Sprite::finalize();
-	frames.clear();
+	clearFrames();
 	frameScripts.clear();
 }
 
@@ -1965,7 +2057,7 @@ Shape::Shape(Class_base* c):DisplayObject(c),TokenContainer(this),graphics(NullR
 {
 }
 
-Shape::Shape(Class_base* c, const tokensVector& tokens, float scaling):
+Shape::Shape(Class_base* c, _R<ShapeTokens> tokens, float scaling):
 	DisplayObject(c),TokenContainer(this, tokens, scaling),graphics(NullRef)
 {
 }
@@ -2834,9 +2926,10 @@ void MovieClip::initFrame()
 	 * we construct all frames from current
 	 * to next_FP.
 	 * If our next_FP is before our current,
-	 * we purge all objects on the 0th frame
+	 * we purge all objects, restore the display list
+	 * of the nearest keyframe before next_FP
 	 * and then construct all frames from
-	 * the 0th to the next_FP.
+	 * that keyframe to the next_FP.
 	 * TODO: do not purge legacy objects that were also there at state.FP,
 	 * we saw that their constructor is not run again.
 	 * We also will run the constructor on objects that got placed and deleted
@@ -2852,15 +2945,22 @@ void MovieClip::initFrame()
 
 	if(getFramesLoaded())
 	{
-		std::list<Frame>::iterator iter=frames.begin();
-		for(uint32_t i=0;i<=state.FP;i++)
+		uint32_t first=state.last_FP+1;
+		if((int)state.FP < state.last_FP)
+		{
+			uint32_t keyframe=state.FP/KEYFRAME_INTERVAL;
+			getKeyframeSnapshot(keyframe).apply(this);
+			first=keyframe*KEYFRAME_INTERVAL+1;
+		}
+		if(first<=state.FP)
 		{
-			if((int)state.FP < state.last_FP || (int)i > state.last_FP)
+			std::list<Frame>::iterator iter=getFrame(first);
+			for(uint32_t i=first;i<=state.FP;i++)
 			{
 				this->incRef(); //TODO kill ref from execute's declaration
 				iter->execute(_MR(this));
+				++iter;
 			}
-			++iter;
 		}
 	}
 
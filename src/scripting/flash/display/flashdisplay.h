@@ -187,7 +187,7 @@ protected:
 		{ return TokenContainer::hitTestImpl(last,x,y, type); }
 public:
 	Shape(Class_base* c);
-	Shape(Class_base* c, const tokensVector& tokens, float scaling);
+	Shape(Class_base* c, _R<ShapeTokens> tokens, float scaling);
 	void finalize();
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o);
@@ -404,12 +404,37 @@ public:
 	ASFUNCTION(_getNumFrames);
 };
 
+/* The legacy display list resulting from a sequence of frames, as the
+ * tag that placed the character at each depth and the last tag that
+ * moved it afterwards */
+class DisplayListSnapshot
+{
+private:
+	struct Entry
+	{
+		const DisplayListTag* placed;
+		const DisplayListTag* moved;
+		//Keeps the placement order when the snapshot is applied
+		uint32_t order;
+	};
+	std::map<uint32_t, Entry> depths;
+	uint32_t nextOrder;
+public:
+	DisplayListSnapshot():nextOrder(0){}
+	void place(uint32_t depth, const DisplayListTag* t, bool replace);
+	void move(uint32_t depth, const DisplayListTag* t);
+	void remove(uint32_t depth);
+	//Creates the snapshot children on an empty legacy display list
+	void apply(DisplayObjectContainer* parent) const;
+};
+
 class Frame
 {
 public:
 	std::list<const DisplayListTag*> blueprint;
 	std::list< std::pair<tiny_string, DictionaryTag*> > classesToBeBound;
 	void execute(_R<DisplayObjectContainer> displayList);
+	void updateSnapshot(DisplayListSnapshot& snapshot) const;
 	/**
 	 * destroyTags must be called only by the tag destructor, not by
 	 * the objects that are instance of tags
@@ -442,9 +467,27 @@ protected:
 	void setFramesLoaded(uint32_t fl) { framesLoaded = fl; }
 	FrameContainer();
 	FrameContainer(const FrameContainer& f);
+	static const uint32_t KEYFRAME_INTERVAL=32;
+	/* Returns the loaded frame n, in at most KEYFRAME_INTERVAL steps.
+	 * Only for the vm thread */
+	std::list<Frame>::iterator getFrame(uint32_t n);
+	/* Returns the snapshot of the legacy display list after the
+	 * keyframe n*KEYFRAME_INTERVAL. Only for the vm thread */
+	const DisplayListSnapshot& getKeyframeSnapshot(uint32_t n);
+	void clearFrames();
 private:
 	//No need for any lock, just make sure accesses are atomic
 	ATOMIC_INT32(framesLoaded);
+	struct Keyframe
+	{
+		std::list<Frame>::iterator frame;
+		DisplayListSnapshot snapshot;
+	};
+	/* Index of every KEYFRAME_INTERVAL-th frame, built on demand by
+	 * the vm thread over the loaded frames. It is not copied along
+	 * with the frames, as the iterators belong to this list */
+	std::vector<Keyframe> keyframes;
+	void buildKeyframes(uint32_t n);
 public:
 	void addFrameLabel(uint32_t frame, const tiny_string& label);
 };
@@ -23,6 +23,7 @@
 #include "compat.h"
 #include <iostream>
 #include "backends/audio.h"
+#include "backends/config.h"
 #include "backends/rendering.h"
 #include "backends/streamcache.h"
 #include "scripting/argconv.h"
@@ -219,15 +220,109 @@ _NR<DisplayObject> Video::hitTestImpl(_NR<DisplayObject> last, number_t x, numbe
 		return NullRef;
 }
 
+//Protects decodedSoundsSize, the bytes of samples kept by all the DecodedSounds
+static Mutex decodedSoundsMutex;
+static uint64_t decodedSoundsSize=0;
+
+DecodedSound::DecodedSound(uint32_t _expectedSize)
+	:state(EMPTY),expectedSize(_expectedSize),reservedSize(0),tooLong(false),sampleRate(0),channelCount(0)
+{
+}
+
+DecodedSound::~DecodedSound()
+{
+	release();
+}
+
+bool DecodedSound::reserve(uint64_t size)
+{
+	uint64_t budget=Config::getConfig()->getSoundCacheSize();
+	//Long sounds would take the budget away from the short, often repeated, ones
+	if(reservedSize+size>budget/16)
+	{
+		tooLong=true;
+		return false;
+	}
+	Locker l(decodedSoundsMutex);
+	if(decodedSoundsSize+size>budget)
+		return false;
+	decodedSoundsSize+=size;
+	reservedSize+=size;
+	return true;
+}
+
+void DecodedSound::release()
+{
+	Locker l(decodedSoundsMutex);
+	decodedSoundsSize-=reservedSize;
+	reservedSize=0;
+}
+
+bool DecodedSound::isDecoded()
+{
+	Locker l(mutex);
+	return state==DECODED;
+}
+
+bool DecodedSound::startFilling()
+{
+	Locker l(mutex);
+	if(state!=EMPTY)
+		return false;
+	if(!reserve(expectedSize))
+	{
+		//A full budget may have room again for the next playback
+		if(tooLong)
+			state=UNCACHEABLE;
+		return false;
+	}
+	samples.reserve(expectedSize/2);
+	state=DECODING;
+	return true;
+}
+
+bool DecodedSound::append(const int16_t* s, uint32_t count)
+{
+	assert(state==DECODING);
+	//The sample count in the tag may be wrong
+	uint64_t newSize=(uint64_t(samples.size())+count)*2;
+	if(newSize>reservedSize && !reserve(newSize-reservedSize))
+		return false;
+	samples.insert(samples.end(), s, s+count);
+	return true;
+}
+
+void DecodedSound::endFilling(bool complete, uint32_t _sampleRate, uint32_t _channelCount)
+{
+	Locker l(mutex);
+	assert(state==DECODING);
+	if(complete && !samples.empty() && _sampleRate && _channelCount)
+	{
+		sampleRate=_sampleRate;
+		channelCount=_channelCount;
+		//Give back what the tag overestimated
+		samples.shrink_to_fit();
+		Locker l2(decodedSoundsMutex);
+		decodedSoundsSize-=reservedSize-samples.size()*2;
+		reservedSize=samples.size()*2;
+		state=DECODED;
+		return;
+	}
+	std::vector<int16_t>().swap(samples);
+	release();
+	//Only sounds too long for the cache are never retried
+	state=tooLong ? UNCACHEABLE : EMPTY;
+}
+
 Sound::Sound(Class_base* c)
 	:EventDispatcher(c),downloader(NULL),soundData(new MemoryStreamCache),
 	 container(true),format(CODEC_NONE, 0, 0),bytesLoaded(0),bytesTotal(0),length(60*1000)
 {
 }
 
-Sound::Sound(Class_base* c, _R<StreamCache> data, AudioFormat _format)
+Sound::Sound(Class_base* c, _R<StreamCache> data, AudioFormat _format, _NR<DecodedSound> decoded)
 	:EventDispatcher(c),downloader(NULL),soundData(data),
-	 container(false),format(_format),
+	 container(false),format(_format),decodedSound(decoded),
 	 bytesLoaded(soundData->getReceivedLength()),
 	 bytesTotal(soundData->getReceivedLength()),length(60*1000)
 {
@@ -322,7 +417,7 @@ ASFUNCTIONBODY(Sound,play)
 	if (th->container)
 		return Class<SoundChannel>::getInstanceS(th->soundData);
 	else
-		return Class<SoundChannel>::getInstanceS(th->soundData, th->format);
+		return Class<SoundChannel>::getInstanceS(th->soundData, th->format, th->decodedSound);
 }
 
 ASFUNCTIONBODY(Sound,close)
@@ -381,9 +476,9 @@ ASFUNCTIONBODY(SoundLoaderContext,_constructor)
 ASFUNCTIONBODY_GETTER_SETTER(SoundLoaderContext,bufferTime);
 ASFUNCTIONBODY_GETTER_SETTER(SoundLoaderContext,checkPolicyFile);
 
-SoundChannel::SoundChannel(Class_base* c, _NR<StreamCache> _stream, AudioFormat _format)
+SoundChannel::SoundChannel(Class_base* c, _NR<StreamCache> _stream, AudioFormat _format, _NR<DecodedSound> decoded)
 : EventDispatcher(c),stream(_stream),stopped(false),audioDecoder(NULL),audioStream(NULL),
-  format(_format),position(0),soundTransform(_MR(Class<SoundTransform>::getInstanceS()))
+  format(_format),decodedSound(decoded),position(0),soundTransform(_MR(Class<SoundTransform>::getInstanceS()))
 {
 	if (!stream.isNull())
 	{
@@ -533,14 +628,30 @@ void SoundChannel::playStream()
 void SoundChannel::playRaw()
 {
 	assert(!stream.isNull());
+	if(!getSys()->audioManager->pluginLoaded())
+		return;
+
+	if(!decodedSound.isNull())
+	{
+		if(decodedSound->isDecoded())
+		{
+			playDecoded();
+			return;
+		}
+		//Other channels playing the sound meanwhile decode it by themselves
+		if(decodedSound->startFilling())
+		{
+			playFilling();
+			return;
+		}
+	}
+
 	FFMpegAudioDecoder *decoder = new FFMpegAudioDecoder(format.codec,
 							     format.sampleRate,
 							     format.channels,
 							     true);
 	if (!decoder)
 		return;
-	if(!getSys()->audioManager->pluginLoaded())
-		return;
 
 	AudioStream *audioStream = NULL;
 	std::streambuf *sbuf = stream->createReader();
@@ -568,6 +679,107 @@ void SoundChannel::playRaw()
 	}
 }
 
+void SoundChannel::queueSamples(PCMAudioDecoder* decoder, const int16_t* samples, uint32_t count, uint64_t offset)
+{
+	const uint32_t samplesPerSecond=decoder->sampleRate*decoder->channelCount;
+	//Queue about a tenth of a second at a time, in whole sample frames
+	const uint32_t chunkLen=min(max(samplesPerSecond/10/decoder->channelCount,1u)*decoder->channelCount,
+				    uint32_t(MAX_AUDIO_FRAME_SIZE/2));
+	uint32_t done=0;
+	while(done<count && !ACQUIRE_READ(stopped))
+	{
+		uint32_t len=min(chunkLen, count-done);
+		uint32_t time=(offset+done)*1000/samplesPerSecond;
+		decoder->decodeData((uint8_t*)(samples+done), len*2, time);
+		done+=len;
+
+		if(audioStream==NULL)
+			audioStream=getSys()->audioManager->createStreamPlugin(decoder);
+		if(audioStream)
+			position=audioStream->getPlayedTime();
+	}
+}
+
+void SoundChannel::endPlayback(PCMAudioDecoder* decoder)
+{
+	if(decoder && !ACQUIRE_READ(stopped))
+	{
+		//Wait for the complete consumption of the samples
+		decoder->setFlushing();
+		decoder->waitFlushed();
+	}
+
+	{
+		Locker l(mutex);
+		audioDecoder=NULL;
+		delete audioStream;
+		audioStream=NULL;
+	}
+	delete decoder;
+
+	if (!ACQUIRE_READ(stopped))
+	{
+		incRef();
+		getVm()->addEvent(_MR(this),_MR(Class<Event>::getInstanceS("soundComplete")));
+	}
+}
+
+void SoundChannel::playDecoded()
+{
+	//The samples are not modified once decoded, so no locking is needed
+	PCMAudioDecoder* decoder=new PCMAudioDecoder(decodedSound->sampleRate, decodedSound->channelCount);
+	{
+		Locker l(mutex);
+		audioDecoder=decoder;
+	}
+	queueSamples(decoder, &decodedSound->samples[0], decodedSound->samples.size(), 0);
+	endPlayback(decoder);
+}
+
+void SoundChannel::playFilling()
+{
+	//The sound is decoded as it plays, and the samples are
+	//both queued for playback and kept in decodedSound
+	FFMpegAudioDecoder* source=new FFMpegAudioDecoder(format.codec,format.sampleRate,format.channels,true);
+	std::streambuf *sbuf=stream->createReader();
+	istream s(sbuf);
+	std::vector<int16_t> frame(MAX_AUDIO_FRAME_SIZE/2);
+	PCMAudioDecoder* decoder=NULL;
+	bool complete=true;
+	uint64_t offset=0;
+	while(!ACQUIRE_READ(stopped) && !s.eof() && !s.fail() && !s.bad())
+	{
+		source->decodeStreamSomePackets(s, 0);
+		while(source->hasDecodedFrames())
+		{
+			uint32_t len=source->copyFrame(&frame[0], MAX_AUDIO_FRAME_SIZE)/2;
+			if(len==0)
+				continue;
+			if(!source->isValid() || source->sampleRate==0 || source->channelCount==0)
+			{
+				complete=false;
+				continue;
+			}
+			if(decoder==NULL)
+			{
+				decoder=new PCMAudioDecoder(source->sampleRate, source->channelCount);
+				Locker l(mutex);
+				audioDecoder=decoder;
+			}
+			if(complete)
+				complete=decodedSound->append(&frame[0], len);
+			queueSamples(decoder, &frame[0], len, offset);
+			offset+=len;
+		}
+	}
+	complete=complete && decoder && !ACQUIRE_READ(stopped);
+	decodedSound->endFilling(complete, source->sampleRate, source->channelCount);
+	delete source;
+	delete sbuf;
+
+	endPlayback(decoder);
+}
+
 void SoundChannel::jobFence()
 {
 	this->decRef();
@@ -33,6 +33,7 @@ namespace lightspark
 {
 
 class AudioDecoder;
+class PCMAudioDecoder;
 class NetStream;
 class StreamCache;
 
@@ -45,6 +46,47 @@ public:
 	int channels;
 };
 
+/*
+   The samples of an embedded sound, decoded while it is played for the
+   first time and reused by the following playbacks. Sounds which do not
+   fit in the budget set by the audio/soundcache setting are decoded by
+   every playback, those which failed only because the budget was full
+   are tried again by later playbacks. Sounds longer than a single sound
+   may use are never cached, and they are not decoded ahead either: each
+   playback decodes them in its own SoundChannel job, as it streams them
+*/
+class DecodedSound: public RefCountable
+{
+private:
+	enum STATE { EMPTY=0, DECODING, DECODED, UNCACHEABLE };
+	Mutex mutex;
+	STATE state;
+	uint32_t expectedSize;
+	//Bytes of the cache budget held by this sound
+	uint64_t reservedSize;
+	//Set when the sound needs more than a single sound may use
+	bool tooLong;
+	bool reserve(uint64_t size);
+	void release();
+public:
+	//Only valid after isDecoded has returned true
+	std::vector<int16_t> samples;
+	uint32_t sampleRate;
+	uint32_t channelCount;
+	//expectedSize is the size in bytes of the decoded samples
+	DecodedSound(uint32_t expectedSize);
+	~DecodedSound();
+	bool isDecoded();
+	/*
+	   Returns true if the caller has to append the samples while it
+	   decodes the sound and then call endFilling
+	*/
+	bool startFilling();
+	//Returns false if the samples do not fit in the cache
+	bool append(const int16_t* samples, uint32_t count);
+	void endFilling(bool complete, uint32_t sampleRate, uint32_t channelCount);
+};
+
 class Sound: public EventDispatcher, public ILoadable
 {
 private:
@@ -57,6 +99,7 @@ private:
 	// and format is defined by format member.
 	bool container;
 	AudioFormat format;
+	_NR<DecodedSound> decodedSound;
 	ASPROPERTY_GETTER(uint32_t,bytesLoaded);
 	ASPROPERTY_GETTER(uint32_t,bytesTotal);
 	ASPROPERTY_GETTER(number_t,length);
@@ -65,7 +108,7 @@ private:
 	void setBytesLoaded(uint32_t b);
 public:
 	Sound(Class_base* c);
-	Sound(Class_base* c, _R<StreamCache> soundData, AudioFormat format);
+	Sound(Class_base* c, _R<StreamCache> soundData, AudioFormat format, _NR<DecodedSound> decoded=NullRef);
 	~Sound();
 	static void sinit(Class_base*);
 	static void buildTraits(ASObject* o);
@@ -94,13 +137,20 @@ private:
 	AudioDecoder* audioDecoder;
 	AudioStream* audioStream;
 	AudioFormat format;
+	_NR<DecodedSound> decodedSound;
 	ASPROPERTY_GETTER_SETTER(uint32_t,position);
 	ASPROPERTY_GETTER_SETTER(_NR<SoundTransform>,soundTransform);
 	void validateSoundTransform(_NR<SoundTransform>);
 	void playStream();
 	void playRaw();
+	void playDecoded();
+	void playFilling();
+	//Queues count samples, starting offset samples from the start of the sound
+	void queueSamples(PCMAudioDecoder* decoder, const int16_t* samples, uint32_t count, uint64_t offset);
+	void endPlayback(PCMAudioDecoder* decoder);
 public:
-	SoundChannel(Class_base* c, _NR<StreamCache> stream=NullRef, AudioFormat format=AudioFormat(CODEC_NONE,0,0));
+	SoundChannel(Class_base* c, _NR<StreamCache> stream=NullRef, AudioFormat format=AudioFormat(CODEC_NONE,0,0),
+		     _NR<DecodedSound> decoded=NullRef);
 	~SoundChannel();
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o);
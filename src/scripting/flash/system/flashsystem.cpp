@@ -142,6 +142,11 @@ void ApplicationDomain::sinit(Class_base* c)
 ASFUNCTIONBODY_GETTER_SETTER(ApplicationDomain,domainMemory);
 ASFUNCTIONBODY_GETTER(ApplicationDomain,parentDomain);
 
+void ApplicationDomain::throwDomainMemoryRangeError()
+{
+	throwError<RangeError>(kInvalidRangeError);
+}
+
 void ApplicationDomain::buildTraits(ASObject* o)
 {
 }
@@ -240,9 +245,13 @@ ASFUNCTIONBODY(ApplicationDomain,getDefinition)
 	return o;
 }
 
+uint32_t ApplicationDomain::scopesGeneration=0;
+
 void ApplicationDomain::registerGlobalScope(Global* scope)
 {
 	globalScopes.push_back(scope);
+	//Cached global lookups may now resolve differently
+	scopesGeneration++;
 }
 
 ASObject* ApplicationDomain::getVariableByString(const std::string& str, ASObject*& target)
@@ -55,7 +55,10 @@ class ApplicationDomain: public ASObject
 {
 private:
 	std::vector<Global*> globalScopes;
+	/* Incremented every time a script is registered in any domain */
+	static uint32_t scopesGeneration;
 public:
+	static uint32_t getScopesGeneration() { return scopesGeneration; }
 	ApplicationDomain(Class_base* c, _NR<ApplicationDomain> p=NullRef);
 	void finalize();
 	static void sinit(Class_base* c);
@@ -76,28 +79,34 @@ public:
 	ASFUNCTION(getDefinition);
 	ASPROPERTY_GETTER_SETTER(_NR<ByteArray>, domainMemory);
 	ASPROPERTY_GETTER(_NR<ApplicationDomain>, parentDomain);
+	/*
+	 * Accessors for the Alchemy opcodes. The buffer and length are read
+	 * straight from the ByteArray on every access, so a resize is seen
+	 * without any invalidation and no reference is taken.
+	 */
 	template<class T>
 	T readFromDomainMemory(uint32_t addr) const
 	{
-		if(domainMemory.isNull())
-			throw RunTimeException("No memory domain is set");
-		uint32_t bufLen=domainMemory->getLength();
-		if(bufLen < (addr+sizeof(T)))
-			throw RunTimeException("Memory domain access is out of bounds");
-		uint8_t* buf=domainMemory->getBuffer(bufLen, false);
-		return *reinterpret_cast<T*>(buf+addr);
+		const uint8_t* buf=checkDomainMemory(addr, sizeof(T));
+		T ret;
+		memcpy(&ret, buf, sizeof(T));
+		return ret;
 	}
 	template<class T>
 	void writeToDomainMemory(uint32_t addr, T val)
 	{
-		if(domainMemory.isNull())
-			throw RunTimeException("No memory domain is set");
-		uint32_t bufLen=domainMemory->getLength();
-		if(bufLen < (addr+sizeof(T)))
-			throw RunTimeException("Memory domain access is out of bounds");
-		uint8_t* buf=domainMemory->getBuffer(bufLen, false);
-		*reinterpret_cast<T*>(buf+addr)=val;
+		uint8_t* buf=checkDomainMemory(addr, sizeof(T));
+		memcpy(buf, &val, sizeof(T));
+	}
+	uint8_t* checkDomainMemory(uint32_t addr, uint32_t size) const
+	{
+		const ByteArray* mem=domainMemory.getPtr();
+		if(mem==NULL || (uint64_t)addr+size > mem->len)
+			throwDomainMemoryRangeError();
+		return mem->bytes+addr;
 	}
+	//Throws the RangeError raised by out of bounds Alchemy accesses
+	static void throwDomainMemoryRangeError();
 };
 
 class LoaderContext: public ASObject
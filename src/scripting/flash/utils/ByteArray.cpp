@@ -25,14 +25,20 @@
 #include "parsing/amf3_generator.h"
 #include "scripting/argconv.h"
 #include "scripting/flash/errors/flasherrors.h"
+#include "parsing/streams.h"
 #include <sstream>
+#include <memory>
 #include <zlib.h>
+#include <lzma.h>
 #include <glib.h>
 
 using namespace std;
 using namespace lightspark;
 
 #define BA_CHUNK_SIZE 4096
+// the flash documentation doesn't tell how large ByteArrays are allowed to be
+// so we simply don't allow bytearrays larger than 64MiB
+#define BA_MAX_SIZE 0x4000000
 
 
 ByteArray::ByteArray(Class_base* c, uint8_t* b, uint32_t l):ASObject(c),littleEndian(false),objectEncoding(ObjectEncoding::AMF3),
@@ -77,15 +83,15 @@ void ByteArray::sinit(Class_base* c)
 	c->setDeclaredMethodByQName("inflate","",Class<IFunction>::getFunction(_inflate),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("readBoolean","",Class<IFunction>::getFunction(readBoolean),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("readBytes","",Class<IFunction>::getFunction(readBytes),NORMAL_METHOD,true);
-	c->setDeclaredMethodByQName("readByte","",Class<IFunction>::getFunction(readByte),NORMAL_METHOD,true);
-	c->setDeclaredMethodByQName("readDouble","",Class<IFunction>::getFunction(readDouble),NORMAL_METHOD,true);
-	c->setDeclaredMethodByQName("readFloat","",Class<IFunction>::getFunction(readFloat),NORMAL_METHOD,true);
-	c->setDeclaredMethodByQName("readInt","",Class<IFunction>::getFunction(readInt),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("readByte","",Class<IFunction>::getFunction(readByte,0,NATIVE_BINDING(readByte)),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("readDouble","",Class<IFunction>::getFunction(readDouble,0,NATIVE_BINDING(readDouble)),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("readFloat","",Class<IFunction>::getFunction(readFloat,0,NATIVE_BINDING(readFloat)),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("readInt","",Class<IFunction>::getFunction(readInt,0,NATIVE_BINDING(readInt)),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("readMultiByte","",Class<IFunction>::getFunction(readMultiByte),NORMAL_METHOD,true);
-	c->setDeclaredMethodByQName("readShort","",Class<IFunction>::getFunction(readShort),NORMAL_METHOD,true);
-	c->setDeclaredMethodByQName("readUnsignedByte","",Class<IFunction>::getFunction(readUnsignedByte),NORMAL_METHOD,true);
-	c->setDeclaredMethodByQName("readUnsignedInt","",Class<IFunction>::getFunction(readUnsignedInt),NORMAL_METHOD,true);
-	c->setDeclaredMethodByQName("readUnsignedShort","",Class<IFunction>::getFunction(readUnsignedShort),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("readShort","",Class<IFunction>::getFunction(readShort,0,NATIVE_BINDING(readShort)),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("readUnsignedByte","",Class<IFunction>::getFunction(readUnsignedByte,0,NATIVE_BINDING(readUnsignedByte)),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("readUnsignedInt","",Class<IFunction>::getFunction(readUnsignedInt,0,NATIVE_BINDING(readUnsignedInt)),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("readUnsignedShort","",Class<IFunction>::getFunction(readUnsignedShort,0,NATIVE_BINDING(readUnsignedShort)),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("readObject","",Class<IFunction>::getFunction(readObject),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("readUTF","",Class<IFunction>::getFunction(readUTF),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("readUTFBytes","",Class<IFunction>::getFunction(readUTFBytes),NORMAL_METHOD,true);
@@ -117,24 +123,13 @@ void ByteArray::buildTraits(ASObject* o)
 {
 }
 
-void ByteArray::lock()
-{
-	if (shareable) mutex.lock();
-}
-void ByteArray::unlock()
-{
-	if (shareable) mutex.unlock();
-}
-
 uint8_t* ByteArray::getBuffer(unsigned int size, bool enableResize)
 {
-	// the flash documentation doesn't tell how large ByteArrays are allowed to be
-	// so we simply don't allow bytearrays larger than 1GiB
-	// maybe we should set this smaller
-	if (size > 0x4000000) 
+	if (size > BA_MAX_SIZE)
 		throwError<ASError>(kOutOfMemoryError);
-	// The first allocation is exactly the size we need,
-	// the subsequent reallocations happen in increments of BA_CHUNK_SIZE bytes
+	// The first allocation is exactly the size we need, the subsequent
+	// reallocations grow the buffer by half and are rounded to BA_CHUNK_SIZE bytes
+	// so that serializing big objects byte by byte doesn't copy the data over and over
 	uint32_t prevLen = len;
 	if(bytes==NULL)
 	{
@@ -154,9 +149,10 @@ uint8_t* ByteArray::getBuffer(unsigned int size, bool enableResize)
 #ifdef MEMORY_USAGE_PROFILING
 		uint32_t prev_real_len = real_len;
 #endif
-		while(real_len < size)
-			real_len += BA_CHUNK_SIZE;
-		// Reallocate the buffer, in chunks of BA_CHUNK_SIZE bytes
+		uint32_t newLen = real_len + real_len/2;
+		if(newLen < size)
+			newLen = size;
+		real_len = (newLen + BA_CHUNK_SIZE - 1) & ~(BA_CHUNK_SIZE - 1);
 		uint8_t* bytes2 = (uint8_t*) realloc(bytes, real_len);
 #ifdef MEMORY_USAGE_PROFILING
 		getClass()->memoryAccount->addBytes(real_len-prev_real_len);
@@ -178,54 +174,6 @@ uint8_t* ByteArray::getBuffer(unsigned int size, bool enableResize)
 	return bytes;
 }
 
-uint16_t ByteArray::endianIn(uint16_t value)
-{
-	if(littleEndian)
-		return GUINT16_TO_LE(value);
-	else
-		return GUINT16_TO_BE(value);
-}
-
-uint32_t ByteArray::endianIn(uint32_t value)
-{
-	if(littleEndian)
-		return GUINT32_TO_LE(value);
-	else
-		return GUINT32_TO_BE(value);
-}
-
-uint64_t ByteArray::endianIn(uint64_t value)
-{
-	if(littleEndian)
-		return GUINT64_TO_LE(value);
-	else
-		return GUINT64_TO_BE(value);
-}
-
-uint16_t ByteArray::endianOut(uint16_t value)
-{
-	if(littleEndian)
-		return GUINT16_FROM_LE(value);
-	else
-		return GUINT16_FROM_BE(value);
-}
-
-uint32_t ByteArray::endianOut(uint32_t value)
-{
-	if(littleEndian)
-		return GUINT32_FROM_LE(value);
-	else
-		return GUINT32_FROM_BE(value);
-}
-
-uint64_t ByteArray::endianOut(uint64_t value)
-{
-	if(littleEndian)
-		return GUINT64_FROM_LE(value);
-	else
-		return GUINT64_FROM_BE(value);
-}
-
 uint32_t ByteArray::getPosition() const
 {
 	return position;
@@ -399,8 +347,9 @@ ASFUNCTIONBODY(ByteArray,readBytes)
 		throw Class<RangeError>::getInstanceS("length+offset");
 	}
 	
+	//Growing out may move the data when reading into the same ByteArray
 	uint8_t* buf=out->getBuffer(length+offset,true);
-	memcpy(buf+offset,th->bytes+th->position,length);
+	memmove(buf+offset,th->bytes+th->position,length);
 	th->position+=length;
 	th->unlock();
 
@@ -457,14 +406,14 @@ ASFUNCTIONBODY(ByteArray,readUTFBytes)
 
 void ByteArray::writeUTF(const tiny_string& str)
 {
-	getBuffer(position+str.numBytes()+2,true);
 	if(str.numBytes() > 65535)
 	{
 		throwError<RangeError>(kParamRangeError);
 	}
+	uint8_t* dest=reserveWrite(str.numBytes()+2);
 	uint16_t numBytes=endianIn((uint16_t)str.numBytes());
-	memcpy(bytes+position,&numBytes,2);
-	memcpy(bytes+position+2,str.raw_buf(),str.numBytes());
+	memcpy(dest,&numBytes,2);
+	memcpy(dest+2,str.raw_buf(),str.numBytes());
 	position+=str.numBytes()+2;
 }
 
@@ -489,9 +438,7 @@ ASFUNCTIONBODY(ByteArray,writeUTFBytes)
 	assert_and_throw(args[0]->getObjectType()==T_STRING);
 	ASString* str=Class<ASString>::cast(args[0]);
 	th->lock();
-	th->getBuffer(th->position+str->data.numBytes(),true);
-	memcpy(th->bytes+th->position,str->data.raw_buf(),str->data.numBytes());
-	th->position+=str->data.numBytes();
+	th->writeRawBytes((const uint8_t*)str->data.raw_buf(),str->data.numBytes());
 	th->unlock();
 
 	return NULL;
@@ -508,9 +455,7 @@ ASFUNCTIONBODY(ByteArray,writeMultiByte)
 	LOG(LOG_NOT_IMPLEMENTED, "ByteArray.writeMultiByte doesn't convert charset");
 
 	th->lock();
-	th->getBuffer(th->position+value.numBytes(),true);
-	memcpy(th->bytes+th->position,value.raw_buf(),value.numBytes());
-	th->position+=value.numBytes();
+	th->writeRawBytes((const uint8_t*)value.raw_buf(),value.numBytes());
 	th->unlock();
 
 	return NULL;
@@ -523,9 +468,9 @@ uint32_t ByteArray::writeObject(ASObject* obj)
 	//TODO: support AMF0
 	assert_and_throw(objectEncoding==ObjectEncoding::AMF3);
 	//TODO: support custom serialization
-	map<tiny_string, uint32_t> stringMap;
-	map<const ASObject*, uint32_t> objMap;
-	map<const Class_base*, uint32_t> traitsMap;
+	unordered_map<tiny_string, uint32_t> stringMap;
+	unordered_map<const ASObject*, uint32_t> objMap;
+	unordered_map<const Class_base*, uint32_t> traitsMap;
 	uint32_t oldPosition=position;
 	obj->serialize(this, stringMap, objMap,traitsMap);
 	return position-oldPosition;
@@ -545,9 +490,8 @@ ASFUNCTIONBODY(ByteArray,writeObject)
 
 void ByteArray::writeShort(uint16_t val)
 {
-	int16_t value2 = endianIn(val);
-	getBuffer(position+2,true);
-	memcpy(bytes+position,&value2,2);
+	uint16_t value2 = endianIn(val);
+	memcpy(reserveWrite(2),&value2,2);
 	position+=2;
 }
 
@@ -587,10 +531,11 @@ ASFUNCTIONBODY(ByteArray,writeBytes)
 	//If the length is 0 the whole buffer must be copied
 	if(length == 0)
 		length=(out->getLength()-offset);
-	uint8_t* buf=out->getBuffer(offset+length,false);
 	th->lock();
-	th->getBuffer(th->position+length,true);
-	memcpy(th->bytes+th->position,buf+offset,length);
+	uint8_t* dest=th->reserveWrite(length);
+	//The source is fetched after growing the destination, as they may be the same ByteArray
+	uint8_t* buf=out->getBuffer(offset+length,false);
+	memmove(dest,buf+offset,length);
 	th->position+=length;
 	th->unlock();
 
@@ -599,8 +544,8 @@ ASFUNCTIONBODY(ByteArray,writeBytes)
 
 void ByteArray::writeByte(uint8_t b)
 {
-	getBuffer(position+1,true);
-	bytes[position++] = b;
+	*reserveWrite(1) = b;
+	position++;
 }
 
 ASFUNCTIONBODY(ByteArray,writeByte)
@@ -643,8 +588,7 @@ ASFUNCTIONBODY(ByteArray,writeDouble)
 	uint64_t value2=th->endianIn(*intptr);
 
 	th->lock();
-	th->getBuffer(th->position+8,true);
-	memcpy(th->bytes+th->position,&value2,8);
+	memcpy(th->reserveWrite(8),&value2,8);
 	th->position+=8;
 	th->unlock();
 
@@ -661,8 +605,7 @@ ASFUNCTIONBODY(ByteArray,writeFloat)
 	uint32_t value2=th->endianIn(*intptr);
 
 	th->lock();
-	th->getBuffer(th->position+4,true);
-	memcpy(th->bytes+th->position,&value2,4);
+	memcpy(th->reserveWrite(4),&value2,4);
 	th->position+=4;
 	th->unlock();
 
@@ -677,8 +620,7 @@ ASFUNCTIONBODY(ByteArray,writeInt)
 	uint32_t value=th->endianIn(static_cast<uint32_t>(args[0]->toInt()));
 
 	th->lock();
-	th->getBuffer(th->position+4,true);
-	memcpy(th->bytes+th->position,&value,4);
+	memcpy(th->reserveWrite(4),&value,4);
 	th->position+=4;
 	th->unlock();
 
@@ -687,8 +629,7 @@ ASFUNCTIONBODY(ByteArray,writeInt)
 
 void ByteArray::writeUnsignedInt(uint32_t val)
 {
-	getBuffer(position+4,true);
-	memcpy(bytes+position,&val,4);
+	memcpy(reserveWrite(4),&val,4);
 	position+=4;
 }
 
@@ -744,8 +685,13 @@ bool ByteArray::readU29(uint32_t& ret)
 
 ASFUNCTIONBODY(ByteArray, readByte)
 {
-	ByteArray* th=static_cast<ByteArray*>(obj);
 	assert_and_throw(argslen==0);
+	return abstract_i(readByte_native(obj));
+}
+
+ASNATIVEFUNCTIONBODY(int32_t,ByteArray,readByte)
+{
+	ByteArray* th=static_cast<ByteArray*>(obj);
 
 	th->lock();
 	uint8_t ret;
@@ -755,13 +701,18 @@ ASFUNCTIONBODY(ByteArray, readByte)
 		throwError<EOFError>(kEOFError);
 	}
 	th->unlock();
-	return abstract_i((int8_t)ret);
+	return (int8_t)ret;
 }
 
 ASFUNCTIONBODY(ByteArray,readDouble)
 {
-	ByteArray* th=static_cast<ByteArray*>(obj);
 	assert_and_throw(argslen==0);
+	return abstract_d(readDouble_native(obj));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,ByteArray,readDouble)
+{
+	ByteArray* th=static_cast<ByteArray*>(obj);
 
 	th->lock();
 	if(th->len < th->position+8)
@@ -777,13 +728,18 @@ ASFUNCTIONBODY(ByteArray,readDouble)
 
 	double *doubleptr=reinterpret_cast<double*>(&ret);
 	th->unlock();
-	return abstract_d(*doubleptr);
+	return *doubleptr;
 }
 
 ASFUNCTIONBODY(ByteArray,readFloat)
 {
-	ByteArray* th=static_cast<ByteArray*>(obj);
 	assert_and_throw(argslen==0);
+	return abstract_d(readFloat_native(obj));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,ByteArray,readFloat)
+{
+	ByteArray* th=static_cast<ByteArray*>(obj);
 
 	th->lock();
 	if(th->len < th->position+4)
@@ -799,13 +755,18 @@ ASFUNCTIONBODY(ByteArray,readFloat)
 
 	float *floatptr=reinterpret_cast<float*>(&ret);
 	th->unlock();
-	return abstract_d(*floatptr);
+	return *floatptr;
 }
 
 ASFUNCTIONBODY(ByteArray,readInt)
 {
-	ByteArray* th=static_cast<ByteArray*>(obj);
 	assert_and_throw(argslen==0);
+	return abstract_i(readInt_native(obj));
+}
+
+ASNATIVEFUNCTIONBODY(int32_t,ByteArray,readInt)
+{
+	ByteArray* th=static_cast<ByteArray*>(obj);
 
 	th->lock();
 	if(th->len < th->position+4)
@@ -818,7 +779,7 @@ ASFUNCTIONBODY(ByteArray,readInt)
 	memcpy(&ret,th->bytes+th->position,4);
 	th->position+=4;
 	th->unlock();
-	return abstract_i((int32_t)th->endianOut(ret));
+	return (int32_t)th->endianOut(ret);
 }
 
 bool ByteArray::readShort(uint16_t& ret)
@@ -835,8 +796,13 @@ bool ByteArray::readShort(uint16_t& ret)
 
 ASFUNCTIONBODY(ByteArray,readShort)
 {
-	ByteArray* th=static_cast<ByteArray*>(obj);
 	assert_and_throw(argslen==0);
+	return abstract_i(readShort_native(obj));
+}
+
+ASNATIVEFUNCTIONBODY(int32_t,ByteArray,readShort)
+{
+	ByteArray* th=static_cast<ByteArray*>(obj);
 
 	uint16_t ret;
 	th->lock();
@@ -847,13 +813,18 @@ ASFUNCTIONBODY(ByteArray,readShort)
 	}
 
 	th->unlock();
-	return abstract_i((int16_t)ret);
+	return (int16_t)ret;
 }
 
 ASFUNCTIONBODY(ByteArray,readUnsignedByte)
 {
-	ByteArray* th=static_cast<ByteArray*>(obj);
 	assert_and_throw(argslen==0);
+	return abstract_ui(readUnsignedByte_native(obj));
+}
+
+ASNATIVEFUNCTIONBODY(uint32_t,ByteArray,readUnsignedByte)
+{
+	ByteArray* th=static_cast<ByteArray*>(obj);
 
 	uint8_t ret;
 	th->lock();
@@ -862,7 +833,8 @@ ASFUNCTIONBODY(ByteArray,readUnsignedByte)
 		th->unlock();
 		throwError<EOFError>(kEOFError);
 	}
-	return abstract_ui(ret);
+	th->unlock();
+	return ret;
 }
 
 bool ByteArray::readUnsignedInt(uint32_t& ret)
@@ -879,8 +851,13 @@ bool ByteArray::readUnsignedInt(uint32_t& ret)
 
 ASFUNCTIONBODY(ByteArray,readUnsignedInt)
 {
-	ByteArray* th=static_cast<ByteArray*>(obj);
 	assert_and_throw(argslen==0);
+	return abstract_ui(readUnsignedInt_native(obj));
+}
+
+ASNATIVEFUNCTIONBODY(uint32_t,ByteArray,readUnsignedInt)
+{
+	ByteArray* th=static_cast<ByteArray*>(obj);
 
 	uint32_t ret;
 	th->lock();
@@ -890,13 +867,18 @@ ASFUNCTIONBODY(ByteArray,readUnsignedInt)
 		throwError<EOFError>(kEOFError);
 	}
 	th->unlock();
-	return abstract_ui(ret);
+	return ret;
 }
 
 ASFUNCTIONBODY(ByteArray,readUnsignedShort)
 {
-	ByteArray* th=static_cast<ByteArray*>(obj);
 	assert_and_throw(argslen==0);
+	return abstract_ui(readUnsignedShort_native(obj));
+}
+
+ASNATIVEFUNCTIONBODY(uint32_t,ByteArray,readUnsignedShort)
+{
+	ByteArray* th=static_cast<ByteArray*>(obj);
 
 	uint16_t ret;
 	th->lock();
@@ -905,8 +887,8 @@ ASFUNCTIONBODY(ByteArray,readUnsignedShort)
 		th->unlock();
 		throwError<EOFError>(kEOFError);
 	}
-
-	return abstract_ui(ret);
+	th->unlock();
+	return ret;
 }
 
 ASFUNCTIONBODY(ByteArray,readMultiByte)
@@ -1062,25 +1044,31 @@ void ByteArray::acquireBuffer(uint8_t* buf, int bufLen)
 
 void ByteArray::writeU29(uint32_t val)
 {
+	uint8_t buf[4];
+	uint32_t count=0;
 	for(uint32_t i=0;i<4;i++)
 	{
-		uint8_t b;
 		if(i<3)
 		{
 			uint32_t tmp=(val >> ((3-i)*7));
 			if(tmp==0)
 				continue;
 
-			b=(tmp&0x7f)|0x80;
+			buf[count++]=(tmp&0x7f)|0x80;
 		}
 		else
-			b=val&0x7f;
-
-		writeByte(b);
+			buf[count++]=val&0x7f;
 	}
+	writeRawBytes(buf, count);
 }
 
-void ByteArray::writeStringVR(map<tiny_string, uint32_t>& stringMap, const tiny_string& s)
+void ByteArray::writeRawBytes(const uint8_t* data, uint32_t len)
+{
+	memcpy(reserveWrite(len),data,len);
+	position+=len;
+}
+
+void ByteArray::writeStringVR(unordered_map<tiny_string, uint32_t>& stringMap, const tiny_string& s)
 {
 	const uint32_t len=s.numBytes();
 	if(len >= 1<<28)
@@ -1104,14 +1092,11 @@ void ByteArray::writeStringVR(map<tiny_string, uint32_t>& stringMap, const tiny_
 		//The first bit must be 1, the next 29 bits
 		//store the number of bytes of the string
 		writeU29((len<<1) | 1);
-
-		getBuffer(position+len,true);
-		memcpy(bytes+position,s.raw_buf(),len);
-		position+=len;
+		writeRawBytes((const uint8_t*)s.raw_buf(),len);
 	}
 }
 
-void ByteArray::writeXMLString(std::map<const ASObject*, uint32_t>& objMap,
+void ByteArray::writeXMLString(std::unordered_map<const ASObject*, uint32_t>& objMap,
 			       ASObject *xml,
 			       const tiny_string& xmlstr)
 {
@@ -1133,91 +1118,230 @@ void ByteArray::writeXMLString(std::map<const ASObject*, uint32_t>& objMap,
 		//The first bit must be 1, the next 29 bits
 		//store the number of bytes of the string
 		writeU29((xmlstr.numBytes()<<1) | 1);
-
-		getBuffer(position+xmlstr.numBytes(),true);
-		memcpy(bytes+position,xmlstr.raw_buf(),xmlstr.numBytes());
-		position+=xmlstr.numBytes();
+		writeRawBytes((const uint8_t*)xmlstr.raw_buf(),xmlstr.numBytes());
 	}
 }
 
-void ByteArray::compress_zlib()
+/*
+ * Makes room for more output in a malloc'ed buffer, growing it by half so
+ * that the number of reallocations stays logarithmic in the output size.
+ * The output is limited to BA_MAX_SIZE bytes. On failure buf is left
+ * allocated, the caller has to free it.
+ */
+static uint8_t* growOutput(uint8_t* buf, uint32_t& size)
 {
-	if(len==0)
-		return;
+	if(size>=BA_MAX_SIZE)
+		throw RunTimeException("ByteArray compression output too big");
+	uint32_t newSize=min((uint64_t)size+size/2+BA_CHUNK_SIZE, (uint64_t)BA_MAX_SIZE);
+	uint8_t* ret=(uint8_t*)realloc(buf,newSize);
+	if(ret==NULL)
+		throw RunTimeException("ByteArray compression out of memory");
+	size=newSize;
+	return ret;
+}
 
-	unsigned long buflen=compressBound(len);
-	uint8_t *compressed=(uint8_t*) malloc(buflen);
-	assert_and_throw(compressed);
+static uint8_t* compressZlib(const uint8_t* in, uint32_t inLen, bool raw, uint32_t& outLen)
+{
+	z_stream strm;
+	strm.zalloc=Z_NULL;
+	strm.zfree=Z_NULL;
+	strm.opaque=Z_NULL;
+	//Negative window bits produce raw deflate data without header and checksum
+	if(deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, raw ? -MAX_WBITS : MAX_WBITS, 8, Z_DEFAULT_STRATEGY)!=Z_OK)
+		throw RunTimeException("zlib compress failed");
 
-	if(compress(compressed, &buflen, bytes, len)!=Z_OK)
+	//Most data compresses well, start small and grow if needed
+	uint32_t outSize=inLen/4+BA_CHUNK_SIZE;
+	uint8_t* out=(uint8_t*)malloc(outSize);
+	if(out==NULL)
 	{
-		free(compressed);
-		throw RunTimeException("zlib compress failed");
+		deflateEnd(&strm);
+		throw RunTimeException("ByteArray compression out of memory");
 	}
-
-	acquireBuffer(compressed, buflen);
-	position=buflen;
+	strm.next_in=const_cast<uint8_t*>(in);
+	strm.avail_in=inLen;
+	strm.next_out=out;
+	strm.avail_out=outSize;
+	int status;
+	while((status=deflate(&strm, Z_FINISH))!=Z_STREAM_END)
+	{
+		if(status!=Z_OK && status!=Z_BUF_ERROR)
+		{
+			deflateEnd(&strm);
+			free(out);
+			throw RunTimeException("zlib compress failed");
+		}
+		try
+		{
+			out=growOutput(out,outSize);
+		}
+		catch(...)
+		{
+			deflateEnd(&strm);
+			free(out);
+			throw;
+		}
+		strm.next_out=out+strm.total_out;
+		strm.avail_out=outSize-strm.total_out;
+	}
+	outLen=strm.total_out;
+	deflateEnd(&strm);
+	return out;
 }
 
-void ByteArray::uncompress_zlib()
+static uint8_t* compressLZMA(const uint8_t* in, uint32_t inLen, uint32_t& outLen)
 {
-	z_stream strm;
-	int status;
+	lzma_options_lzma options;
+	lzma_stream strm=LZMA_STREAM_INIT;
+	//Flash uses the lzma_alone format with the uncompressed size in the header.
+	//liblzma records the size as unknown and ends the data with an end marker,
+	//so the size is written over it once the data is complete. Decoders which
+	//trust the size stop before the marker
+	if(lzma_lzma_preset(&options, LZMA_PRESET_DEFAULT) || lzma_alone_encoder(&strm, &options)!=LZMA_OK)
+		throw RunTimeException("lzma compress failed");
+
+	uint32_t outSize=inLen/4+BA_CHUNK_SIZE;
+	uint8_t* out=(uint8_t*)malloc(outSize);
+	if(out==NULL)
+	{
+		lzma_end(&strm);
+		throw RunTimeException("ByteArray compression out of memory");
+	}
+	strm.next_in=in;
+	strm.avail_in=inLen;
+	strm.next_out=out;
+	strm.avail_out=outSize;
+	lzma_ret status;
+	while((status=lzma_code(&strm, LZMA_FINISH))!=LZMA_STREAM_END)
+	{
+		if(status!=LZMA_OK)
+		{
+			lzma_end(&strm);
+			free(out);
+			throw RunTimeException("lzma compress failed");
+		}
+		if(strm.avail_out!=0)
+			continue;
+		try
+		{
+			out=growOutput(out,outSize);
+		}
+		catch(...)
+		{
+			lzma_end(&strm);
+			free(out);
+			throw;
+		}
+		strm.next_out=out+strm.total_out;
+		strm.avail_out=outSize-strm.total_out;
+	}
+	outLen=strm.total_out;
+	lzma_end(&strm);
+	//Properties (1 byte) and dictionary size (4 bytes) come before the size
+	assert(outLen>=13);
+	uint64_t size=inLen;
+	for(int i=0;i<8;i++)
+	{
+		out[5+i]=size&0xff;
+		size>>=8;
+	}
+	return out;
+}
 
+void ByteArray::compress(COMPRESSION_ALGORITHM algorithm)
+{
 	if(len==0)
 		return;
 
-	strm.zalloc=Z_NULL;
-	strm.zfree=Z_NULL;
-	strm.opaque=Z_NULL;
-	strm.avail_in=len;
-	strm.next_in=bytes;
-	strm.total_out=0;
-	status=inflateInit(&strm);
-	if(status==Z_VERSION_ERROR)
-		throw Class<IOError>::getInstanceS("not valid compressed data");
-	else if(status!=Z_OK)
-		throw RunTimeException("zlib uncompress failed");
+	uint32_t outLen;
+	uint8_t* out;
+	if(algorithm==LZMA)
+		out=compressLZMA(bytes, len, outLen);
+	else
+		out=compressZlib(bytes, len, algorithm==DEFLATE, outLen);
 
-	vector<uint8_t> buf(3*len);
-	do
-	{
-		strm.next_out=&buf[strm.total_out];
-		strm.avail_out=buf.size()-strm.total_out;
-		status=inflate(&strm, Z_NO_FLUSH);
+	//Give back the slack of the last growth step
+	uint8_t* shrunk=(uint8_t*)realloc(out, outLen ? outLen : 1);
+	if(shrunk)
+		out=shrunk;
+	acquireBuffer(out, outLen);
+	position=outLen;
+}
+
+void ByteArray::uncompress(COMPRESSION_ALGORITHM algorithm)
+{
+	if(len==0)
+		return;
 
-		if(status!=Z_OK && status!=Z_STREAM_END)
+	//The data is pulled through the same decoding filters used for
+	//compressed SWF files, so only one block of input is inflated at a time
+	bytes_buf source(bytes, len);
+	uint32_t outSize=min(max(len*3, (uint32_t)BA_CHUNK_SIZE), (uint32_t)BA_MAX_SIZE);
+	uint32_t outLen=0;
+	uint8_t* out=(uint8_t*)malloc(outSize);
+	assert_and_throw(out);
+	try
+	{
+		std::unique_ptr<std::streambuf> filter;
+		if(algorithm==LZMA)
+			filter.reset(new liblzma_filter(&source, false));
+		else
+			filter.reset(new zlib_filter(&source, algorithm==DEFLATE));
+		while(true)
 		{
-			inflateEnd(&strm);
-			throw Class<IOError>::getInstanceS("not valid compressed data");
+			if(outLen==outSize)
+				out=growOutput(out,outSize);
+			streamsize count=filter->sgetn((char*)out+outLen, outSize-outLen);
+			if(count==0)
+				break;
+			outLen+=count;
 		}
+	}
+	catch(LightsparkException&)
+	{
+		free(out);
+		throw Class<IOError>::getInstanceS("not valid compressed data");
+	}
+	catch(...)
+	{
+		free(out);
+		throw;
+	}
 
-		if(strm.avail_out==0)
-			buf.resize(buf.size()+len);
-	} while(status!=Z_STREAM_END);
-
-	inflateEnd(&strm);
+	uint8_t* shrunk=(uint8_t*)realloc(out, outLen ? outLen : 1);
+	if(shrunk)
+		out=shrunk;
+	acquireBuffer(out, outLen);
+}
 
-	len=strm.total_out;
-#ifdef MEMORY_USAGE_PROFILING
-	getClass()->memoryAccount->addBytes(len-real_len);
-#endif
-	real_len = len;
-	uint8_t* bytes2=(uint8_t*) realloc(bytes, len);
-	assert_and_throw(bytes2);
-	bytes = bytes2;
-	memcpy(bytes, &buf[0], len);
-	position=0;
+ByteArray::COMPRESSION_ALGORITHM ByteArray::algorithmFromArgs(ASObject* const* args, const unsigned int argslen)
+{
+	if(argslen==0 || args[0]->is<Undefined>() || args[0]->is<Null>())
+		return ZLIB;
+	tiny_string algorithm=args[0]->toString();
+	if(algorithm=="deflate")
+		return DEFLATE;
+	if(algorithm=="lzma")
+		return LZMA;
+	// unknown algorithms are not reported, as tamarin tests do not catch
+	// the error, so they fall back to zlib
+	return ZLIB;
 }
 
 ASFUNCTIONBODY(ByteArray,_compress)
 {
 	ByteArray* th=static_cast<ByteArray*>(obj);
-	// flash throws an error if compress is called with a compression algorithm,
-	// and always uses the zlib algorithm
-	// but tamarin tests do not catch it, so we simply ignore any parameters provided
+	COMPRESSION_ALGORITHM algorithm=algorithmFromArgs(args, argslen);
 	th->lock();
-	th->compress_zlib();
+	try
+	{
+		th->compress(algorithm);
+	}
+	catch(...)
+	{
+		th->unlock();
+		throw;
+	}
 	th->unlock();
 	return NULL;
 }
@@ -1225,20 +1349,35 @@ ASFUNCTIONBODY(ByteArray,_compress)
 ASFUNCTIONBODY(ByteArray,_uncompress)
 {
 	ByteArray* th=static_cast<ByteArray*>(obj);
-	// flash throws an error if uncompress is called with a compression algorithm,
-	// and always uses the zlib algorithm
-	// but tamarin tests do not catch it, so we simply ignore any parameters provided
+	COMPRESSION_ALGORITHM algorithm=algorithmFromArgs(args, argslen);
 	th->lock();
-	th->uncompress_zlib();
+	try
+	{
+		th->uncompress(algorithm);
+	}
+	catch(...)
+	{
+		th->unlock();
+		throw;
+	}
 	th->unlock();
 	return NULL;
 }
 
+// deflate and inflate work on raw deflate data, without the zlib wrapper
 ASFUNCTIONBODY(ByteArray,_deflate)
 {
 	ByteArray* th=static_cast<ByteArray*>(obj);
 	th->lock();
-	th->compress_zlib();
+	try
+	{
+		th->compress(DEFLATE);
+	}
+	catch(...)
+	{
+		th->unlock();
+		throw;
+	}
 	th->unlock();
 	return NULL;
 }
@@ -1247,7 +1386,15 @@ ASFUNCTIONBODY(ByteArray,_inflate)
 {
 	ByteArray* th=static_cast<ByteArray*>(obj);
 	th->lock();
-	th->uncompress_zlib();
+	try
+	{
+		th->uncompress(DEFLATE);
+	}
+	catch(...)
+	{
+		th->unlock();
+		throw;
+	}
 	th->unlock();
 	return NULL;
 }
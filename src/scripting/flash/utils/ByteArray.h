@@ -31,6 +31,8 @@ class ByteArray: public ASObject, public IDataInput, public IDataOutput
 {
 friend class LoaderThread;
 friend class URLLoader;
+friend class Amf3Deserializer;
+friend class ApplicationDomain;
 protected:
 	bool littleEndian;
 	uint8_t objectEncoding;
@@ -38,12 +40,29 @@ protected:
 	uint8_t* bytes;
 	uint32_t real_len;
 	uint32_t len;
-	void compress_zlib();
-	void uncompress_zlib();
+	enum COMPRESSION_ALGORITHM { ZLIB, DEFLATE, LZMA };
+	static COMPRESSION_ALGORITHM algorithmFromArgs(ASObject* const* args, const unsigned int argslen);
+	/*
+	 * Both work in place, streaming through the codec into a buffer that
+	 * grows with the output instead of allocating worst case sizes upfront
+	 */
+	void compress(COMPRESSION_ALGORITHM algorithm);
+	void uncompress(COMPRESSION_ALGORITHM algorithm);
 	Mutex mutex;
-	void lock();
-	void unlock();
+	//Only ByteArrays shared with workers need locking
+	void lock() { if (shareable) mutex.lock(); }
+	void unlock() { if (shareable) mutex.unlock(); }
 	void setLength(uint32_t newLen);
+	/*
+	 * Returns where size bytes can be written at the current position,
+	 * the buffer is only reallocated when the data doesn't fit
+	 */
+	uint8_t* reserveWrite(uint32_t size)
+	{
+		if((uint64_t)position+size > len)
+			getBuffer(position+size,true);
+		return bytes+position;
+	}
 public:
 	ByteArray(Class_base* c, uint8_t* b = NULL, uint32_t l = 0);
 	~ByteArray();
@@ -57,9 +76,11 @@ public:
 	void writeShort(uint16_t val);
 	void writeUnsignedInt(uint32_t val);
 	void writeUTF(const tiny_string& str);
+	//Copies len bytes from data at the current position
+	void writeRawBytes(const uint8_t* data, uint32_t len);
 	uint32_t writeObject(ASObject* obj);
-	void writeStringVR(std::map<tiny_string, uint32_t>& stringMap, const tiny_string& s);
-	void writeXMLString(std::map<const ASObject*, uint32_t>& objMap, ASObject *xml, const tiny_string& s);
+	void writeStringVR(std::unordered_map<tiny_string, uint32_t>& stringMap, const tiny_string& s);
+	void writeXMLString(std::unordered_map<const ASObject*, uint32_t>& objMap, ASObject *xml, const tiny_string& s);
 	void writeU29(uint32_t val);
 	uint32_t getPosition() const;
 	void setPosition(uint32_t p);
@@ -82,16 +103,24 @@ public:
 	ASFUNCTION(clear);
 	ASFUNCTION(readBoolean);
 	ASFUNCTION(readByte);
+	ASNATIVEFUNCTION(int32_t,readByte);
 	ASFUNCTION(readBytes);
 	ASFUNCTION(readDouble);
+	ASNATIVEFUNCTION(number_t,readDouble);
 	ASFUNCTION(readFloat);
+	ASNATIVEFUNCTION(number_t,readFloat);
 	ASFUNCTION(readInt);
+	ASNATIVEFUNCTION(int32_t,readInt);
 	ASFUNCTION(readMultiByte);
 	ASFUNCTION(readObject);
 	ASFUNCTION(readShort);
+	ASNATIVEFUNCTION(int32_t,readShort);
 	ASFUNCTION(readUnsignedByte);
+	ASNATIVEFUNCTION(uint32_t,readUnsignedByte);
 	ASFUNCTION(readUnsignedInt);
+	ASNATIVEFUNCTION(uint32_t,readUnsignedInt);
 	ASFUNCTION(readUnsignedShort);
+	ASNATIVEFUNCTION(uint32_t,readUnsignedShort);
 	ASFUNCTION(readUTF);
 	ASFUNCTION(readUTFBytes);
 	ASFUNCTION(writeBoolean);
@@ -127,13 +156,13 @@ public:
 	uint8_t* getBuffer(unsigned int size, bool enableResize);
 	uint32_t getLength() const { return len; }
 
-	uint16_t endianIn(uint16_t value);
-	uint32_t endianIn(uint32_t value);
-	uint64_t endianIn(uint64_t value);
+	uint16_t endianIn(uint16_t value) { return littleEndian ? GUINT16_TO_LE(value) : GUINT16_TO_BE(value); }
+	uint32_t endianIn(uint32_t value) { return littleEndian ? GUINT32_TO_LE(value) : GUINT32_TO_BE(value); }
+	uint64_t endianIn(uint64_t value) { return littleEndian ? GUINT64_TO_LE(value) : GUINT64_TO_BE(value); }
 
-	uint16_t endianOut(uint16_t value);
-	uint32_t endianOut(uint32_t value);
-	uint64_t endianOut(uint64_t value);
+	uint16_t endianOut(uint16_t value) { return littleEndian ? GUINT16_FROM_LE(value) : GUINT16_FROM_BE(value); }
+	uint32_t endianOut(uint32_t value) { return littleEndian ? GUINT32_FROM_LE(value) : GUINT32_FROM_BE(value); }
+	uint64_t endianOut(uint64_t value) { return littleEndian ? GUINT64_FROM_LE(value) : GUINT64_FROM_BE(value); }
 
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o);
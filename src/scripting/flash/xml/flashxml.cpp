@@ -287,9 +287,9 @@ ASFUNCTIONBODY(XMLDocument,_constructor)
 	return NULL;
 }
 
-void XMLDocument::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void XMLDocument::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	out->writeByte(xml_doc_marker);
 	out->writeXMLString(objMap, this, toString());
@@ -85,7 +85,7 @@ void ASString::sinit(Class_base* c)
 	c->setDeclaredMethodByQName("search",AS3,Class<IFunction>::getFunction(search),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("indexOf",AS3,Class<IFunction>::getFunction(indexOf,2),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("lastIndexOf",AS3,Class<IFunction>::getFunction(lastIndexOf,2),NORMAL_METHOD,true);
-	c->setDeclaredMethodByQName("charCodeAt",AS3,Class<IFunction>::getFunction(charCodeAt),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("charCodeAt",AS3,Class<IFunction>::getFunction(charCodeAt,1,NATIVE_BINDING(charCodeAt)),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("charAt",AS3,Class<IFunction>::getFunction(charAt,1),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("slice",AS3,Class<IFunction>::getFunction(slice,2),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("toLocaleLowerCase",AS3,Class<IFunction>::getFunction(toLowerCase),NORMAL_METHOD,true);
@@ -110,7 +110,7 @@ void ASString::sinit(Class_base* c)
 	c->prototype->setVariableByQName("search","",Class<IFunction>::getFunction(search),DYNAMIC_TRAIT);
 	c->prototype->setVariableByQName("indexOf","",Class<IFunction>::getFunction(indexOf,2),DYNAMIC_TRAIT);
 	c->prototype->setVariableByQName("lastIndexOf","",Class<IFunction>::getFunction(lastIndexOf,2),DYNAMIC_TRAIT);
-	c->prototype->setVariableByQName("charCodeAt","",Class<IFunction>::getFunction(charCodeAt),DYNAMIC_TRAIT);
+	c->prototype->setVariableByQName("charCodeAt","",Class<IFunction>::getFunction(charCodeAt,1,NATIVE_BINDING(charCodeAt)),DYNAMIC_TRAIT);
 	c->prototype->setVariableByQName("charAt","",Class<IFunction>::getFunction(charAt,1),DYNAMIC_TRAIT);
 	c->prototype->setVariableByQName("slice","",Class<IFunction>::getFunction(slice,2),DYNAMIC_TRAIT);
 	c->prototype->setVariableByQName("toLocaleLowerCase","",Class<IFunction>::getFunction(toLowerCase),DYNAMIC_TRAIT);
@@ -132,56 +132,28 @@ ASFUNCTIONBODY(ASString,search)
 	if(argslen == 0 || args[0]->getObjectType() == T_UNDEFINED)
 		return abstract_i(-1);
 
-	int options=PCRE_UTF8|PCRE_NEWLINE_ANY|PCRE_JAVASCRIPT_COMPAT;
-	tiny_string restr;
+	_NR<CompiledRegExp> compiled;
 	if(args[0]->getClass() && args[0]->getClass()==Class<RegExp>::getClass())
-	{
-		RegExp* re=static_cast<RegExp*>(args[0]);
-		restr = re->source;
-		if(re->ignoreCase)
-			options|=PCRE_CASELESS;
-		if(re->extended)
-			options|=PCRE_EXTENDED;
-		if(re->multiline)
-			options|=PCRE_MULTILINE;
-		if(re->dotall)
-			options|=PCRE_DOTALL;
-	}
+		compiled = static_cast<RegExp*>(args[0])->compile();
 	else
-	{
-		restr = args[0]->toString();
-	}
-
-	const char* error;
-	int errorOffset;
-	pcre* pcreRE=pcre_compile(restr.raw_buf(), options, &error, &errorOffset,NULL);
-	if(error)
+		compiled = RegExp::compile(args[0]->toString(), RegExp::defaultOptions);
+	if(compiled.isNull())
 		return abstract_i(ret);
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return abstract_i(ret);
-	}
-	pcre_extra extra;
-	extra.match_limit_recursion=200;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+
+	const int capturingGroups=compiled->capturingGroups;
 	int ovector[(capturingGroups+1)*3];
 	int offset=0;
 	//Global is not used in search
-	int rc=pcre_exec(pcreRE, &extra, data.raw_buf(), data.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+	int rc=compiled->exec(data, offset, ovector, (capturingGroups+1)*3);
 	if(rc<0)
 	{
 		//No matches or error
-		pcre_free(pcreRE);
 		return abstract_i(ret);
 	}
 	ret=ovector[0];
 	// pcre_exec returns byte position, so we have to convert it to character position 
 	tiny_string tmp = data.substr_bytes(0, ret);
 	ret = tmp.numChars();
-	pcre_free(pcreRE);
 	return abstract_i(ret);
 }
 
@@ -288,19 +260,10 @@ ASFUNCTIONBODY(ASString,split)
 			return ret;
 		}
 
-		pcre* pcreRE = re->compile();
-		if (!pcreRE)
-			return ret;
-		int capturingGroups;
-		int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-		if(infoOk!=0)
-		{
-			pcre_free(pcreRE);
+		_NR<CompiledRegExp> compiled = re->compile();
+		if (compiled.isNull())
 			return ret;
-		}
-		pcre_extra extra;
-		extra.match_limit_recursion=200;
-		extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+		const int capturingGroups=compiled->capturingGroups;
 		int ovector[(capturingGroups+1)*3];
 		int offset=0;
 		unsigned int end;
@@ -308,7 +271,7 @@ ASFUNCTIONBODY(ASString,split)
 		do
 		{
 			//offset is a byte offset that must point to the beginning of an utf8 character
-			int rc=pcre_exec(pcreRE, &extra, data.raw_buf(), data.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+			int rc=compiled->exec(data, offset, ovector, (capturingGroups+1)*3);
 			end=ovector[0];
 			if(rc<0)
 				break;
@@ -340,7 +303,6 @@ ASFUNCTIONBODY(ASString,split)
 			ASString* s=Class<ASString>::getInstanceS(data.substr_bytes(lastMatch,data.numBytes()-lastMatch));
 			ret->push(_MR(s));
 		}
-		pcre_free(pcreRE);
 	}
 	else
 	{
@@ -460,6 +422,11 @@ double ASString::toNumber() const
 		s = g_utf8_next_char(s);
 
 	double val;
+	//Fast path for the common case of a plain decimal number
+	const char* fastEnd;
+	if (Number::parseDecimalFast(s, &fastEnd, val) && *fastEnd=='\0')
+		return val;
+
 	char *end = NULL;
 	val = parseStringInfinite(s, &end);
 
@@ -571,9 +538,9 @@ TRISTATE ASString::isLess(ASObject* r)
 	return (a<b)?TTRUE:TFALSE;
 }
 
-void ASString::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void ASString::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	out->writeByte(string_marker);
 	out->writeStringVR(stringMap, data);
@@ -624,15 +591,22 @@ ASFUNCTIONBODY(ASString,charAt)
 
 ASFUNCTIONBODY(ASString,charCodeAt)
 {
-	tiny_string data = obj->toString();
 	number_t index;
 	ARG_UNPACK (index, 0);
+	return abstract_d(charCodeAt_native(obj,index));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,ASString,charCodeAt,number_t index)
+{
+	//Avoid copying the string when this is already an ASString
+	tiny_string converted;
+	const tiny_string& data = obj->is<ASString>() ? obj->as<ASString>()->data : (converted = obj->toString());
 	if(index<0 || index>=data.numChars() || std::isinf(index) || std::isnan(index))
-		return abstract_d(Number::NaN);
+		return Number::NaN;
 	else
 	{
 		//Character codes are expected to be positive
-		return abstract_i(data.charAt(index));
+		return data.charAt(index);
 	}
 }
 
@@ -726,20 +700,11 @@ ASFUNCTIONBODY(ASString,replace)
 	{
 		RegExp* re=static_cast<RegExp*>(args[0]);
 
-		pcre* pcreRE = re->compile();
-		if (!pcreRE)
+		_NR<CompiledRegExp> compiled = re->compile();
+		if (compiled.isNull())
 			return ret;
 
-		int capturingGroups;
-		int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-		if(infoOk!=0)
-		{
-			pcre_free(pcreRE);
-			return ret;
-		}
-		pcre_extra extra;
-		extra.match_limit_recursion=200;
-		extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+		const int capturingGroups=compiled->capturingGroups;
 		int ovector[(capturingGroups+1)*3];
 		int offset=0;
 		int retDiff=0;
@@ -747,11 +712,10 @@ ASFUNCTIONBODY(ASString,replace)
 		do
 		{
 			tiny_string replaceWithTmp = replaceWith;
-			int rc=pcre_exec(pcreRE, &extra, ret->data.raw_buf(), ret->data.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+			int rc=compiled->exec(ret->data, offset, ovector, (capturingGroups+1)*3);
 			if(rc<0)
 			{
 				//No matches or error
-				pcre_free(pcreRE);
 				return ret;
 			}
 			prevsubstring += ret->data.substr_bytes(offset,ovector[0]-offset);
@@ -820,8 +784,6 @@ ASFUNCTIONBODY(ASString,replace)
 			retDiff+=replaceWithTmp.numBytes()-(ovector[1]-ovector[0]);
 		}
 		while(re->global);
-
-		pcre_free(pcreRE);
 	}
 	else
 	{
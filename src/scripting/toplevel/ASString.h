@@ -48,6 +48,7 @@ public:
 	ASFUNCTION(_constructor);
 	ASFUNCTION(charAt);
 	ASFUNCTION(charCodeAt);
+	ASNATIVEFUNCTION(number_t,charCodeAt,number_t index);
 	ASFUNCTION(concat);
 	ASFUNCTION(fromCharCode);
 	ASFUNCTION(indexOf);
@@ -70,9 +71,9 @@ public:
 	uint32_t toUInt();
 	ASFUNCTION(generator);
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	std::string toDebugString() { return std::string("\"") + std::string(data) + "\""; }
 	static bool isEcmaSpace(uint32_t c);
 	static bool isEcmaLineTerminator(uint32_t c);
@@ -58,7 +58,7 @@ void Array::sinit(Class_base* c)
 	c->setDeclaredMethodByQName("join",AS3,Class<IFunction>::getFunction(join,1),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("map",AS3,Class<IFunction>::getFunction(_map,1),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("pop",AS3,Class<IFunction>::getFunction(_pop),NORMAL_METHOD,true);
-	c->setDeclaredMethodByQName("push",AS3,Class<IFunction>::getFunction(_push_as3,1),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("push",AS3,Class<IFunction>::getFunction(_push_as3,1,NATIVE_VARIADIC_BINDING(_push_as3)),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("reverse",AS3,Class<IFunction>::getFunction(_reverse),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("shift",AS3,Class<IFunction>::getFunction(shift),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("slice",AS3,Class<IFunction>::getFunction(slice,2),NORMAL_METHOD,true);
@@ -677,64 +677,93 @@ ASFUNCTIONBODY(Array,_pop)
 	return ret;
 }
 
-bool Array::sortComparatorDefault::operator()(const data_slot& d1, const data_slot& d2)
+SortKeys::SortKeys(const std::vector<sorton_field>& f, uint32_t count):
+	fields(f),numberColumns(0),stringColumns(0),elements(count)
 {
-	if(isNumeric)
-	{
-		number_t a=numeric_limits<double>::quiet_NaN();
-		number_t b=numeric_limits<double>::quiet_NaN();
-		if(d1.type==DATA_INT)
-			a=d1.data_i;
-		else if(d1.type==DATA_OBJECT && d1.data)
-			a=d1.data->toNumber();
-
-		if(d2.type==DATA_INT)
-			b=d2.data_i;
-		else if(d2.type==DATA_OBJECT && d2.data)
-			b=d2.data->toNumber();
+	for(uint32_t i=0;i<fields.size();i++)
+		columns.push_back(fields[i].isNumeric ? numberColumns++ : stringColumns++);
+	numbers.resize(numberColumns*elements);
+	strings.resize(stringColumns*elements);
+}
 
-		if(std::isnan(a) || std::isnan(b))
+void SortKeys::setKey(uint32_t element, uint32_t field, ASObject* o)
+{
+	if(fields[field].isNumeric)
+	{
+		number_t n=o ? o->toNumber() : numeric_limits<double>::quiet_NaN();
+		//A single element is never compared, so it is accepted as is
+		if(std::isnan(n) && elements>1)
 			throw RunTimeException("Cannot sort non number with Array.NUMERIC option");
-		if(isDescending)
-			return b>a;
-		else
-			return a<b;
+		numbers[element*numberColumns+columns[field]]=n;
 	}
+	else if(o)
+		setStringKey(element, field, o->toString());
 	else
+		setStringKey(element, field, "undefined");
+}
+
+void SortKeys::setKey(uint32_t element, uint32_t field, int32_t i)
+{
+	if(fields[field].isNumeric)
+		numbers[element*numberColumns+columns[field]]=i;
+	else
+		setStringKey(element, field, Integer::toString(i));
+}
+
+void SortKeys::setStringKey(uint32_t element, uint32_t field, const tiny_string& s)
+{
+	tiny_string& key=strings[element*stringColumns+columns[field]];
+	if(fields[field].isCaseInsensitive)
 	{
-		//Comparison is always in lexicographic order
-		tiny_string s1;
-		tiny_string s2;
-		if(d1.type==DATA_INT)
-			s1=Integer::toString(d1.data_i);
-		else if(d1.type==DATA_OBJECT && d1.data)
-			s1=d1.data->toString();
-		else
-			s1="undefined";
-		if(d2.type==DATA_INT)
-			s2=Integer::toString(d2.data_i);
-		else if(d2.type==DATA_OBJECT && d2.data)
-			s2=d2.data->toString();
-		else
-			s2="undefined";
+		//The collation key of the case folded string orders like
+		//tiny_string::strcasecmp, but it is computed only once
+		char* folded=g_utf8_casefold(s.raw_buf(),s.numBytes());
+		char* collated=g_utf8_collate_key(folded,-1);
+		key=tiny_string(collated,true);
+		g_free(folded);
+		g_free(collated);
+	}
+	else
+		key=s;
+}
 
-		if(isDescending)
-		{
-			//TODO: unicode support
-			if(isCaseInsensitive)
-				return s1.strcasecmp(s2)>0;
-			else
-				return s1>s2;
-		}
-		else
-		{
-			//TODO: unicode support
-			if(isCaseInsensitive)
-				return s1.strcasecmp(s2)<0;
-			else
-				return s1<s2;
-		}
+int SortKeys::compareField(uint32_t field, uint32_t a, uint32_t b) const
+{
+	uint32_t column=columns[field];
+	if(fields[field].isNumeric)
+	{
+		number_t n1=numbers[a*numberColumns+column];
+		number_t n2=numbers[b*numberColumns+column];
+		return (n1<n2) ? -1 : ((n1>n2) ? 1 : 0);
+	}
+	//Comparison is always in lexicographic order
+	//TODO: unicode support
+	const tiny_string& s1=strings[a*stringColumns+column];
+	const tiny_string& s2=strings[b*stringColumns+column];
+	int ret=memcmp(s1.raw_buf(),s2.raw_buf(),std::min(s1.numBytes(),s2.numBytes()));
+	if(ret!=0)
+		return ret;
+	return (s1.numBytes()<s2.numBytes()) ? -1 : ((s1.numBytes()>s2.numBytes()) ? 1 : 0);
+}
+
+bool SortKeys::operator()(uint32_t a, uint32_t b) const
+{
+	for(uint32_t i=0;i<fields.size();i++)
+	{
+		int ret=compareField(i,a,b);
+		if(ret!=0)
+			return fields[i].isDescending ? ret>0 : ret<0;
 	}
+	return false;
+}
+
+std::vector<uint32_t> SortKeys::sortedOrder() const
+{
+	std::vector<uint32_t> order(elements);
+	for(uint32_t i=0;i<elements;i++)
+		order[i]=i;
+	std::stable_sort(order.begin(),order.end(),indexComparator(*this));
+	return order;
 }
 
 bool Array::sortComparatorWrapper::operator()(const data_slot& d1, const data_slot& d2)
@@ -793,84 +822,46 @@ ASFUNCTIONBODY(Array,_sort)
 				throw UnsupportedException("Array::sort not completely implemented");
 		}
 	}
-	std::vector<data_slot> tmp = vector<data_slot>(th->data.size());
-	std::map<uint32_t, data_slot>::iterator it=th->data.begin();
-	int i = 0;
-	for(;it != th->data.end();++it)
+	std::vector<data_slot> tmp;
+	tmp.reserve(th->data.size());
+	for(auto it=th->data.begin();it != th->data.end();++it)
+		tmp.push_back(it->second);
+
+	if(comp)
 	{
-		tmp[i++]= it->second;
+		//The user comparator may be inconsistent, a merge sort never
+		//reads out of bounds in that case
+		stable_sort(tmp.begin(),tmp.end(),sortComparatorWrapper(comp));
+		th->setSortedData(tmp,NULL);
 	}
-	
-	if(comp)
-		sort(tmp.begin(),tmp.end(),sortComparatorWrapper(comp));
 	else
-		sort(tmp.begin(),tmp.end(),sortComparatorDefault(isNumeric,isCaseInsensitive,isDescending));
-
-	th->data.clear();
-	std::vector<data_slot>::iterator ittmp=tmp.begin();
-	i = 0;
-	for(;ittmp != tmp.end();++ittmp)
 	{
-		th->data[i++]= *ittmp;
+		multiname elementname(NULL);
+		std::vector<sorton_field> sortfields(1,sorton_field(elementname));
+		sortfields[0].isNumeric=isNumeric;
+		sortfields[0].isCaseInsensitive=isCaseInsensitive;
+		sortfields[0].isDescending=isDescending;
+		SortKeys keys(sortfields,tmp.size());
+		for(uint32_t i=0;i<tmp.size();i++)
+		{
+			if(tmp[i].type==DATA_INT)
+				keys.setKey(i,0,tmp[i].data_i);
+			else
+				keys.setKey(i,0,tmp[i].data);
+		}
+		std::vector<uint32_t> order=keys.sortedOrder();
+		th->setSortedData(tmp,&order);
 	}
 	obj->incRef();
 	return obj;
 }
 
-bool Array::sortOnComparator::operator()(const data_slot& d1, const data_slot& d2)
+void Array::setSortedData(const std::vector<data_slot>& slots, const std::vector<uint32_t>* order)
 {
-	std::vector<sorton_field>::iterator it=fields.begin();
-	for(;it != fields.end();++it)
-	{
-		assert_and_throw(d1.type == DATA_OBJECT && d1.type == DATA_OBJECT);
-
-		_NR<ASObject> obj1 = d1.data->getVariableByMultiname(it->fieldname);
-		_NR<ASObject> obj2 = d2.data->getVariableByMultiname(it->fieldname);
-		if(it->isNumeric)
-		{
-			number_t a=numeric_limits<double>::quiet_NaN();
-			number_t b=numeric_limits<double>::quiet_NaN();
-			a=obj1->toNumber();
-			
-			b=obj2->toNumber();
-			
-			if(std::isnan(a) || std::isnan(b))
-				throw RunTimeException("Cannot sort non number with Array.NUMERIC option");
-			if (b != a)
-			{
-				if(it->isDescending)
-					return b>a;
-				else
-					return a<b;
-			}
-		}
-		else
-		{
-			//Comparison is always in lexicographic order
-			tiny_string s1;
-			tiny_string s2;
-			s1=obj1->toString();
-			s2=obj2->toString();
-			if (s1 != s2)
-			{
-				if(it->isDescending)
-				{
-					if(it->isCaseInsensitive)
-						return s1.strcasecmp(s2)>0;
-					else
-						return s1>s2;
-				}
-				else
-				{
-					if(it->isCaseInsensitive)
-						return s1.strcasecmp(s2)<0;
-					else
-						return s1<s2;
-				}
-			}
-		}
-	}
-	return false;
+	data.clear();
+	//The indices are increasing, so each insertion happens at the end
+	for(uint32_t i=0;i<slots.size();i++)
+		data.insert(data.end(),make_pair(i,slots[order ? (*order)[i] : i]));
 }
 
 ASFUNCTIONBODY(Array,sortOn)
@@ -883,7 +874,6 @@ ASFUNCTIONBODY(Array,sortOn)
 	if(args[0]->is<Array>())
 	{
 		Array* obj=static_cast<Array*>(args[0]);
-		int n = 0;
 		std::map<uint32_t, data_slot>::iterator it=obj->data.begin();
 		for(;it != obj->data.end();++it)
 		{
@@ -900,8 +890,8 @@ ASFUNCTIONBODY(Array,sortOn)
 		{
 			Array* opts=static_cast<Array*>(args[1]);
 			std::map<uint32_t, data_slot>::iterator itopt=opts->data.begin();
-			int nopt = 0;
-			for(;itopt != opts->data.end() && nopt < n;++itopt)
+			uint32_t nopt = 0;
+			for(;itopt != opts->data.end() && nopt < sortfields.size();++itopt)
 			{
 				uint32_t options=0;
 				if (itopt->second.type == DATA_OBJECT)
@@ -941,23 +931,24 @@ ASFUNCTIONBODY(Array,sortOn)
 		sortfields.push_back(sf);
 	}
 	
-	std::vector<data_slot> tmp = vector<data_slot>(th->data.size());
-	std::map<uint32_t, data_slot>::iterator it=th->data.begin();
-	int i = 0;
-	for(;it != th->data.end();++it)
-	{
-		tmp[i++]= it->second;
-	}
-	
-	sort(tmp.begin(),tmp.end(),sortOnComparator(sortfields));
+	std::vector<data_slot> tmp;
+	tmp.reserve(th->data.size());
+	for(auto it=th->data.begin();it != th->data.end();++it)
+		tmp.push_back(it->second);
 
-	th->data.clear();
-	std::vector<data_slot>::iterator ittmp=tmp.begin();
-	i = 0;
-	for(;ittmp != tmp.end();++ittmp)
+	//The fields are looked up once per element instead of on every comparison
+	SortKeys keys(sortfields,tmp.size());
+	for(uint32_t i=0;i<tmp.size();i++)
 	{
-		th->data[i++]= *ittmp;
+		assert_and_throw(tmp[i].type == DATA_OBJECT && tmp[i].data);
+		for(uint32_t j=0;j<sortfields.size();j++)
+		{
+			_NR<ASObject> field=tmp[i].data->getVariableByMultiname(sortfields[j].fieldname);
+			keys.setKey(i,j,field.getPtr());
+		}
 	}
+	std::vector<uint32_t> order=keys.sortedOrder();
+	th->setSortedData(tmp,&order);
 	obj->incRef();
 	return obj;
 }
@@ -1530,11 +1521,10 @@ void Array::resize(uint64_t n)
 	currentsize = n;
 }
 
-void Array::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Array::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
-	assert_and_throw(objMap.find(this)==objMap.end());
 	out->writeByte(array_marker);
 	//Check if the array has been already serialized
 	auto it=objMap.find(this);
@@ -1560,7 +1550,11 @@ void Array::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap
 			switch(data.at(i).type)
 			{
 				case DATA_INT:
-					throw UnsupportedException("int not supported in Array::serialize");
+				{
+					_R<ASObject> tmp=_MR(abstract_i(data.at(i).data_i));
+					tmp->serialize(out, stringMap, objMap, traitsMap);
+					break;
+				}
 				case DATA_OBJECT:
 					data.at(i).data->serialize(out, stringMap, objMap, traitsMap);
 			}
@@ -1568,57 +1562,65 @@ void Array::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap
 	}
 }
 
-tiny_string Array::toJSON(std::vector<ASObject *> &path, IFunction *replacer, const tiny_string& spaces,const tiny_string& filter)
+void Array::toJSON(std::string& out, std::vector<ASObject *> &path, IFunction *replacer, const tiny_string& spaces,const tiny_string& filter)
 {
 	if (has_toJSON())
 	{
-		return call_toJSON();
+		const tiny_string res=call_toJSON();
+		out.append(res.raw_buf(),res.numBytes());
+		return;
 	}
 
-	tiny_string res = "[";
+	out += '[';
 	std::map<uint32_t,data_slot>::iterator it;
 	// check for cylic reference
 	if (std::find(path.begin(),path.end(), this) != path.end())
 		throwError<TypeError>(kJSONCyclicStructure);
 	path.push_back(this);
 	bool bfirst = true;
-	tiny_string newline = (spaces.empty() ? "" : "\n");
+	const char* newline = (spaces.empty() ? "" : "\n");
 	for (it=data.begin() ; it != data.end(); ++it)
 	{
-		if(it->second.type==DATA_OBJECT && it->second.data)
+		if(it->second.type==DATA_OBJECT && it->second.data==NULL)
+			continue;
+		//The separator is written before the element and dropped again if the element turns out to be empty
+		const size_t mark = out.size();
+		if (!bfirst)
+			out += ',';
+		out += newline;
+		out += spaces.raw_buf();
+		const size_t elementStart = out.size();
+		_R<ASObject> element=_MR(it->second.type==DATA_INT ? abstract_i(it->second.data_i) : it->second.data);
+		if(it->second.type==DATA_OBJECT)
+			element->incRef();
+		if (replacer != NULL)
 		{
-			tiny_string subres;
-			if (replacer != NULL)
-			{
-				ASObject* params[2];
-				
-				params[0] = Class<Number>::getInstanceS(it->first);
-				params[0]->incRef();
-				params[1] = it->second.data;
-				params[1]->incRef();
-				ASObject *funcret=replacer->call(getSys()->getNullRef(), params, 2);
-				if (funcret)
-					subres = funcret->toJSON(path,NULL,spaces,filter);
-			}
-			else
-				subres = it->second.data->toJSON(path,replacer,spaces,filter);
-			if (!subres.empty())
+			ASObject* params[2];
+			
+			params[0] = Class<Number>::getInstanceS(it->first);
+			params[1] = element.getPtr();
+			params[1]->incRef();
+			ASObject *funcret=replacer->call(getSys()->getNullRef(), params, 2);
+			if (funcret)
 			{
-				if (!bfirst)
-					res += ",";
-				res += newline+spaces;
-
-				bfirst = false;
-				res += subres;
+				funcret->toJSON(out,path,NULL,spaces,filter);
+				funcret->decRef();
 			}
-			path.push_back(it->second.data);
 		}
+		else
+			element->toJSON(out,path,replacer,spaces,filter);
+		if (out.size() == elementStart)
+			out.resize(mark);
+		else
+			bfirst = false;
 	}
 	if (!bfirst)
-		res += newline+spaces.substr_bytes(0,spaces.numBytes()/2);
-	res += "]";
-	return res;
-	
+	{
+		out += newline;
+		out.append(spaces.raw_buf(),spaces.numBytes()/2);
+	}
+	out += ']';
+	path.pop_back();
 }
 
 Array::~Array()
@@ -48,6 +48,42 @@ struct sorton_field
 	sorton_field(const multiname& sortfieldname):isNumeric(false),isCaseInsensitive(false),isDescending(false),fieldname(sortfieldname){}
 };
 
+/*
+ * Decorate-sort-undecorate helper for the builtin sort orders: the keys of
+ * every element are extracted once, then the element indices are ordered by
+ * a stable merge sort that only compares the precomputed keys.
+ */
+class SortKeys
+{
+private:
+	const std::vector<sorton_field>& fields;
+	//Column of each field in either numbers or strings
+	std::vector<uint32_t> columns;
+	uint32_t numberColumns;
+	uint32_t stringColumns;
+	uint32_t elements;
+	std::vector<number_t> numbers;
+	std::vector<tiny_string> strings;
+	void setStringKey(uint32_t element, uint32_t field, const tiny_string& s);
+	int compareField(uint32_t field, uint32_t a, uint32_t b) const;
+	class indexComparator
+	{
+	private:
+		const SortKeys& keys;
+	public:
+		indexComparator(const SortKeys& k):keys(k){}
+		bool operator()(uint32_t a, uint32_t b) const { return keys(a,b); }
+	};
+public:
+	SortKeys(const std::vector<sorton_field>& f, uint32_t count);
+	//A NULL o is handled as undefined
+	void setKey(uint32_t element, uint32_t field, ASObject* o);
+	void setKey(uint32_t element, uint32_t field, int32_t i);
+	bool operator()(uint32_t a, uint32_t b) const;
+	//Returns the element indices in sorted order
+	std::vector<uint32_t> sortedOrder() const;
+};
+
 
 class Array: public ASObject
 {
@@ -60,17 +96,6 @@ protected:
 	void outofbounds() const;
 	~Array();
 private:
-	enum SORTTYPE { CASEINSENSITIVE=1, DESCENDING=2, UNIQUESORT=4, RETURNINDEXEDARRAY=8, NUMERIC=16 };
-	class sortComparatorDefault
-	{
-	private:
-		bool isNumeric;
-		bool isCaseInsensitive;
-		bool isDescending;
-	public:
-		sortComparatorDefault(bool n, bool ci, bool d):isNumeric(n),isCaseInsensitive(ci),isDescending(d){}
-		bool operator()(const data_slot& d1, const data_slot& d2);
-	};
 	class sortComparatorWrapper
 	{
 	private:
@@ -79,19 +104,15 @@ private:
 		sortComparatorWrapper(IFunction* c):comparator(c){}
 		bool operator()(const data_slot& d1, const data_slot& d2);
 	};
-	class sortOnComparator
-	{
-	private:
-		std::vector<sorton_field> fields;
-	public:
-		sortOnComparator(const std::vector<sorton_field>& sf):fields(sf){}
-		bool operator()(const data_slot& d1, const data_slot& d2);
-	};
+	//Replaces the contents with slots, reordered by order when given
+	void setSortedData(const std::vector<data_slot>& slots, const std::vector<uint32_t>* order);
 	void constructorImpl(ASObject* const* args, const unsigned int argslen);
 	tiny_string toString_priv(bool localized=false) const;
 	int capIndex(int i) const;
 	static bool isIntegerWithoutLeadingZeros(const tiny_string& value);
 public:
+	//Also accepted by Vector.sort
+	enum SORTTYPE { CASEINSENSITIVE=1, DESCENDING=2, UNIQUESORT=4, RETURNINDEXEDARRAY=8, NUMERIC=16 };
 	Array(Class_base* c);
 	void finalize();
 	//These utility methods are also used by ByteArray
@@ -163,10 +184,10 @@ public:
 	_R<ASObject> nextName(uint32_t index);
 	_R<ASObject> nextValue(uint32_t index);
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
-	virtual tiny_string toJSON(std::vector<ASObject *> &path,IFunction* replacer, const tiny_string &spaces,const tiny_string& filter);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
+	virtual void toJSON(std::string& out, std::vector<ASObject *> &path,IFunction* replacer, const tiny_string &spaces,const tiny_string& filter);
 };
 
 
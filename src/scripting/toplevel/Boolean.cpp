@@ -113,9 +113,9 @@ ASFUNCTIONBODY(Boolean,_valueOf)
 	return abstract_b(obj->as<Boolean>()->val);
 }
 
-void Boolean::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Boolean::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if(val)
 		out->writeByte(true_marker);
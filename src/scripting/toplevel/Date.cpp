@@ -1115,9 +1115,9 @@ TRISTATE Date::isLess(ASObject* o)
 	return ASObject::isLess(o);
 }
 
-void Date::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Date::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	throw UnsupportedException("Date::serialize not implemented");
 }
@@ -109,9 +109,9 @@ public:
 	TRISTATE isLess(ASObject* r);
 	tiny_string toString();
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 }
 #endif /* SCRIPTING_TOPLEVEL_DATE_H */
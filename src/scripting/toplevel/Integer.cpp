@@ -173,16 +173,11 @@ tiny_string Integer::toString()
 tiny_string Integer::toString(int32_t val)
 {
 	char buf[20];
-	if(val<0)
-	{
-		//This can be a slow path, as it not used for array access
-		snprintf(buf,20,"%i",val);
-		return tiny_string(buf,true);
-	}
 	buf[19]=0;
 	char* cur=buf+19;
 
-	int v=val;
+	//Work on the absolute value as unsigned, so that INT32_MIN does not overflow
+	uint32_t v=(val<0)?-(uint32_t)val:val;
 	do
 	{
 		cur--;
@@ -190,6 +185,11 @@ tiny_string Integer::toString(int32_t val)
 		v/=10;
 	}
 	while(v!=0);
+	if(val<0)
+	{
+		cur--;
+		*cur='-';
+	}
 	return tiny_string(cur,true); //Create a copy
 }
 
@@ -205,9 +205,9 @@ void Integer::sinit(Class_base* c)
 	c->prototype->setVariableByQName("valueOf","",Class<IFunction>::getFunction(_valueOf),DYNAMIC_TRAIT);
 }
 
-void Integer::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Integer::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	out->writeByte(integer_marker);
 	//TODO: check behaviour for negative value
@@ -127,39 +127,90 @@ ASFUNCTIONBODY(JSON,_stringify)
 				spaces = spaces.substr_bytes(0,10);
 		}
 	}
-	tiny_string res = value->toJSON(path,replacer,spaces,filter);
+	std::string res;
+	value->toJSON(res,path,replacer,spaces,filter);
 
 	return Class<ASString>::getInstanceS(res);
 }
-void JSON::parseAll(const tiny_string &jsonstring, ASObject** parent , const multiname& key, IFunction *reviver)
+/*
+ * The parser works directly on the UTF-8 bytes of the input: all the
+ * structural characters of JSON are ASCII, so they can never be confused
+ * with the bytes of a multibyte sequence
+ */
+static inline bool isJSONWhitespace(char c)
 {
-	int len = jsonstring.numBytes();
-	int pos = 0;
-	while (pos < len)
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline int skipWhitespace(const char* buf, int len, int pos)
+{
+	while (pos < len && isJSONWhitespace(buf[pos]))
+		pos++;
+	return pos;
+}
+
+/*
+ * Reads the 4 hex digits of a \u escape starting at pos
+ */
+static bool parseHex4(const char* buf, int len, int pos, uint32_t& ret)
+{
+	if (pos+4 > len)
+		return false;
+	ret = 0;
+	for (int i = 0; i < 4; i++)
 	{
-		if (*parent && (*parent)->isPrimitive())
-			throwError<SyntaxError>(kJSONInvalidParseInput);
-		pos = parse(jsonstring, pos, parent , key, reviver);
-		while (jsonstring.charAt(pos) == ' ' ||
-			   jsonstring.charAt(pos) == '\t' ||
-			   jsonstring.charAt(pos) == '\n' ||
-			   jsonstring.charAt(pos) == '\r'
-			   )
-			pos++;
+		char c = buf[pos+i];
+		ret <<= 4;
+		if (c >= '0' && c <= '9')
+			ret |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			ret |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			ret |= c - 'A' + 10;
+		else
+			return false;
 	}
+	return true;
+}
+
+/*
+ * Stores a parsed value. Array elements are appended to the storage and object
+ * members are stored as dynamic variables, skipping the generic multiname lookup
+ */
+static void setParsedValue(ASObject** parent, const multiname& key, ASObject* value)
+{
+	if (*parent == NULL)
+		*parent = value;
+	else if (key.name_type == multiname::NAME_INT && (*parent)->is<Array>() &&
+			(*parent)->as<Array>()->size() == (uint32_t)key.name_i)
+		(*parent)->as<Array>()->push(_MR(value));
+	else if (key.name_type == multiname::NAME_STRING && (*parent)->getClass() == Class<ASObject>::getClass())
+		(*parent)->setDynamicVariableNoCheck(key.name_s_id,value);
+	else
+		(*parent)->setVariableByMultiname(key,value,ASObject::CONST_NOT_ALLOWED);
+}
+
+void JSON::parseAll(const tiny_string &jsonstring, ASObject** parent , const multiname& key, IFunction *reviver)
+{
+	const char* buf = jsonstring.raw_buf();
+	int len = jsonstring.numBytes();
+	//The input must hold exactly one value
+	int pos = skipWhitespace(buf, len, 0);
+	if (pos >= len)
+		throwError<SyntaxError>(kJSONInvalidParseInput);
+	pos = parse(jsonstring, pos, parent , key, reviver);
+	pos = skipWhitespace(buf, len, pos);
+	if (pos < len)
+		throwError<SyntaxError>(kJSONInvalidParseInput);
 }
 int JSON::parse(const tiny_string &jsonstring, int pos, ASObject** parent , const multiname& key, IFunction *reviver)
 {
-	while (jsonstring.charAt(pos) == ' ' ||
-		   jsonstring.charAt(pos) == '\t' ||
-		   jsonstring.charAt(pos) == '\n' ||
-		   jsonstring.charAt(pos) == '\r'
-		   )
-		   pos++;
+	const char* buf = jsonstring.raw_buf();
 	int len = jsonstring.numBytes();
+	pos = skipWhitespace(buf, len, pos);
 	if (pos < len)
 	{
-		char c = jsonstring.charAt(pos);
+		char c = buf[pos];
 		switch(c)
 		{
 			case '{':
@@ -244,199 +295,122 @@ int JSON::parse(const tiny_string &jsonstring, int pos, ASObject** parent , cons
 int JSON::parseTrue(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key)
 {
 	int len = jsonstring.numBytes();
-	if (len >= pos+4)
-	{
-		if (jsonstring.charAt(pos) == 't' && 
-				jsonstring.charAt(pos + 1) == 'r' &&
-				jsonstring.charAt(pos + 2) == 'u' && 
-				jsonstring.charAt(pos + 3) == 'e')
-		{
-			pos += 4;
-			if (*parent == NULL)
-				*parent = abstract_b(true);
-			else 
-				(*parent)->setVariableByMultiname(key,abstract_b(true),ASObject::CONST_NOT_ALLOWED);
-		}
-		else
-			throwError<SyntaxError>(kJSONInvalidParseInput);
-	}
-	else
+	if (len < pos+4 || memcmp(jsonstring.raw_buf()+pos,"true",4) != 0)
 		throwError<SyntaxError>(kJSONInvalidParseInput);
-	return pos;
+	setParsedValue(parent,key,abstract_b(true));
+	return pos+4;
 }
 int JSON::parseFalse(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key)
 {
 	int len = jsonstring.numBytes();
-	if (len >= pos+5)
-	{
-		if (jsonstring.charAt(pos) == 'f' && 
-				jsonstring.charAt(pos + 1) == 'a' &&
-				jsonstring.charAt(pos + 2) == 'l' && 
-				jsonstring.charAt(pos + 3) == 's' && 
-				jsonstring.charAt(pos + 4) == 'e')
-		{
-			pos += 5;
-			if (*parent == NULL)
-				*parent = abstract_b(false);
-			else 
-				(*parent)->setVariableByMultiname(key,abstract_b(false),ASObject::CONST_NOT_ALLOWED);
-		}
-		else
-			throwError<SyntaxError>(kJSONInvalidParseInput);
-	}
-	else
+	if (len < pos+5 || memcmp(jsonstring.raw_buf()+pos,"false",5) != 0)
 		throwError<SyntaxError>(kJSONInvalidParseInput);
-	return pos;
+	setParsedValue(parent,key,abstract_b(false));
+	return pos+5;
 }
 int JSON::parseNull(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key)
 {
 	int len = jsonstring.numBytes();
-	if (len >= pos+4)
-	{
-		if (jsonstring.charAt(pos) == 'n' && 
-				jsonstring.charAt(pos + 1) == 'u' &&
-				jsonstring.charAt(pos + 2) == 'l' && 
-				jsonstring.charAt(pos + 3) == 'l')
-		{
-			pos += 4;
-			if (*parent == NULL)
-				*parent = getSys()->getNullRef();
-			else 
-				(*parent)->setVariableByMultiname(key,getSys()->getNullRef(),ASObject::CONST_NOT_ALLOWED);
-		}
-		else
-			throwError<SyntaxError>(kJSONInvalidParseInput);
-	}
-	else
+	if (len < pos+4 || memcmp(jsonstring.raw_buf()+pos,"null",4) != 0)
 		throwError<SyntaxError>(kJSONInvalidParseInput);
-	return pos;
+	setParsedValue(parent,key,getSys()->getNullRef());
+	return pos+4;
 }
 int JSON::parseString(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key, tiny_string* result)
 {
+	const char* buf = jsonstring.raw_buf();
+	int len = jsonstring.numBytes();
 	pos++; // ignore starting quotes
-	int len = jsonstring.numChars();
 	if (pos >= len)
 		throwError<SyntaxError>(kJSONInvalidParseInput);
 
-	tiny_string sub = jsonstring.substr(pos,len-pos);
-	
-	tiny_string res;
+	//Copy the longest run without escapes at once, usually it's the whole string
+	int runEnd = pos;
+	while (runEnd < len && buf[runEnd] != '\"' && buf[runEnd] != '\\' && (unsigned char)buf[runEnd] >= 0x20)
+		runEnd++;
+	std::string res(buf+pos,runEnd-pos);
+	pos = runEnd;
+
 	bool done = false;
-	for (CharIterator it=sub.begin(); it!=sub.end(); it++)
+	while (pos < len)
 	{
-		pos++;
-		if (*it == '\"')
+		char c = buf[pos++];
+		if (c == '\"')
 		{
 			done = true;
 			break;
 		}
-		else if(*it == '\\')
+		else if(c == '\\')
 		{
-			it++;
-			pos++;
-			if(it == sub.end())
+			if(pos >= len)
 				break;
-			if(*it == '\"')
+			c = buf[pos++];
+			if(c == '\"')
 				res += '\"';
-			else if(*it == '\\')
+			else if(c == '\\')
 				res += '\\';
-			else if(*it == '/')
+			else if(c == '/')
 				res += '/';
-			else if(*it == 'b')
+			else if(c == 'b')
 				res += '\b';
-			else if(*it == 'f')
+			else if(c == 'f')
 				res += '\f';
-			else if(*it == 'n')
+			else if(c == 'n')
 				res += '\n';
-			else if(*it == 'r')
+			else if(c == 'r')
 				res += '\r';
-			else if(*it == 't')
+			else if(c == 't')
 				res += '\t';
-			else if(*it == 'u')
+			else if(c == 'u')
 			{
-				tiny_string strhex;
-				for (int i = 0; i < 4; i++)
+				uint32_t hexnum;
+				if (!parseHex4(buf, len, pos, hexnum))
+					throwError<SyntaxError>(kJSONInvalidParseInput);
+				pos += 4;
+				if (hexnum < 0x20 && hexnum != 0xf)
+					throwError<SyntaxError>(kJSONInvalidParseInput);
+				//A high surrogate followed by a low one encodes a single character
+				uint32_t lownum;
+				if (hexnum >= 0xd800 && hexnum <= 0xdbff && pos+2 <= len &&
+					buf[pos] == '\\' && buf[pos+1] == 'u' &&
+					parseHex4(buf, len, pos+2, lownum) && lownum >= 0xdc00 && lownum <= 0xdfff)
 				{
-					it++; pos++; 
-					if (it==sub.end()) 
-						throwError<SyntaxError>(kJSONInvalidParseInput);
-					switch(*it)
-					{
-						case '0':
-						case '1':
-						case '2':
-						case '3':
-						case '4':
-						case '5':
-						case '6':
-						case '7':
-						case '8':
-						case '9':
-						case 'a':
-						case 'b':
-						case 'c':
-						case 'd':
-						case 'e':
-						case 'f':
-						case 'A':
-						case 'B':
-						case 'C':
-						case 'D':
-						case 'E':
-						case 'F':
-							strhex += *it;
-							break;
-						default:
-							throwError<SyntaxError>(kJSONInvalidParseInput);
-					}
-					if (it==sub.end()) 
-						throwError<SyntaxError>(kJSONInvalidParseInput);
+					hexnum = 0x10000 + ((hexnum - 0xd800) << 10) + (lownum - 0xdc00);
+					pos += 6;
 				}
-				int64_t hexnum;
-				if (Integer::fromStringFlashCompatible(strhex.raw_buf(),hexnum,16))
-				{
-					if (hexnum < 0x20 && hexnum != 0xf)
-						throwError<SyntaxError>(kJSONInvalidParseInput);
-					res += tiny_string::fromChar(hexnum);
-				}
-				else
-					break;
+				tiny_string ch = tiny_string::fromChar(hexnum);
+				res.append(ch.raw_buf(),ch.numBytes());
 			}
 			else
 				throwError<SyntaxError>(kJSONInvalidParseInput);
 		}
-		else if (*it < 0x20)
+		else if ((unsigned char)c < 0x20)
 		{
 			throwError<SyntaxError>(kJSONInvalidParseInput);
 		}
 		else
 		{
-			res += *it;
+			res += c;
 		}
 	}
 	if (!done)
 		throwError<SyntaxError>(kJSONInvalidParseInput);
 	
 	if (parent != NULL)
-	{
-		if (*parent == NULL)
-			*parent = Class<ASString>::getInstanceS(res);
-		else 
-			(*parent)->setVariableByMultiname(key,Class<ASString>::getInstanceS(res),ASObject::CONST_NOT_ALLOWED);
-	}
+		setParsedValue(parent,key,Class<ASString>::getInstanceS(res));
 	if (result)
 		*result =res;
 	return pos;
 }
 int JSON::parseNumber(const tiny_string &jsonstring, int pos, ASObject** parent, const multiname& key)
 {
+	const char* buf = jsonstring.raw_buf();
 	int len = jsonstring.numBytes();
-	tiny_string res;
+	int start = pos;
 	bool done = false;
 	while (!done && pos < len)
 	{
-		char c = jsonstring.charAt(pos);
-		switch(c)
+		switch(buf[pos])
 		{
 			case '0':
 			case '1':
@@ -453,7 +427,6 @@ int JSON::parseNumber(const tiny_string &jsonstring, int pos, ASObject** parent,
 			case '.':
 			case 'E':
 			case 'e':
-				res += c;
 				pos++;
 				break;
 			default:
@@ -461,29 +434,30 @@ int JSON::parseNumber(const tiny_string &jsonstring, int pos, ASObject** parent,
 				break;
 		}
 	}
-	ASString* numstr = Class<ASString>::getInstanceS(res);
-	number_t num = numstr->toNumber();
-
-	if (std::isnan(num))
-		throwError<SyntaxError>(kJSONInvalidParseInput);
-
-	if (*parent == NULL)
-		*parent = Class<Number>::getInstanceS(num);
-	else 
+	//g_ascii_strtod needs a terminated string, short numbers don't allocate
+	std::string numstr(buf+start,pos-start);
+	const char* end = NULL;
+	number_t num;
+	if (!Number::parseDecimalFast(numstr.c_str(), &end, num))
 	{
-		(*parent)->setVariableByMultiname(key,Class<Number>::getInstanceS(num),ASObject::CONST_NOT_ALLOWED);
+		char* strtodEnd = NULL;
+		num = g_ascii_strtod(numstr.c_str(), &strtodEnd);
+		end = strtodEnd;
 	}
+	//All the characters must be part of the number
+	if (numstr.empty() || end != numstr.c_str()+numstr.size() || std::isnan(num))
+		throwError<SyntaxError>(kJSONInvalidParseInput);
+
+	setParsedValue(parent,key,Class<Number>::getInstanceS(num));
 	return pos;
 }
 int JSON::parseObject(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key, IFunction *reviver)
 {
-	int len = jsonstring.numChars();
+	const char* buf = jsonstring.raw_buf();
+	int len = jsonstring.numBytes();
 	pos++; // ignore '{' or ','
 	ASObject* subobj = Class<ASObject>::getInstanceS();
-	if (*parent == NULL)
-		*parent = subobj;
-	else 
-		(*parent)->setVariableByMultiname(key,subobj,ASObject::CONST_NOT_ALLOWED);
+	setParsedValue(parent,key,subobj);
 	multiname name(NULL);
 	name.name_type=multiname::NAME_STRING;
 	name.ns.push_back(nsNameAndKind("",NAMESPACE));
@@ -493,15 +467,12 @@ int JSON::parseObject(const tiny_string &jsonstring, int pos,ASObject** parent,c
 	bool needkey = true;
 	bool needvalue = false;
 
-	while (!done && pos < len)
+	while (!done)
 	{
-		while (jsonstring.charAt(pos) == ' ' ||
-			   jsonstring.charAt(pos) == '\t' ||
-			   jsonstring.charAt(pos) == '\n' ||
-			   jsonstring.charAt(pos) == '\r'
-			   )
-			pos++;
-		char c = jsonstring.charAt(pos);
+		pos = skipWhitespace(buf, len, pos);
+		if (pos >= len)
+			break;
+		char c = buf[pos];
 		switch(c)
 		{
 			case '}':
@@ -512,6 +483,8 @@ int JSON::parseObject(const tiny_string &jsonstring, int pos,ASObject** parent,c
 				break;
 			case '\"':
 				{
+					if (!needkey)
+						throwError<SyntaxError>(kJSONInvalidParseInput);
 					tiny_string keyname;
 					pos = parseString(jsonstring,pos,NULL,name,&keyname);
 					name.name_s_id=getSys()->getUniqueStringId(keyname);
@@ -527,6 +500,8 @@ int JSON::parseObject(const tiny_string &jsonstring, int pos,ASObject** parent,c
 				needkey = true;
 				break;
 			case ':':
+				if (needkey || !needvalue)
+					throwError<SyntaxError>(kJSONInvalidParseInput);
 				pos++;
 				pos = parse(jsonstring,pos,&subobj,name,reviver);
 				needvalue = false;
@@ -544,42 +519,48 @@ int JSON::parseObject(const tiny_string &jsonstring, int pos,ASObject** parent,c
 
 int JSON::parseArray(const tiny_string &jsonstring, int pos, ASObject** parent, const multiname& key, IFunction *reviver)
 {
-	int len = jsonstring.numChars();
+	const char* buf = jsonstring.raw_buf();
+	int len = jsonstring.numBytes();
 	pos++; // ignore '['
 	ASObject* subobj = Class<Array>::getInstanceS();
-	if (*parent == NULL)
-		*parent = subobj;
-	else 
-		(*parent)->setVariableByMultiname(key,subobj,ASObject::CONST_NOT_ALLOWED);
+	setParsedValue(parent,key,subobj);
 	multiname name(NULL);
 	name.name_type=multiname::NAME_INT;
 	name.name_i = 0;
 	name.ns.push_back(nsNameAndKind("",NAMESPACE));
 	name.isAttribute = false;
 	bool done = false;
-	while (!done && pos < len)
+	bool bfirst = true;
+	bool needvalue = false;
+	while (!done)
 	{
-		while (jsonstring.charAt(pos) == ' ' ||
-			   jsonstring.charAt(pos) == '\t' ||
-			   jsonstring.charAt(pos) == '\n' ||
-			   jsonstring.charAt(pos) == '\r'
-			   )
-			pos++;
-		char c = jsonstring.charAt(pos);
+		pos = skipWhitespace(buf, len, pos);
+		if (pos >= len)
+			break;
+		char c = buf[pos];
 		switch(c)
 		{
 			case ']':
+				if (needvalue)
+					throwError<SyntaxError>(kJSONInvalidParseInput);
 				done = true;
 				pos++;
 				break;
 			case ',':
+				if (bfirst || needvalue)
+					throwError<SyntaxError>(kJSONInvalidParseInput);
 				name.name_i++;
+				needvalue = true;
 				pos++;
 				break;
 			default:
+				if (!bfirst && !needvalue)
+					throwError<SyntaxError>(kJSONInvalidParseInput);
 				pos = parse(jsonstring,pos,&subobj,name, reviver);
+				needvalue = false;
 				break;
 		}
+		bfirst=false;
 	}
 	if (!done)
 		throwError<SyntaxError>(kJSONInvalidParseInput);
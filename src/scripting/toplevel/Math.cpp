@@ -38,24 +38,24 @@ void Math::sinit(Class_base* c)
 	c->setVariableByQName("SQRT2","",abstract_d(1.4142135623730951),CONSTANT_TRAIT);
 
 	// public methods
-	c->setDeclaredMethodByQName("abs","",Class<IFunction>::getFunction(abs,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("acos","",Class<IFunction>::getFunction(acos,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("asin","",Class<IFunction>::getFunction(asin,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("atan","",Class<IFunction>::getFunction(atan,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("atan2","",Class<IFunction>::getFunction(atan2,2),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("ceil","",Class<IFunction>::getFunction(ceil,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("cos","",Class<IFunction>::getFunction(cos,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("exp","",Class<IFunction>::getFunction(exp,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("floor","",Class<IFunction>::getFunction(floor,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("log","",Class<IFunction>::getFunction(log,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("max","",Class<IFunction>::getFunction(_max,2),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("min","",Class<IFunction>::getFunction(_min,2),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("pow","",Class<IFunction>::getFunction(pow,2),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("random","",Class<IFunction>::getFunction(random),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("round","",Class<IFunction>::getFunction(round,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("sin","",Class<IFunction>::getFunction(sin,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("sqrt","",Class<IFunction>::getFunction(sqrt,1),NORMAL_METHOD,false);
-	c->setDeclaredMethodByQName("tan","",Class<IFunction>::getFunction(tan,1),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("abs","",Class<IFunction>::getFunction(abs,1,NATIVE_BINDING(abs)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("acos","",Class<IFunction>::getFunction(acos,1,NATIVE_BINDING(acos)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("asin","",Class<IFunction>::getFunction(asin,1,NATIVE_BINDING(asin)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("atan","",Class<IFunction>::getFunction(atan,1,NATIVE_BINDING(atan)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("atan2","",Class<IFunction>::getFunction(atan2,2,NATIVE_BINDING(atan2)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("ceil","",Class<IFunction>::getFunction(ceil,1,NATIVE_BINDING(ceil)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("cos","",Class<IFunction>::getFunction(cos,1,NATIVE_BINDING(cos)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("exp","",Class<IFunction>::getFunction(exp,1,NATIVE_BINDING(exp)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("floor","",Class<IFunction>::getFunction(floor,1,NATIVE_BINDING(floor)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("log","",Class<IFunction>::getFunction(log,1,NATIVE_BINDING(log)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("max","",Class<IFunction>::getFunction(_max,2,NATIVE_BINDING(_max)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("min","",Class<IFunction>::getFunction(_min,2,NATIVE_BINDING(_min)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("pow","",Class<IFunction>::getFunction(pow,2,NATIVE_BINDING(pow)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("random","",Class<IFunction>::getFunction(random,0,NATIVE_BINDING(random)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("round","",Class<IFunction>::getFunction(round,1,NATIVE_BINDING(round)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("sin","",Class<IFunction>::getFunction(sin,1,NATIVE_BINDING(sin)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("sqrt","",Class<IFunction>::getFunction(sqrt,1,NATIVE_BINDING(sqrt)),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("tan","",Class<IFunction>::getFunction(tan,1,NATIVE_BINDING(tan)),NORMAL_METHOD,false);
 }
 
 ASFUNCTIONBODY(Math,_constructor)
@@ -74,163 +74,246 @@ ASFUNCTIONBODY(Math,atan2)
 {
 	number_t n1, n2;
 	ARG_UNPACK (n1) (n2);
-	return abstract_d(::atan2(n1,n2));
+	return abstract_d(atan2_native(obj,n1,n2));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,Math,atan2,number_t n1,number_t n2)
+{
+	return ::atan2(n1,n2);
+}
+
+number_t Math::maxOf(number_t largest, number_t arg)
+{
+	if (std::isnan(largest) || std::isnan(arg))
+		return numeric_limits<double>::quiet_NaN();
+	if(largest == arg && signbit(largest) > signbit(arg))
+		return 0.0; //Spec 15.8.2.11: 0.0 should be larger than -0.0
+	return (arg>largest) ? arg : largest;
+}
+
+number_t Math::minOf(number_t smallest, number_t arg)
+{
+	if (std::isnan(smallest) || std::isnan(arg))
+		return numeric_limits<double>::quiet_NaN();
+	if(smallest == arg && signbit(arg) > signbit(smallest))
+		return -0.0; //Spec 15.8.2.11: 0.0 should be larger than -0.0
+	return (arg<smallest) ? arg : smallest;
 }
 
 ASFUNCTIONBODY(Math,_max)
 {
+	//Spec 15.8.2.11: all the arguments are converted, even after a NaN
 	double largest = -numeric_limits<double>::infinity();
-
 	for(unsigned int i = 0; i < argslen; i++)
-	{
-		double arg = args[i]->toNumber();
-		if (std::isnan(arg))
-		{
-			largest = numeric_limits<double>::quiet_NaN();
-			break;
-		}
-		if(largest == arg && signbit(largest) > signbit(arg))
-			largest = 0.0; //Spec 15.8.2.11: 0.0 should be larger than -0.0
-		else
-			largest = (arg>largest) ? arg : largest;
-	}
+		largest = maxOf(largest, args[i]->toNumber());
 	return abstract_d(largest);
 }
 
+ASNATIVEFUNCTIONBODY(number_t,Math,_max,number_t n1,number_t n2)
+{
+	return maxOf(maxOf(-numeric_limits<double>::infinity(), n1), n2);
+}
+
 ASFUNCTIONBODY(Math,_min)
 {
+	//Spec 15.8.2.12: all the arguments are converted, even after a NaN
 	double smallest = numeric_limits<double>::infinity();
-
 	for(unsigned int i = 0; i < argslen; i++)
-	{
-		double arg = args[i]->toNumber();
-		if (std::isnan(arg))
-		{
-			smallest = numeric_limits<double>::quiet_NaN();
-			break;
-		}
-		if(smallest == arg && signbit(arg) > signbit(smallest))
-			smallest = -0.0; //Spec 15.8.2.11: 0.0 should be larger than -0.0
-		else
-			smallest = (arg<smallest)? arg : smallest;
-	}
-
+		smallest = minOf(smallest, args[i]->toNumber());
 	return abstract_d(smallest);
 }
 
+ASNATIVEFUNCTIONBODY(number_t,Math,_min,number_t n1,number_t n2)
+{
+	return minOf(minOf(numeric_limits<double>::infinity(), n1), n2);
+}
+
 ASFUNCTIONBODY(Math,exp)
 {
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::exp(n));
+	return abstract_d(exp_native(obj,n));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,Math,exp,number_t n)
+{
+	return ::exp(n);
 }
 
 ASFUNCTIONBODY(Math,acos)
 {
-	//Angle is in radians
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::acos(n));
+	return abstract_d(acos_native(obj,n));
 }
 
-ASFUNCTIONBODY(Math,asin)
+ASNATIVEFUNCTIONBODY(number_t,Math,acos,number_t n)
 {
 	//Angle is in radians
+	return ::acos(n);
+}
+
+ASFUNCTIONBODY(Math,asin)
+{
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::asin(n));
+	return abstract_d(asin_native(obj,n));
 }
 
-ASFUNCTIONBODY(Math,atan)
+ASNATIVEFUNCTIONBODY(number_t,Math,asin,number_t n)
 {
 	//Angle is in radians
+	return ::asin(n);
+}
+
+ASFUNCTIONBODY(Math,atan)
+{
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::atan(n));
+	return abstract_d(atan_native(obj,n));
 }
 
-ASFUNCTIONBODY(Math,cos)
+ASNATIVEFUNCTIONBODY(number_t,Math,atan,number_t n)
 {
 	//Angle is in radians
+	return ::atan(n);
+}
+
+ASFUNCTIONBODY(Math,cos)
+{
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::cos(n));
+	return abstract_d(cos_native(obj,n));
 }
 
-ASFUNCTIONBODY(Math,sin)
+ASNATIVEFUNCTIONBODY(number_t,Math,cos,number_t n)
 {
 	//Angle is in radians
+	return ::cos(n);
+}
+
+ASFUNCTIONBODY(Math,sin)
+{
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::sin(n));
+	return abstract_d(sin_native(obj,n));
 }
 
-ASFUNCTIONBODY(Math,tan)
+ASNATIVEFUNCTIONBODY(number_t,Math,sin,number_t n)
 {
 	//Angle is in radians
+	return ::sin(n);
+}
+
+ASFUNCTIONBODY(Math,tan)
+{
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::tan(n));
+	return abstract_d(tan_native(obj,n));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,Math,tan,number_t n)
+{
+	//Angle is in radians
+	return ::tan(n);
 }
 
 ASFUNCTIONBODY(Math,abs)
 {
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::fabs(n));
+	return abstract_d(abs_native(obj,n));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,Math,abs,number_t n)
+{
+	return ::fabs(n);
 }
 
 ASFUNCTIONBODY(Math,ceil)
 {
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::ceil(n));
+	return abstract_d(ceil_native(obj,n));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,Math,ceil,number_t n)
+{
+	return ::ceil(n);
 }
 
 ASFUNCTIONBODY(Math,log)
 {
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::log(n));
+	return abstract_d(log_native(obj,n));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,Math,log,number_t n)
+{
+	return ::log(n);
 }
 
 ASFUNCTIONBODY(Math,floor)
 {
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::floor(n));
+	return abstract_d(floor_native(obj,n));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,Math,floor,number_t n)
+{
+	return ::floor(n);
 }
 
 ASFUNCTIONBODY(Math,round)
 {
 	number_t n;
 	ARG_UNPACK (n);
+	return abstract_d(round_native(obj,n));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,Math,round,number_t n)
+{
 	if (n < 0 && n >= -0.5)
-		return abstract_d(0);
-	return abstract_d(::round(n));
+		return 0;
+	return ::round(n);
 }
 
 ASFUNCTIONBODY(Math,sqrt)
 {
 	number_t n;
 	ARG_UNPACK (n);
-	return abstract_d(::sqrt(n));
+	return abstract_d(sqrt_native(obj,n));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,Math,sqrt,number_t n)
+{
+	return ::sqrt(n);
 }
 
 ASFUNCTIONBODY(Math,pow)
 {
 	number_t x, y;
 	ARG_UNPACK (x) (y);
+	return abstract_d(pow_native(obj,x,y));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,Math,pow,number_t x,number_t y)
+{
 	if (::fabs(x) == 1 && (std::isnan(y) || std::isinf(y)) )
-		return abstract_d(Number::NaN);
-	return abstract_d(::pow(x,y));
+		return Number::NaN;
+	return ::pow(x,y);
 }
 
 ASFUNCTIONBODY(Math,random)
+{
+	return abstract_d(random_native(obj));
+}
+
+ASNATIVEFUNCTIONBODY(number_t,Math,random)
 {
 	number_t ret=rand();
 	ret/=(number_t(1.)+RAND_MAX);
-	return abstract_d(ret);
+	return ret;
 }
-
-
@@ -27,6 +27,9 @@ namespace lightspark
 
 class Math: public ASObject
 {
+private:
+	static number_t maxOf(number_t largest, number_t arg);
+	static number_t minOf(number_t smallest, number_t arg);
 public:
 	Math(Class_base* c):ASObject(c){}
 	static void sinit(Class_base* c);
@@ -35,23 +38,41 @@ public:
 	ASFUNCTION(generator);
 
 	ASFUNCTION(abs);
+	ASNATIVEFUNCTION(number_t,abs,number_t n);
 	ASFUNCTION(acos);
+	ASNATIVEFUNCTION(number_t,acos,number_t n);
 	ASFUNCTION(asin);
+	ASNATIVEFUNCTION(number_t,asin,number_t n);
 	ASFUNCTION(atan);
+	ASNATIVEFUNCTION(number_t,atan,number_t n);
 	ASFUNCTION(atan2);
+	ASNATIVEFUNCTION(number_t,atan2,number_t n1,number_t n2);
 	ASFUNCTION(ceil);
+	ASNATIVEFUNCTION(number_t,ceil,number_t n);
 	ASFUNCTION(cos);
+	ASNATIVEFUNCTION(number_t,cos,number_t n);
 	ASFUNCTION(exp);
+	ASNATIVEFUNCTION(number_t,exp,number_t n);
 	ASFUNCTION(floor);
+	ASNATIVEFUNCTION(number_t,floor,number_t n);
 	ASFUNCTION(log);
+	ASNATIVEFUNCTION(number_t,log,number_t n);
 	ASFUNCTION(_max);
+	ASNATIVEFUNCTION(number_t,_max,number_t n1,number_t n2);
 	ASFUNCTION(_min);
+	ASNATIVEFUNCTION(number_t,_min,number_t n1,number_t n2);
 	ASFUNCTION(pow);
+	ASNATIVEFUNCTION(number_t,pow,number_t n1,number_t n2);
 	ASFUNCTION(random);
+	ASNATIVEFUNCTION(number_t,random);
 	ASFUNCTION(round);
+	ASNATIVEFUNCTION(number_t,round,number_t n);
 	ASFUNCTION(sin);
+	ASNATIVEFUNCTION(number_t,sin,number_t n);
 	ASFUNCTION(sqrt);
+	ASNATIVEFUNCTION(number_t,sqrt,number_t n);
 	ASFUNCTION(tan);
+	ASNATIVEFUNCTION(number_t,tan,number_t n);
 };
 
 }
@@ -25,6 +25,259 @@
 using namespace std;
 using namespace lightspark;
 
+/*
+ * Shortest round-trip conversion of doubles to decimal digits, using the
+ * Grisu2 algorithm by Florian Loitsch ("Printing Floating-Point Numbers
+ * Quickly and Accurately with Integers", PLDI 2010)
+ */
+namespace
+{
+
+struct DiyFp
+{
+	uint64_t f;
+	int e;
+	DiyFp(uint64_t _f, int _e):f(_f),e(_e){}
+	explicit DiyFp(double d)
+	{
+		uint64_t u;
+		memcpy(&u,&d,sizeof(u));
+		int biasedExponent=(u>>52)&0x7FF;
+		uint64_t significand=u&0x000FFFFFFFFFFFFFULL;
+		if(biasedExponent!=0)
+		{
+			f=significand+0x0010000000000000ULL;
+			e=biasedExponent-0x3FF-52;
+		}
+		else
+		{
+			f=significand;
+			e=1-0x3FF-52;
+		}
+	}
+	DiyFp operator-(const DiyFp& r) const
+	{
+		return DiyFp(f-r.f,e);
+	}
+	//Multiplication rounded to the upper 64 bits
+	DiyFp operator*(const DiyFp& r) const
+	{
+		const uint64_t M32=0xFFFFFFFF;
+		const uint64_t a=f>>32;
+		const uint64_t b=f&M32;
+		const uint64_t c=r.f>>32;
+		const uint64_t d=r.f&M32;
+		const uint64_t ac=a*c;
+		const uint64_t bc=b*c;
+		const uint64_t ad=a*d;
+		const uint64_t bd=b*d;
+		uint64_t tmp=(bd>>32)+(ad&M32)+(bc&M32);
+		tmp+=1U<<31;
+		return DiyFp(ac+(ad>>32)+(bc>>32)+(tmp>>32),e+r.e+64);
+	}
+	DiyFp normalize() const
+	{
+		DiyFp res=*this;
+		while(!(res.f&0x8000000000000000ULL))
+		{
+			res.f<<=1;
+			res.e--;
+		}
+		return res;
+	}
+	//Computes the normalized boundaries m- and m+ of the interval of values rounding to this
+	void normalizedBoundaries(DiyFp& minus, DiyFp& plus) const
+	{
+		DiyFp pl((f<<1)+1,e-1);
+		while(!(pl.f&(0x0010000000000000ULL<<1)))
+		{
+			pl.f<<=1;
+			pl.e--;
+		}
+		pl.f<<=10;
+		pl.e-=10;
+		DiyFp mi=(f==0x0010000000000000ULL)?DiyFp((f<<2)-1,e-2):DiyFp((f<<1)-1,e-1);
+		mi.f<<=mi.e-pl.e;
+		mi.e=pl.e;
+		minus=mi;
+		plus=pl;
+	}
+};
+
+//Normalized powers of ten from 10^-348 to 10^340 in steps of 8
+const uint64_t cachedPowersF[]=
+{
+	0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+	0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+	0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+	0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+	0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+	0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+	0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+	0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+	0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+	0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+	0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+	0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+	0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+	0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+	0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+	0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+	0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+	0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+	0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+	0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+	0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+	0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+const int16_t cachedPowersE[]=
+{
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+	-901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+	-582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+	-263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+	56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+	694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+	1013, 1039, 1066,
+};
+const uint32_t pow10Table[]={ 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+DiyFp getCachedPower(int e, int& K)
+{
+	//dk must be positive, so we can use ceil
+	double dk=(-61-e)*0.30102999566398114+347;
+	int k=(int)dk;
+	if(dk-k>0.0)
+		k++;
+	unsigned int index=(unsigned int)((k>>3)+1);
+	K=-(-348+(int)(index<<3));
+	return DiyFp(cachedPowersF[index],cachedPowersE[index]);
+}
+
+void grisuRound(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw)
+{
+	while(rest<wpw && delta-rest>=tenKappa &&
+		(rest+tenKappa<wpw || wpw-rest>rest+tenKappa-wpw))
+	{
+		buffer[len-1]--;
+		rest+=tenKappa;
+	}
+}
+
+int countDecimalDigits(uint32_t n)
+{
+	int ret=1;
+	while(ret<10 && n>=pow10Table[ret])
+		ret++;
+	return ret;
+}
+
+void digitGen(const DiyFp& W, const DiyFp& Mp, uint64_t delta, char* buffer, int& len, int& K)
+{
+	const DiyFp one(1ULL<<-Mp.e,Mp.e);
+	const DiyFp wpw=Mp-W;
+	uint32_t p1=(uint32_t)(Mp.f>>-one.e);
+	uint64_t p2=Mp.f&(one.f-1);
+	int kappa=countDecimalDigits(p1);
+	len=0;
+	while(kappa>0)
+	{
+		const uint32_t div=pow10Table[kappa-1];
+		const uint32_t d=p1/div;
+		p1%=div;
+		if(d || len)
+			buffer[len++]='0'+d;
+		kappa--;
+		const uint64_t tmp=((uint64_t)p1<<-one.e)+p2;
+		if(tmp<=delta)
+		{
+			K+=kappa;
+			grisuRound(buffer,len,delta,tmp,(uint64_t)pow10Table[kappa]<<-one.e,wpw.f);
+			return;
+		}
+	}
+	for(;;)
+	{
+		p2*=10;
+		delta*=10;
+		const char d=(char)(p2>>-one.e);
+		if(d || len)
+			buffer[len++]='0'+d;
+		p2&=one.f-1;
+		kappa--;
+		if(p2<delta)
+		{
+			K+=kappa;
+			const int index=-kappa;
+			grisuRound(buffer,len,delta,p2,one.f,wpw.f*(index<10?pow10Table[index]:0));
+			return;
+		}
+	}
+}
+
+/*
+ * Writes the shortest digits identifying the positive, finite value v into buffer
+ * (at least 18 bytes). The value is buffer*10^K
+ */
+void grisu2(double v, char* buffer, int& len, int& K)
+{
+	const DiyFp dv(v);
+	DiyFp wm(0,0), wp(0,0);
+	dv.normalizedBoundaries(wm,wp);
+	const DiyFp cmk=getCachedPower(wp.e,K);
+	const DiyFp W=dv.normalize()*cmk;
+	DiyFp Wp=wp*cmk;
+	DiyFp Wm=wm*cmk;
+	Wm.f++;
+	Wp.f--;
+	digitGen(W,Wp,Wp.f-Wm.f,buffer,len,K);
+}
+
+/*
+ * Grisu2 always produces digits that round-trip, but with 16 or 17 digits
+ * they are sometimes one more than needed or not the closest to the value.
+ * In that uncommon case the correctly rounded output of the C library
+ * is used, with the least precision that round-trips
+ */
+void shortestDigits(double v, char* buffer, int& len, int& K)
+{
+	grisu2(v,buffer,len,K);
+	if(len<16)
+		return;
+	for(int precision=15;precision<=17;precision++)
+	{
+		char tmp[32];
+		snprintf(tmp,sizeof(tmp),"%.*e",precision-1,v);
+		if(g_ascii_strtod(tmp,NULL)!=v)
+			continue;
+		//tmp looks like d.ddddde+XX
+		len=0;
+		const char* cur=tmp;
+		for(;*cur!='e';cur++)
+		{
+			if(*cur!='.')
+				buffer[len++]=*cur;
+		}
+		K=atoi(cur+1)-(len-1);
+		while(len>1 && buffer[len-1]=='0')
+		{
+			len--;
+			K++;
+		}
+		break;
+	}
+}
+
+//Powers of ten that are exactly representable as doubles
+const double exactPowersOfTen[]=
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+}
+
 const number_t Number::NaN = numeric_limits<double>::quiet_NaN();
 
 number_t ASObject::toNumber()
@@ -116,62 +369,6 @@ TRISTATE Number::isLess(ASObject* o)
 	}
 }
 
-/*
- * This purges trailing zeros from the right, i.e.
- * "144124.45600" -> "144124.456"
- * "144124.000" -> "144124"
- * "144124.45600e+12" -> "144124.456e+12"
- * "144124.45600e+07" -> 144124.456e+7"
- * and it transforms the ',' into a '.' if found.
- */
-void Number::purgeTrailingZeroes(char* buf)
-{
-	int i=strlen(buf)-1;
-	int Epos = 0;
-	if(i>4 && buf[i-3] == 'e')
-	{
-		Epos = i-3;
-		i=i-4;
-	}
-	for(;i>0;i--)
-	{
-		if(buf[i]!='0')
-			break;
-	}
-	bool commaFound=false;
-	if(buf[i]==',' || buf[i]=='.')
-	{
-		i--;
-		commaFound=true;
-	}
-	if(Epos)
-	{
-		//copy e+12 to the current place
-		strncpy(buf+i+1,buf+Epos,5);
-		if(buf[i+3] == '0')
-		{
-			//this looks like e+07, so turn it into e+7
-			buf[i+3] = buf[i+4];
-			buf[i+4] = '\0';
-		}
-	}
-	else
-		buf[i+1]='\0';
-
-	if(commaFound)
-		return;
-
-	//Also change the comma to the point if needed
-	for(;i>0;i--)
-	{
-		if(buf[i]==',')
-		{
-			buf[i]='.';
-			break;
-		}
-	}
-}
-
 ASFUNCTIONBODY(Number,_toString)
 {
 	if(Class<Number>::getClass()->prototype->getObj() == obj)
@@ -221,16 +418,142 @@ tiny_string Number::toString(number_t val)
 	if(val == 0) //this also handles the case '-0'
 		return "0";
 
-	//See ecma3 8.9.1
 	char buf[40];
-	if(fabs(val) >= 1e+21 || fabs(val) <= 1e-6)
-		snprintf(buf,40,"%.15e",val);
+	char* cur=buf;
+	if(val<0)
+	{
+		*(cur++)='-';
+		val=-val;
+	}
+	char digits[24];
+	int len;
+	int K;
+	//The value is digits*10^K
+	shortestDigits(val,digits,len,K);
+
+	//See ecma3 9.8.1, n is the position of the decimal point
+	const int n=len+K;
+	if(len<=n && n<=21)
+	{
+		memcpy(cur,digits,len);
+		cur+=len;
+		memset(cur,'0',n-len);
+		cur+=n-len;
+	}
+	else if(0<n && n<=21)
+	{
+		memcpy(cur,digits,n);
+		cur+=n;
+		*(cur++)='.';
+		memcpy(cur,digits+n,len-n);
+		cur+=len-n;
+	}
+	else if(-6<n && n<=0)
+	{
+		*(cur++)='0';
+		*(cur++)='.';
+		memset(cur,'0',-n);
+		cur+=-n;
+		memcpy(cur,digits,len);
+		cur+=len;
+	}
 	else
-		snprintf(buf,40,"%.15f",val);
-	purgeTrailingZeroes(buf);
+	{
+		*(cur++)=digits[0];
+		if(len>1)
+		{
+			*(cur++)='.';
+			memcpy(cur,digits+1,len-1);
+			cur+=len-1;
+		}
+		cur+=sprintf(cur,"e%c%d",(n>0)?'+':'-',abs(n-1));
+	}
+	*cur='\0';
 	return tiny_string(buf,true);
 }
 
+bool Number::parseDecimalFast(const char* s, const char** end, number_t& ret)
+{
+	const char* cur=s;
+	bool negative=false;
+	if(*cur=='-' || *cur=='+')
+	{
+		negative=(*cur=='-');
+		cur++;
+	}
+	uint64_t mantissa=0;
+	int significantDigits=0;
+	int exponent=0;
+	bool anyDigit=false;
+	for(;*cur>='0' && *cur<='9';cur++)
+	{
+		anyDigit=true;
+		if(mantissa==0 && *cur=='0')
+			continue;
+		//More digits may not fit in the mantissa
+		if(significantDigits==19)
+			return false;
+		mantissa=mantissa*10+(*cur-'0');
+		significantDigits++;
+	}
+	if(*cur=='.')
+	{
+		for(cur++;*cur>='0' && *cur<='9';cur++)
+		{
+			anyDigit=true;
+			exponent--;
+			if(mantissa==0 && *cur=='0')
+				continue;
+			if(significantDigits==19)
+				return false;
+			mantissa=mantissa*10+(*cur-'0');
+			significantDigits++;
+		}
+	}
+	if(!anyDigit)
+		return false;
+	if(*cur=='e' || *cur=='E')
+	{
+		//Like strtod, the exponent is only consumed if it has digits
+		const char* expCur=cur+1;
+		bool negativeExponent=false;
+		if(*expCur=='-' || *expCur=='+')
+		{
+			negativeExponent=(*expCur=='-');
+			expCur++;
+		}
+		if(*expCur>='0' && *expCur<='9')
+		{
+			int explicitExponent=0;
+			for(;*expCur>='0' && *expCur<='9';expCur++)
+			{
+				if(explicitExponent<100000)
+					explicitExponent=explicitExponent*10+(*expCur-'0');
+			}
+			exponent+=negativeExponent?-explicitExponent:explicitExponent;
+			cur=expCur;
+		}
+	}
+
+	//Both the mantissa and the power of ten are exact, so a single
+	//multiplication or division gives the correctly rounded result
+	if(mantissa>(1ULL<<53))
+		return false;
+	number_t val=mantissa;
+	if(mantissa!=0)
+	{
+		if(exponent<-22 || exponent>22)
+			return false;
+		if(exponent<0)
+			val/=exactPowersOfTen[-exponent];
+		else
+			val*=exactPowersOfTen[exponent];
+	}
+	ret=negative?-val:val;
+	*end=cur;
+	return true;
+}
+
 tiny_string Number::toStringRadix(number_t val, int radix)
 {
 	if(radix < 2 || radix > 36)
@@ -492,16 +815,13 @@ ASFUNCTIONBODY(Number,_valueOf)
 	return abstract_d(obj->as<Number>()->val);
 }
 
-void Number::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Number::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	out->writeByte(double_marker);
 	//We have to write the double in network byte order (big endian)
 	const uint64_t* tmpPtr=reinterpret_cast<const uint64_t*>(&val);
 	uint64_t bigEndianVal=GINT64_FROM_BE(*tmpPtr);
-	uint8_t* bigEndianPtr=reinterpret_cast<uint8_t*>(&bigEndianVal);
-
-	for(uint32_t i=0;i<8;i++)
-		out->writeByte(bigEndianPtr[i]);
+	out->writeRawBytes(reinterpret_cast<const uint8_t*>(&bigEndianVal),8);
 }
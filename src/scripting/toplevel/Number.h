@@ -33,7 +33,6 @@ friend ASObject* abstract_d(number_t i);
 friend class ABCContext;
 friend class ABCVm;
 private:
-	static void purgeTrailingZeroes(char* buf);
 	static tiny_string purgeExponentLeadingZeros(const tiny_string& exponentialForm);
 	static int32_t countSignificantDigits(double v);
 public:
@@ -49,6 +48,13 @@ public:
 	tiny_string toString();
 	static tiny_string toString(number_t val);
 	static tiny_string toStringRadix(number_t val, int radix);
+	/*
+	 * Parses a plain decimal number, i.e. [+-]digits[.digits][(e|E)[+-]digits],
+	 * without calling strtod. It only succeeds when the result can be computed
+	 * exactly, otherwise the caller has to fall back to strtod.
+	 * On success end points after the last consumed character
+	 */
+	static bool parseDecimalFast(const char* s, const char** end, number_t& ret);
 	static tiny_string toExponentialString(double v, int32_t fractionDigits);
 	static tiny_string toFixedString(double v, int32_t fractionDigits);
 	static tiny_string toPrecisionString(double v, int32_t precision);
@@ -60,8 +66,12 @@ public:
 	{
 		return (unsigned int)(val);
 	}
-	/* ECMA-262 9.5 ToInt32 */
 	int32_t toInt()
+	{
+		return toInt(val);
+	}
+	/* ECMA-262 9.5 ToInt32 */
+	static int32_t toInt(number_t val)
 	{
 		double posInt;
 
@@ -90,9 +100,9 @@ public:
 	ASFUNCTION(generator);
 	std::string toDebugString() { return toString()+"d"; }
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 
 
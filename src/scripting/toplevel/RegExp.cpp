@@ -17,12 +17,68 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **************************************************************************/
 
+#include <list>
+#include <map>
 #include "scripting/argconv.h"
 #include "scripting/toplevel/RegExp.h"
+#include "threading.h"
 
 using namespace std;
 using namespace lightspark;
 
+#ifdef PCRE_STUDY_JIT_COMPILE
+//Since PCRE 8.20 the study data must be freed with pcre_free_study, and the pattern can be JIT compiled
+#define LS_PCRE_STUDY_OPTIONS PCRE_STUDY_JIT_COMPILE
+#define LS_PCRE_FREE_STUDY(e) pcre_free_study(e)
+#else
+#define LS_PCRE_STUDY_OPTIONS 0
+#define LS_PCRE_FREE_STUDY(e) pcre_free(e)
+#endif
+
+CompiledRegExp::CompiledRegExp(pcre* r, pcre_extra* e, int groups):re(r),studyData(e),capturingGroups(groups)
+{
+}
+
+CompiledRegExp::~CompiledRegExp()
+{
+	if(studyData)
+		LS_PCRE_FREE_STUDY(studyData);
+	pcre_free(re);
+}
+
+int CompiledRegExp::exec(const tiny_string& subject, int offset, int* ovector, int ovecsize, bool limitRecursion) const
+{
+	pcre_extra extra;
+	if(studyData)
+		extra=*studyData;
+	else
+		extra.flags=0;
+	if(limitRecursion)
+	{
+		extra.match_limit_recursion=200;
+		extra.flags|=PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+	}
+	return pcre_exec(re, extra.flags ? &extra : NULL, subject.raw_buf(), subject.numBytes(), offset, 0, ovector, ovecsize);
+}
+
+/*
+ * Least recently used cache of compiled patterns. The most recently used
+ * entries are at the front of the list
+ */
+namespace
+{
+typedef pair<tiny_string, int> regexp_key;
+typedef list<pair<regexp_key, _R<CompiledRegExp>>> regexp_lru;
+const unsigned int regExpCacheSize=64;
+regexp_lru regExpLRU;
+map<regexp_key, regexp_lru::iterator> regExpIndex;
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+StaticMutex regExpCacheMutex;
+#else
+StaticMutex regExpCacheMutex = GLIBMM_STATIC_MUTEX_INIT;
+#endif
+}
+
 RegExp::RegExp(Class_base* c):ASObject(c),dotall(false),global(false),ignoreCase(false),
 	extended(false),multiline(false),lastIndex(0)
 {
@@ -147,32 +203,21 @@ ASFUNCTIONBODY(RegExp,exec)
 
 ASObject *RegExp::match(const tiny_string& str)
 {
-	pcre* pcreRE = compile();
-	if (!pcreRE)
-		return getSys()->getNullRef();
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
+	_NR<CompiledRegExp> compiled = compile();
+	if (compiled.isNull())
 		return getSys()->getNullRef();
-	}
+	pcre* pcreRE = compiled->getPCRE();
+	const int capturingGroups=compiled->capturingGroups;
 	//Get information about named capturing groups
 	int namedGroups;
-	infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMECOUNT, &namedGroups);
+	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMECOUNT, &namedGroups);
 	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
 		return getSys()->getNullRef();
-	}
 	//Get information about the size of named entries
 	int namedSize;
 	infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMEENTRYSIZE, &namedSize);
 	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
 		return getSys()->getNullRef();
-	}
 	struct nameEntry
 	{
 		uint16_t number;
@@ -182,20 +227,15 @@ ASObject *RegExp::match(const tiny_string& str)
 	infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMETABLE, &entries);
 	if(infoOk!=0)
 	{
-		pcre_free(pcreRE);
 		lastIndex=0;
 		return getSys()->getNullRef();
 	}
-	pcre_extra extra;
-	extra.match_limit_recursion=200;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
 	int ovector[(capturingGroups+1)*3];
 	int offset=global?lastIndex:0;
-	int rc=pcre_exec(pcreRE,capturingGroups > 200 ? &extra : NULL, str.raw_buf(), str.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+	int rc=compiled->exec(str, offset, ovector, (capturingGroups+1)*3, capturingGroups > 200);
 	if(rc<0)
 	{
 		//No matches or error
-		pcre_free(pcreRE);
 		return getSys()->getNullRef();
 	}
 	Array* a=Class<Array>::getInstanceS();
@@ -224,7 +264,6 @@ ASObject *RegExp::match(const tiny_string& str)
 		entries+=namedSize;
 	}
 	lastIndex=ovector[1];
-	pcre_free(pcreRE);
 	return a;
 }
 
@@ -235,26 +274,16 @@ ASFUNCTIONBODY(RegExp,test)
 	RegExp* th=static_cast<RegExp*>(obj);
 
 	const tiny_string& arg0 = args[0]->toString();
-	pcre* pcreRE = th->compile();
-	if (!pcreRE)
+	_NR<CompiledRegExp> compiled = th->compile();
+	if (compiled.isNull())
 		return getSys()->getNullRef();
 
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return getSys()->getNullRef();
-	}
+	const int capturingGroups=compiled->capturingGroups;
 	int ovector[(capturingGroups+1)*3];
 	
 	int offset=(th->global)?th->lastIndex:0;
-	pcre_extra extra;
-	extra.match_limit_recursion=200;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
-	int rc = pcre_exec(pcreRE, &extra, arg0.raw_buf(), arg0.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+	int rc = compiled->exec(arg0, offset, ovector, (capturingGroups+1)*3);
 	bool ret = (rc >= 0);
-	pcre_free(pcreRE);
 
 	return abstract_b(ret);
 }
@@ -282,9 +311,9 @@ ASFUNCTIONBODY(RegExp,_toString)
 	return Class<ASString>::getInstanceS(ret);
 }
 
-pcre* RegExp::compile()
+int RegExp::getOptions() const
 {
-	int options = PCRE_UTF8|PCRE_NEWLINE_ANY|PCRE_JAVASCRIPT_COMPAT;
+	int options = defaultOptions;
 	if(ignoreCase)
 		options |= PCRE_CASELESS;
 	if(extended)
@@ -293,6 +322,27 @@ pcre* RegExp::compile()
 		options |= PCRE_MULTILINE;
 	if(dotall)
 		options|=PCRE_DOTALL;
+	return options;
+}
+
+_NR<CompiledRegExp> RegExp::compile()
+{
+	return compile(source, getOptions());
+}
+
+_NR<CompiledRegExp> RegExp::compile(const tiny_string& source, int options)
+{
+	const regexp_key key(source, options);
+	{
+		Mutex::Lock l(regExpCacheMutex);
+		auto it=regExpIndex.find(key);
+		if(it!=regExpIndex.end())
+		{
+			//Move the entry to the front
+			regExpLRU.splice(regExpLRU.begin(), regExpLRU, it->second);
+			return it->second->second;
+		}
+	}
 
 	const char * error;
 	int errorOffset;
@@ -306,7 +356,31 @@ pcre* RegExp::compile()
 			pcreRE=pcre_compile2(source.raw_buf(), options,&errorcode,  &error, &errorOffset,NULL);
 		}
 		if (error)
-			return NULL;
+			return NullRef;
+	}
+	int capturingGroups;
+	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
+	if(infoOk!=0)
+	{
+		pcre_free(pcreRE);
+		return NullRef;
+	}
+	//pcre_study may return NULL without an error if there is nothing to optimize
+	const char* studyError;
+	pcre_extra* studyData=pcre_study(pcreRE, LS_PCRE_STUDY_OPTIONS, &studyError);
+	_R<CompiledRegExp> ret=_MR(new CompiledRegExp(pcreRE, studyData, capturingGroups));
+
+	Mutex::Lock l(regExpCacheMutex);
+	//Another thread may have compiled the same pattern in the meantime
+	auto it=regExpIndex.find(key);
+	if(it!=regExpIndex.end())
+		return it->second->second;
+	regExpLRU.push_front(make_pair(key, ret));
+	regExpIndex.insert(make_pair(key, regExpLRU.begin()));
+	if(regExpLRU.size()>regExpCacheSize)
+	{
+		regExpIndex.erase(regExpLRU.back().first);
+		regExpLRU.pop_back();
 	}
-	return pcreRE;
+	return ret;
 }
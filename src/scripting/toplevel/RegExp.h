@@ -26,12 +26,43 @@
 namespace lightspark
 {
 
+/*
+ * A pattern compiled and studied by PCRE. Instances are shared through
+ * the cache of RegExp::compile, so they must not be modified after creation
+ */
+class CompiledRegExp: public RefCountable
+{
+private:
+	pcre* re;
+	pcre_extra* studyData;
+public:
+	const int capturingGroups;
+	CompiledRegExp(pcre* r, pcre_extra* e, int groups);
+	~CompiledRegExp();
+	pcre* getPCRE() const { return re; }
+	/*
+	 * Wraps pcre_exec, using the data from pcre_study when available.
+	 * If limitRecursion is true the recursion of the matcher is limited
+	 */
+	int exec(const tiny_string& subject, int offset, int* ovector, int ovecsize, bool limitRecursion=true) const;
+};
+
 class RegExp: public ASObject
 {
+private:
+	int getOptions() const;
 public:
 	RegExp(Class_base* c);
 	RegExp(Class_base* c, const tiny_string& _re);
-	pcre* compile();
+	/*
+	 * Returns the compiled pattern, or NullRef if it's invalid. Compiled patterns
+	 * are kept in a bounded cache keyed by source and options, shared by all
+	 * the RegExp and String methods
+	 */
+	static _NR<CompiledRegExp> compile(const tiny_string& source, int options);
+	_NR<CompiledRegExp> compile();
+	/* Options used when compiling a plain string as pattern */
+	static const int defaultOptions=PCRE_UTF8|PCRE_NEWLINE_ANY|PCRE_JAVASCRIPT_COMPAT;
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o);
 	ASObject *match(const tiny_string& str);
@@ -33,8 +33,16 @@ tiny_string UInteger::toString()
 tiny_string UInteger::toString(uint32_t val)
 {
 	char buf[20];
-	snprintf(buf,sizeof(buf),"%u",val);
-	return tiny_string(buf,true);
+	buf[19]=0;
+	char* cur=buf+19;
+	do
+	{
+		cur--;
+		*cur='0'+(val%10);
+		val/=10;
+	}
+	while(val!=0);
+	return tiny_string(cur,true); //Create a copy
 }
 
 TRISTATE UInteger::isLess(ASObject* o)
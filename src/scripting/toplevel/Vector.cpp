@@ -18,6 +18,7 @@
 **************************************************************************/
 
 #include "scripting/toplevel/Vector.h"
+#include "scripting/toplevel/Array.h"
 #include "scripting/abc.h"
 #include "scripting/class.h"
 #include "parsing/amf3_generator.h"
@@ -763,11 +764,34 @@ ASFUNCTIONBODY(Vector,_sort)
 	if (argslen != 1)
 		throwError<ArgumentError>(kWrongArgumentCountError, "Vector.sort", "1", Integer::toString(argslen));
 	Vector* th=static_cast<Vector*>(obj);
-	
-	IFunction* comp=static_cast<IFunction*>(args[0]);
-	
 
-	sort(th->vec.begin(),th->vec.end(),sortComparatorWrapper(comp,th->vec_type));
+	if(args[0]->getObjectType()==T_FUNCTION)
+	{
+		IFunction* comp=static_cast<IFunction*>(args[0]);
+		stable_sort(th->vec.begin(),th->vec.end(),sortComparatorWrapper(comp,th->vec_type));
+		obj->incRef();
+		return obj;
+	}
+
+	//The argument can also be a combination of the Array sort options
+	uint32_t options=args[0]->toUInt();
+	if(options&(~(Array::NUMERIC|Array::CASEINSENSITIVE|Array::DESCENDING)))
+		throw UnsupportedException("Vector::sort not completely implemented");
+	multiname elementname(NULL);
+	std::vector<sorton_field> sortfields(1,sorton_field(elementname));
+	sortfields[0].isNumeric=(options&Array::NUMERIC)!=0;
+	sortfields[0].isCaseInsensitive=(options&Array::CASEINSENSITIVE)!=0;
+	sortfields[0].isDescending=(options&Array::DESCENDING)!=0;
+	SortKeys keys(sortfields,th->vec.size());
+	_R<ASObject> nullRef=_MR(getSys()->getNullRef());
+	for(uint32_t i=0;i<th->vec.size();i++)
+		keys.setKey(i,0,th->vec[i] ? th->vec[i] : nullRef.getPtr());
+	std::vector<uint32_t> order=keys.sortedOrder();
+	std::vector<ASObject*, reporter_allocator<ASObject*>> sorted(th->vec.get_allocator());
+	sorted.reserve(order.size());
+	for(uint32_t i=0;i<order.size();i++)
+		sorted.push_back(th->vec[order[i]]);
+	th->vec.swap(sorted);
 	obj->incRef();
 	return obj;
 }
@@ -26,9 +26,11 @@
 #include "abc.h"
 #include "parsing/amf3_generator.h"
 #include <libxml/tree.h>
+#include <libxml/parserInternals.h>
 #include <libxml++/parsers/domparser.h>
 #include <libxml++/nodes/textnode.h>
 #include <libxml++/nodes/entityreference.h>
+#include <algorithm>
 
 using namespace std;
 using namespace lightspark;
@@ -48,22 +50,71 @@ void setDefaultXMLSettings()
 	prettyPrinting = true;
 }
 
-XML::XML(Class_base* c):ASObject(c),parentNode(0),nodetype((xmlElementType)0),constructed(false), hasParentNode(false)
+ATOMIC_INT32(XML::versionCounter);
+
+XML::XML(Class_base* c):ASObject(c),parentNode(0),nodetype((xmlElementType)0),
+	descendantIndex(NULL),descendantQueryVersion(0),documentVersion(ATOMIC_INCREMENT(versionCounter)),constructed(false), hasParentNode(false)
 {
 }
 
-XML::XML(Class_base* c, const std::string &str):ASObject(c),parentNode(0),nodetype((xmlElementType)0),constructed(false)
+XML::XML(Class_base* c, const std::string &str):ASObject(c),parentNode(0),nodetype((xmlElementType)0),
+	descendantIndex(NULL),descendantQueryVersion(0),documentVersion(ATOMIC_INCREMENT(versionCounter)),constructed(false)
 {
-	createTree(buildFromString(str, false,&hasParentNode));
+	buildTree(str);
 }
 
-XML::XML(Class_base* c,xmlpp::Node* _n):ASObject(c),parentNode(0),nodetype((xmlElementType)0),constructed(false)
+XML::XML(Class_base* c,xmlpp::Node* _n):ASObject(c),parentNode(0),nodetype((xmlElementType)0),
+	descendantIndex(NULL),descendantQueryVersion(0),documentVersion(ATOMIC_INCREMENT(versionCounter)),constructed(false)
 {
 	createTree(_n);
 }
 
+XML* XML::getRootNode()
+{
+	XML* root=this;
+	while(root->parentNode)
+		root=root->parentNode.getPtr();
+	return root;
+}
+
+void XML::documentModified()
+{
+	getRootNode()->documentVersion=ATOMIC_INCREMENT(versionCounter);
+}
+
+void XML::setParentNode(XML* parent)
+{
+	if(parentNode)
+		parentNode->documentModified();
+	//This node is the root of its subtree until it's attached again
+	documentVersion=ATOMIC_INCREMENT(versionCounter);
+	if(parent)
+	{
+		parent->incRef();
+		parentNode=_MR(parent);
+		parent->documentModified();
+	}
+	else
+		parentNode=NullRef;
+}
+
+XMLList* XML::modifyChildren()
+{
+	documentModified();
+	return childrenlist.getPtr();
+}
+
+XML::~XML()
+{
+	finalize();
+}
+
 void XML::finalize()
 {
+	delete descendantIndex;
+	descendantIndex=NULL;
+	if (childrenlist && childrenlist->ownerNode==this)
+		childrenlist->ownerNode=NULL;
 	ASObject::finalize();
 }
 
@@ -178,7 +229,7 @@ ASFUNCTIONBODY(XML,_constructor)
 	   args[0]->is<Null>() || 
 	   args[0]->is<Undefined>())
 	{
-		th->createTree(th->buildFromString("", false,&th->hasParentNode));
+		th->buildTree("");
 	}
 	else if(args[0]->getClass()->isSubClass(Class<ByteArray>::getClass()))
 	{
@@ -187,8 +238,7 @@ ASFUNCTIONBODY(XML,_constructor)
 		ByteArray* ba=Class<ByteArray>::cast(args[0]);
 		uint32_t len=ba->getLength();
 		const uint8_t* str=ba->getBuffer(len, false);
-		th->createTree(th->buildFromString(std::string((const char*)str,len), false,&th->hasParentNode,
-					     getVm()->getDefaultXMLNamespace()));
+		th->buildTree(std::string((const char*)str,len), getVm()->getDefaultXMLNamespace());
 	}
 	else if(args[0]->is<ASString>() ||
 		args[0]->is<Number>() ||
@@ -198,24 +248,21 @@ ASFUNCTIONBODY(XML,_constructor)
 	{
 		//By specs, XML constructor will only convert to string Numbers or Booleans
 		//ints are not explicitly mentioned, but they seem to work
-		th->createTree(th->buildFromString(args[0]->toString(), false,&th->hasParentNode,
-					     getVm()->getDefaultXMLNamespace()));
+		th->buildTree(args[0]->toString(), getVm()->getDefaultXMLNamespace());
 	}
 	else if(args[0]->is<XML>())
 	{
-		th->createTree(th->buildFromString(args[0]->as<XML>()->toXMLString_internal(), false,&th->hasParentNode,
-					     getVm()->getDefaultXMLNamespace()));
+		th->buildTree(args[0]->as<XML>()->toXMLString_internal(), getVm()->getDefaultXMLNamespace());
 	}
 	else if(args[0]->is<XMLList>())
 	{
 		XMLList *list=args[0]->as<XMLList>();
 		_R<XML> reduced=list->reduceToXML();
-		th->createTree(th->buildFromString(reduced->toXMLString_internal(), false,&th->hasParentNode));
+		th->buildTree(reduced->toXMLString_internal());
 	}
 	else
 	{
-		th->createTree(th->buildFromString(args[0]->toString(), false,&th->hasParentNode,
-					     getVm()->getDefaultXMLNamespace()));
+		th->buildTree(args[0]->toString(), getVm()->getDefaultXMLNamespace());
 	}
 	return NULL;
 }
@@ -323,8 +370,7 @@ void XML::appendChild(_R<XML> newChild)
 {
 	if (newChild->constructed)
 	{
-		this->incRef();
-		newChild->parentNode = _NR<XML>(this);
+		newChild->setParentNode(this);
 		childrenlist->append(newChild);
 	}
 	else
@@ -914,6 +960,8 @@ void XML::setLocalName(const tiny_string& new_name)
 		throwError<TypeError>(kXMLInvalidName, new_name);
 	}
 	this->nodename = new_name;
+	//The descendant index is grouped by name
+	documentModified();
 }
 
 ASFUNCTIONBODY(XML,_setName)
@@ -1119,6 +1167,52 @@ xmlElementType XML::getNodeKind() const
 
 
 void XML::getDescendantsByQName(const tiny_string& name, const tiny_string& ns, bool bIsAttribute, XMLVector& ret)
+{
+	if (!constructed)
+		return;
+	if (!bIsAttribute && name!="" && name!="*")
+	{
+		//Repeated queries for a name on an unchanged tree are answered by the index
+		const uint32_t version=getRootNode()->documentVersion;
+		if (descendantQueryVersion==version)
+		{
+			if (!descendantIndex)
+			{
+				descendantIndex=new DescendantIndex;
+				buildDescendantIndex(*descendantIndex);
+			}
+			auto it=descendantIndex->find(getSys()->getUniqueStringId(name));
+			if (it==descendantIndex->end())
+				return;
+			const XMLVector& nodes=it->second;
+			for (uint32_t i = 0; i < nodes.size(); i++)
+			{
+				if (ns == "*" || ns == nodes[i]->nodenamespace_uri)
+					ret.push_back(nodes[i]);
+			}
+			return;
+		}
+		delete descendantIndex;
+		descendantIndex=NULL;
+		descendantQueryVersion=version;
+	}
+	getDescendantsImpl(name, ns, bIsAttribute, ret);
+}
+
+void XML::buildDescendantIndex(DescendantIndex& index)
+{
+	if (!childrenlist)
+		return;
+	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
+	{
+		const _R<XML>& child=childrenlist->nodes[i];
+		index[getSys()->getUniqueStringId(child->nodename)].push_back(child);
+		if (child->constructed)
+			child->buildDescendantIndex(index);
+	}
+}
+
+void XML::getDescendantsImpl(const tiny_string& name, const tiny_string& ns, bool bIsAttribute, XMLVector& ret)
 {
 	if (!constructed)
 		return;
@@ -1126,7 +1220,7 @@ void XML::getDescendantsByQName(const tiny_string& name, const tiny_string& ns,
 	{
 		for (uint32_t i = 0; i < attributelist->nodes.size(); i++)
 		{
-			_R<XML> child= attributelist->nodes[i];
+			const _R<XML>& child= attributelist->nodes[i];
 			if(name=="" || name=="*" || (name == child->nodename && (ns == "*" || ns == child->nodenamespace_uri)))
 			{
 				child->incRef();
@@ -1136,13 +1230,13 @@ void XML::getDescendantsByQName(const tiny_string& name, const tiny_string& ns,
 	}
 	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
 	{
-		_R<XML> child= childrenlist->nodes[i];
+		const _R<XML>& child= childrenlist->nodes[i];
 		if(!bIsAttribute && (name=="" || name=="*" || (name == child->nodename && (ns == "*" || ns == child->nodenamespace_uri))))
 		{
 			child->incRef();
 			ret.push_back(child);
 		}
-		child->getDescendantsByQName(name, ns, bIsAttribute, ret);
+		child->getDescendantsImpl(name, ns, bIsAttribute, ret);
 	}
 }
 
@@ -1158,56 +1252,41 @@ XML::XMLVector XML::getAttributes()
 XML::XMLVector XML::getAttributesByMultiname(const multiname& name)
 {
 	XMLVector ret;
-	tiny_string defns = "|";
-	defns += getVm()->getDefaultXMLNamespace();
-	defns += "|";
+	const tiny_string defns = getVm()->getDefaultXMLNamespace();
 	tiny_string normalizedName= "";
 	if (!name.isEmpty()) normalizedName= name.normalizedName();
 	if (normalizedName.startsWith("@"))
 		normalizedName = normalizedName.substr(1,normalizedName.end());
-	tiny_string namespace_uri="|";
-	uint32_t i = 0;
-	while (i < name.ns.size())
+	//The namespaces that are accepted, the empty one stands for the default XML namespace
+	std::vector<tiny_string> namespace_uris;
+	bool hasdefns = false;
+	for (uint32_t i = 0; i < name.ns.size(); i++)
 	{
 		nsNameAndKindImpl ns=name.ns[i].getImpl();
 		if (ns.kind==NAMESPACE && ns.name != AS3)
 		{
-			if (ns.name.empty())
-				namespace_uri +=getVm()->getDefaultXMLNamespace();
-			else
-				namespace_uri +=ns.name;
-			namespace_uri += "|";
+			namespace_uris.push_back(ns.name.empty() ? defns : ns.name);
+			if (namespace_uris.back() == defns)
+				hasdefns = true;
 		}
-		i++;
 	}
+	const bool anyns = namespace_uris.size() == 1 && namespace_uris[0] == "*";
+	const bool anyname = normalizedName == "" || normalizedName == "*";
 	for (uint32_t i = 0; i < attributelist->nodes.size(); i++)
 	{
-		_R<XML> child= attributelist->nodes[i];
-		tiny_string childnamespace_uri = "|";
-		childnamespace_uri += child->nodenamespace_uri;
-		childnamespace_uri += "|";
-		
-		bool bmatch = (
-					((normalizedName=="") &&
-					 ((namespace_uri.find(defns)!= tiny_string::npos) ||
-					  (namespace_uri=="|*|") ||
-					  (namespace_uri.find(childnamespace_uri) != tiny_string::npos)
-					 )
-					)||
-					((normalizedName=="*") &&
-					 ((namespace_uri.find(defns)!= tiny_string::npos) ||
-					  (namespace_uri=="|*|") ||
-					  (namespace_uri.find(childnamespace_uri) != tiny_string::npos)
-					 )
-					)||
-					((normalizedName==child->nodename) &&
-					 (
-					  (namespace_uri=="|*|") ||
-					  (namespace_uri=="|" && childnamespace_uri=="||") ||
-					  (namespace_uri.find(childnamespace_uri) != tiny_string::npos)
-					 )
-					)
-					);
+		const _R<XML>& child= attributelist->nodes[i];
+		bool bmatch = false;
+		if (anyns)
+			bmatch = anyname || normalizedName == child->nodename;
+		else if (anyname || normalizedName == child->nodename)
+		{
+			if (anyname && hasdefns)
+				bmatch = true;
+			else if (!anyname && namespace_uris.empty())
+				bmatch = child->nodenamespace_uri.empty();
+			else
+				bmatch = std::find(namespace_uris.begin(), namespace_uris.end(), child->nodenamespace_uri) != namespace_uris.end();
+		}
 		if(bmatch)
 		{
 			child->incRef();
@@ -1407,8 +1486,7 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 		if (!found && !normalizedName.empty())
 		{
 			_NR<XML> tmp = _MR<XML>(Class<XML>::getInstanceS());
-			this->incRef();
-			tmp->parentNode = _MR<XML>(this);
+			tmp->setParentNode(this);
 			tmp->nodetype = XML_ATTRIBUTE_NODE;
 			tmp->nodename = buf;
 			tmp->nodenamespace_uri = ns_uri;
@@ -1426,9 +1504,10 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 	{
 		bool found = false;
 		XMLVector tmpnodes;
-		while (!childrenlist->nodes.empty())
+		XMLList* children = modifyChildren();
+		while (!children->nodes.empty())
 		{
-			_R<XML> tmpnode = childrenlist->nodes.back();
+			_R<XML> tmpnode = children->nodes.back();
 			if (tmpnode->nodenamespace_uri == ns_uri && tmpnode->nodename == normalizedName)
 			{
 				if(o->is<XMLList>())
@@ -1442,7 +1521,7 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 				else if(o->is<XML>())
 				{
 					_NR<XML> tmp = _MR<XML>(o->as<XML>());
-					tmp->parentNode = _MR<XML>(this);
+					tmp->setParentNode(this);
 					tmp->incRef();
 					
 					if (!found)
@@ -1471,14 +1550,14 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 				tmpnode->incRef();
 				tmpnodes.push_back(tmpnode);
 			}
-			childrenlist->nodes.pop_back();
+			children->nodes.pop_back();
 		}
 		if (!found)
 		{
 			if(o->is<XML>())
 			{
 				_R<XML> tmp = _MR<XML>(o->as<XML>());
-				tmp->parentNode = _MR<XML>(this);
+				tmp->setParentNode(this);
 				tmp->incRef();
 				tmpnodes.insert(tmpnodes.begin(),tmp);
 			}
@@ -1510,12 +1589,11 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 				tmpstr += normalizedName;
 				tmpstr +=">";
 				_NR<XML> tmp = _MR<XML>(Class<XML>::getInstanceS(tmpstr));
-				this->incRef();
-				tmp->parentNode = _MR<XML>(this);
+				tmp->setParentNode(this);
 				tmpnodes.push_back(tmp);
 			}
 		}
-		childrenlist->nodes.insert(childrenlist->nodes.begin(), tmpnodes.rbegin(),tmpnodes.rend());
+		children->nodes.insert(children->nodes.begin(), tmpnodes.rbegin(),tmpnodes.rend());
 	}
 }
 
@@ -1616,7 +1694,7 @@ bool XML::deleteVariableByMultiname(const multiname& name)
 	}
 	else if(XML::isValidMultiname(name,index))
 	{
-		childrenlist->nodes.erase(childrenlist->nodes.begin() + index);
+		modifyChildren()->nodes.erase(childrenlist->nodes.begin() + index);
 	}
 	else
 	{
@@ -1640,7 +1718,7 @@ bool XML::deleteVariableByMultiname(const multiname& name)
 						(node->nodenamespace_uri == ns_uri && name.normalizedName() == "") ||
 						(node->nodenamespace_uri == ns_uri && node->nodename == name.normalizedName()))
 				{
-					childrenlist->nodes.erase(it);
+					modifyChildren()->nodes.erase(it);
 					bdeleted= true;
 				}
 			}
@@ -1890,24 +1968,21 @@ ASFUNCTIONBODY(XML,insertChildAfter)
 		child2 = _NR<XML>(Class<XML>::getInstanceS(child2->toString()));
 	if (child1->is<Null>())
 	{
-		th->incRef();
-		child2->as<XML>()->parentNode = _NR<XML>(th);
+		child2->as<XML>()->setParentNode(th);
 		if (child2->is<XML>())
 		{
-			th->incRef();
 			child2->incRef();
-			child2->as<XML>()->parentNode = _NR<XML>(th);
-			th->childrenlist->nodes.insert(th->childrenlist->nodes.begin(),_NR<XML>(child2->as<XML>()));
+			child2->as<XML>()->setParentNode(th);
+			th->modifyChildren()->nodes.insert(th->childrenlist->nodes.begin(),_NR<XML>(child2->as<XML>()));
 		}
 		else if (child2->is<XMLList>())
 		{
 			for (auto it2 = child2->as<XMLList>()->nodes.begin(); it2 < child2->as<XMLList>()->nodes.end(); it2++)
 			{
-				th->incRef();
 				(*it2)->incRef();
-				(*it2)->parentNode = _NR<XML>(th);
+				(*it2)->setParentNode(th);
 			}
-			th->childrenlist->nodes.insert(th->childrenlist->nodes.begin(),child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
+			th->modifyChildren()->nodes.insert(th->childrenlist->nodes.begin(),child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
 		}
 		th->incRef();
 		return th;
@@ -1925,20 +2000,18 @@ ASFUNCTIONBODY(XML,insertChildAfter)
 			th->incRef();
 			if (child2->is<XML>())
 			{
-				th->incRef();
 				child2->incRef();
-				child2->as<XML>()->parentNode = _NR<XML>(th);
-				th->childrenlist->nodes.insert(it+1,_NR<XML>(child2->as<XML>()));
+				child2->as<XML>()->setParentNode(th);
+				th->modifyChildren()->nodes.insert(it+1,_NR<XML>(child2->as<XML>()));
 			}
 			else if (child2->is<XMLList>())
 			{
 				for (auto it2 = child2->as<XMLList>()->nodes.begin(); it2 < child2->as<XMLList>()->nodes.end(); it2++)
 				{
-					th->incRef();
 					(*it2)->incRef();
-					(*it2)->parentNode = _NR<XML>(th);
+					(*it2)->setParentNode(th);
 				}
-				th->childrenlist->nodes.insert(it+1,child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
+				th->modifyChildren()->nodes.insert(it+1,child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
 			}
 			return th;
 		}
@@ -1976,10 +2049,9 @@ ASFUNCTIONBODY(XML,insertChildBefore)
 		{
 			for (auto it = child2->as<XMLList>()->nodes.begin(); it < child2->as<XMLList>()->nodes.end(); it++)
 			{
-				th->incRef();
 				(*it)->incRef();
-				(*it)->parentNode = _NR<XML>(th);
-				th->childrenlist->nodes.push_back(_NR<XML>(*it));
+				(*it)->setParentNode(th);
+				th->modifyChildren()->nodes.push_back(_NR<XML>(*it));
 			}
 		}
 		th->incRef();
@@ -1998,20 +2070,18 @@ ASFUNCTIONBODY(XML,insertChildBefore)
 			th->incRef();
 			if (child2->is<XML>())
 			{
-				th->incRef();
 				child2->incRef();
-				child2->as<XML>()->parentNode = _NR<XML>(th);
-				th->childrenlist->nodes.insert(it,_NR<XML>(child2->as<XML>()));
+				child2->as<XML>()->setParentNode(th);
+				th->modifyChildren()->nodes.insert(it,_NR<XML>(child2->as<XML>()));
 			}
 			else if (child2->is<XMLList>())
 			{
 				for (auto it2 = child2->as<XMLList>()->nodes.begin(); it2 < child2->as<XMLList>()->nodes.end(); it2++)
 				{
-					th->incRef();
 					(*it2)->incRef();
-					(*it2)->parentNode = _NR<XML>(th);
+					(*it2)->setParentNode(th);
 				}
-				th->childrenlist->nodes.insert(it,child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
+				th->modifyChildren()->nodes.insert(it,child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
 			}
 			return th;
 		}
@@ -2312,20 +2382,424 @@ bool XML::isEqual(ASObject* r)
 	return false;
 }
 
-void XML::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-		    std::map<const ASObject*, uint32_t>& objMap,
-		    std::map<const Class_base*, uint32_t>& traitsMap)
+void XML::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+		    std::unordered_map<const ASObject*, uint32_t>& objMap,
+		    std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	out->writeByte(xml_marker);
 	out->writeXMLString(objMap, this, toString());
 }
 
+namespace lightspark
+{
+/*
+ * Builds the E4X tree directly from the SAX2 events of libxml2, so that
+ * parsed documents don't also exist as a libxml++ DOM. Only well formed
+ * documents without a DTD are handled, for anything else build() returns
+ * false and the DOM based parser is used.
+ * The tree is built without parent references, so that a partial tree is
+ * released as a whole by the decRef of its root. linkTree() adds them once
+ * the document has been accepted.
+ */
+class XMLTreeBuilder
+{
+private:
+	struct openElement
+	{
+		XML* node;
+		bool applyDefaultNS;
+		//State of the children as they would be in the DOM, including the ignored ones
+		bool hasChildren;
+		bool firstChildIsText;
+		bool lastChildIsText;
+		openElement(XML* n, bool d):node(n),applyDefaultNS(d),hasChildren(false),firstChildIsText(false),lastChildIsText(false){}
+	};
+	xmlParserCtxtPtr ctxt;
+	XML* root;
+	const tiny_string defaultNS;
+	const tiny_string attributeNS;
+	const bool keepBlanks;
+	bool rootFound;
+	bool unsupported;
+	std::vector<openElement> stack;
+	//Consecutive character events are merged into a single node, like the DOM does
+	std::string pendingText;
+	xmlElementType pendingType;
+	//Names and namespace URIs are interned by the dictionary of the parser,
+	//so their conversions can be cached by pointer
+	std::map<const xmlChar*, tiny_string> names;
+	std::map<std::pair<const xmlChar*, const xmlChar*>, _R<Namespace>> namespaces;
+	const tiny_string& internName(const xmlChar* name);
+	_R<Namespace> internNamespace(const xmlChar* uri, const xmlChar* prefix);
+	void initNode(XML* node, xmlElementType type, const tiny_string& name);
+	void appendChild(XML* parent, XML* child);
+	void noteChild(bool isText);
+	void flushText(bool closing);
+	static void startElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI,
+			int nb_namespaces, const xmlChar** namespaces, int nb_attributes, int nb_defaulted, const xmlChar** attributes);
+	static void endElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI);
+	static void characters(void* ctx, const xmlChar* ch, int len);
+	static void cdataBlock(void* ctx, const xmlChar* value, int len);
+	static void comment(void* ctx, const xmlChar* value);
+	static void processingInstruction(void* ctx, const xmlChar* target, const xmlChar* data);
+	static void internalSubset(void* ctx, const xmlChar* name, const xmlChar* externalID, const xmlChar* systemID);
+	static void structuredError(void* ctx, xmlErrorPtr error);
+	bool rootUsesDefaultNS(const xmlChar* URI, int nb_namespaces, const xmlChar** namespaces) const;
+public:
+	XMLTreeBuilder(XML* r, const tiny_string& default_ns, bool k);
+	bool build(const std::string& str);
+	static void linkTree(XML* node);
+};
+}
+
+XMLTreeBuilder::XMLTreeBuilder(XML* r, const tiny_string& default_ns, bool k):
+	ctxt(NULL),root(r),defaultNS(default_ns),attributeNS(getVm()->getDefaultXMLNamespace()),keepBlanks(k),
+	rootFound(false),unsupported(false),pendingType((xmlElementType)0)
+{
+}
+
+bool XMLTreeBuilder::build(const std::string& str)
+{
+	//Plain text is never a document, leave it to the text node of buildFromString
+	size_t start=str.find_first_not_of(" \t\r\n");
+	if(start==std::string::npos || str[start]!='<')
+		return false;
+
+	ctxt=xmlCreateMemoryParserCtxt(str.c_str(), str.size());
+	if(!ctxt)
+		return false;
+
+	xmlSAXHandler* handler=(xmlSAXHandler*)calloc(1,sizeof(xmlSAXHandler));
+	handler->initialized=XML_SAX2_MAGIC;
+	handler->startElementNs=startElement;
+	handler->endElementNs=endElement;
+	handler->characters=characters;
+	//Blanks are filtered in flushText, as libxml2 needs the DOM to decide if they are ignorable
+	handler->ignorableWhitespace=characters;
+	handler->cdataBlock=cdataBlock;
+	handler->comment=comment;
+	handler->processingInstruction=processingInstruction;
+	handler->internalSubset=internalSubset;
+	handler->serror=structuredError;
+	free(ctxt->sax);
+	ctxt->sax=handler;
+	ctxt->userData=this;
+	ctxt->replaceEntities=1;
+
+	xmlParseDocument(ctxt);
+
+	bool ret=ctxt->wellFormed && !unsupported && rootFound && stack.empty();
+	xmlFreeParserCtxt(ctxt);
+	ctxt=NULL;
+	return ret;
+}
+
+const tiny_string& XMLTreeBuilder::internName(const xmlChar* name)
+{
+	auto it=names.find(name);
+	if(it==names.end())
+		it=names.insert(make_pair(name, tiny_string((const char*)name, true))).first;
+	return it->second;
+}
+
+_R<Namespace> XMLTreeBuilder::internNamespace(const xmlChar* uri, const xmlChar* prefix)
+{
+	auto key=make_pair(uri, prefix);
+	auto it=namespaces.find(key);
+	if(it==namespaces.end())
+	{
+		tiny_string u=uri ? internName(uri) : tiny_string();
+		tiny_string p=prefix ? internName(prefix) : tiny_string();
+		it=namespaces.insert(make_pair(key, _MR(Class<Namespace>::getInstanceS(u, p)))).first;
+	}
+	return it->second;
+}
+
+void XMLTreeBuilder::initNode(XML* node, xmlElementType type, const tiny_string& name)
+{
+	node->childrenlist = _MR(Class<XMLList>::getInstanceS());
+	node->attributelist = _MR(Class<XMLList>::getInstanceS());
+	node->nodetype = type;
+	node->nodename = name;
+}
+
+void XMLTreeBuilder::appendChild(XML* parent, XML* child)
+{
+	parent->childrenlist->append(_MR(child));
+}
+
+void XMLTreeBuilder::linkTree(XML* node)
+{
+	//Keep the same references as createTree
+	node->childrenlist->incRef();
+	node->childrenlist->ownerNode = node;
+	for(auto it=node->childrenlist->nodes.begin();it!=node->childrenlist->nodes.end();++it)
+	{
+		node->incRef();
+		(*it)->parentNode = _MR(node);
+		linkTree(it->getPtr());
+	}
+	for(auto it=node->attributelist->nodes.begin();it!=node->attributelist->nodes.end();++it)
+	{
+		node->incRef();
+		(*it)->parentNode = _MR(node);
+	}
+}
+
+bool XMLTreeBuilder::rootUsesDefaultNS(const xmlChar* URI, int nb_namespaces, const xmlChar** namespaces) const
+{
+	//Same as XMLBase::addDefaultNamespace: nothing is done for a root with a
+	//namespace, and xmlNewNs refuses to add a second default declaration, so
+	//a root declaring xmlns (even xmlns="") keeps no namespace
+	if(defaultNS.empty() || URI!=NULL)
+		return false;
+	for(int i=0;i<nb_namespaces;i++)
+	{
+		if(namespaces[i*2]==NULL)
+			return false;
+	}
+	return true;
+}
+
+void XMLTreeBuilder::noteChild(bool isText)
+{
+	openElement& parent=stack.back();
+	if(!parent.hasChildren)
+		parent.firstChildIsText=isText;
+	parent.hasChildren=true;
+	parent.lastChildIsText=isText;
+}
+
+void XMLTreeBuilder::flushText(bool closing)
+{
+	if(pendingType==0)
+		return;
+	const xmlElementType type=pendingType;
+	pendingType=(xmlElementType)0;
+	openElement& parent=stack.back();
+	if(type==XML_TEXT_NODE && !keepBlanks)
+	{
+		//Same heuristic of libxml2 (areBlanks) to drop whitespace between elements
+		bool blank=true;
+		for(size_t i=0;i<pendingText.size() && blank;i++)
+			blank=IS_BLANK_CH(pendingText[i]);
+		if(blank && !(closing && !parent.hasChildren) && !parent.firstChildIsText && !parent.lastChildIsText)
+		{
+			pendingText.clear();
+			return;
+		}
+	}
+	noteChild(type==XML_TEXT_NODE);
+	tiny_string value(pendingText);
+	pendingText.clear();
+	if(type==XML_TEXT_NODE && ignoreWhitespace)
+	{
+		value = root->removeWhitespace(value);
+		if(value.empty())
+			return;
+	}
+	XML* node=Class<XML>::getInstanceS();
+	initNode(node, type, (type==XML_TEXT_NODE) ? "text" : "");
+	node->nodevalue = value;
+	node->constructed = true;
+	appendChild(parent.node, node);
+}
+
+void XMLTreeBuilder::startElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI,
+		int nb_namespaces, const xmlChar** namespaces, int nb_attributes, int nb_defaulted, const xmlChar** attributes)
+{
+	XMLTreeBuilder* th=static_cast<XMLTreeBuilder*>(ctx);
+	if(th->unsupported)
+		return;
+	XML* node;
+	bool applyDefaultNS;
+	if(th->stack.empty())
+	{
+		node=th->root;
+		th->rootFound=true;
+		applyDefaultNS=th->rootUsesDefaultNS(URI, nb_namespaces, namespaces);
+	}
+	else
+	{
+		th->flushText(false);
+		th->noteChild(false);
+		node=Class<XML>::getInstanceS();
+		th->appendChild(th->stack.back().node, node);
+		applyDefaultNS=th->stack.back().applyDefaultNS && URI==NULL;
+	}
+	th->initNode(node, XML_ELEMENT_NODE, th->internName(localname));
+	if(applyDefaultNS)
+		node->nodenamespace_uri = th->defaultNS;
+	else if(URI)
+	{
+		node->nodenamespace_uri = th->internName(URI);
+		if(prefix)
+			node->nodenamespace_prefix = th->internName(prefix);
+	}
+
+	for(int i=0;i<nb_namespaces;i++)
+		node->namespacedefs.push_back(th->internNamespace(namespaces[i*2+1], namespaces[i*2]));
+	if(applyDefaultNS && th->stack.empty())
+		node->namespacedefs.push_back(_MR(Class<Namespace>::getInstanceS(th->defaultNS, "")));
+
+	//Each attribute is described by localname, prefix, URI, value and end of the value
+	for(int i=0;i<nb_attributes;i++)
+	{
+		const xmlChar** attribute=attributes+i*5;
+		XML* attr=Class<XML>::getInstanceS();
+		attr->nodetype = XML_ATTRIBUTE_NODE;
+		attr->nodename = th->internName(attribute[0]);
+		if (attribute[2])
+		{
+			attr->nodenamespace_uri = th->internName(attribute[2]);
+			if (attribute[1])
+				attr->nodenamespace_prefix = th->internName(attribute[1]);
+		}
+		else
+			attr->nodenamespace_uri = th->attributeNS;
+		attr->nodevalue = std::string((const char*)attribute[3], attribute[4]-attribute[3]);
+		attr->constructed = true;
+		node->attributelist->nodes.push_back(_MR(attr));
+	}
+	th->stack.push_back(openElement(node, applyDefaultNS));
+}
+
+void XMLTreeBuilder::endElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI)
+{
+	XMLTreeBuilder* th=static_cast<XMLTreeBuilder*>(ctx);
+	if(th->unsupported)
+		return;
+	th->flushText(true);
+	th->stack.back().node->constructed=true;
+	th->stack.pop_back();
+}
+
+void XMLTreeBuilder::characters(void* ctx, const xmlChar* ch, int len)
+{
+	XMLTreeBuilder* th=static_cast<XMLTreeBuilder*>(ctx);
+	if(th->unsupported || th->stack.empty())
+		return;
+	if(th->pendingType!=XML_TEXT_NODE)
+	{
+		th->flushText(false);
+		th->pendingType=XML_TEXT_NODE;
+	}
+	th->pendingText.append((const char*)ch, len);
+}
+
+void XMLTreeBuilder::cdataBlock(void* ctx, const xmlChar* value, int len)
+{
+	XMLTreeBuilder* th=static_cast<XMLTreeBuilder*>(ctx);
+	if(th->unsupported || th->stack.empty())
+		return;
+	if(th->pendingType!=XML_CDATA_SECTION_NODE)
+	{
+		th->flushText(false);
+		th->pendingType=XML_CDATA_SECTION_NODE;
+	}
+	th->pendingText.append((const char*)value, len);
+}
+
+void XMLTreeBuilder::comment(void* ctx, const xmlChar* value)
+{
+	XMLTreeBuilder* th=static_cast<XMLTreeBuilder*>(ctx);
+	//Comments outside the root element are not part of the tree
+	if(th->unsupported || th->stack.empty())
+		return;
+	th->flushText(false);
+	th->noteChild(false);
+	if (ignoreComments)
+		return;
+	XML* node=Class<XML>::getInstanceS();
+	th->initNode(node, XML_COMMENT_NODE, "comment");
+	node->nodevalue = (const char*)value;
+	node->constructed = true;
+	th->appendChild(th->stack.back().node, node);
+}
+
+void XMLTreeBuilder::processingInstruction(void* ctx, const xmlChar* target, const xmlChar* data)
+{
+	XMLTreeBuilder* th=static_cast<XMLTreeBuilder*>(ctx);
+	if(th->unsupported || th->stack.empty())
+		return;
+	th->flushText(false);
+	th->noteChild(false);
+	if (ignoreProcessingInstructions)
+		return;
+	XML* node=Class<XML>::getInstanceS();
+	th->initNode(node, XML_PI_NODE, th->internName(target));
+	if (data)
+		node->nodevalue = (const char*)data;
+	node->constructed = true;
+	th->appendChild(th->stack.back().node, node);
+}
+
+void XMLTreeBuilder::internalSubset(void* ctx, const xmlChar* name, const xmlChar* externalID, const xmlChar* systemID)
+{
+	//Entities declared in a DTD are only supported by the DOM parser
+	XMLTreeBuilder* th=static_cast<XMLTreeBuilder*>(ctx);
+	th->unsupported=true;
+	xmlStopParser(th->ctxt);
+}
+
+void XMLTreeBuilder::structuredError(void* ctx, xmlErrorPtr error)
+{
+	//Errors are reported by the DOM parser when falling back to it,
+	//so there is no point in scanning the rest of the input
+	XMLTreeBuilder* th=static_cast<XMLTreeBuilder*>(ctx);
+	if(error->level==XML_ERR_FATAL)
+	{
+		th->unsupported=true;
+		xmlStopParser(th->ctxt);
+	}
+}
+
+bool XML::buildTreeFromSAX(const std::string& str, const tiny_string& default_ns, bool keepBlanks)
+{
+	XML* tmp=Class<XML>::getInstanceS();
+	XMLTreeBuilder builder(tmp, default_ns, keepBlanks);
+	if(!builder.build(str))
+	{
+		//Nothing references tmp, this frees whatever has been built
+		tmp->decRef();
+		return false;
+	}
+	childrenlist=tmp->childrenlist;
+	attributelist=tmp->attributelist;
+	nodetype=tmp->nodetype;
+	nodename=tmp->nodename;
+	nodenamespace_uri=tmp->nodenamespace_uri;
+	nodenamespace_prefix=tmp->nodenamespace_prefix;
+	namespacedefs.swap(tmp->namespacedefs);
+	constructed=true;
+	tmp->decRef();
+	XMLTreeBuilder::linkTree(this);
+	return true;
+}
+
+void XML::buildTree(const std::string& str, const tiny_string& default_ns)
+{
+#ifdef XMLPP_2_35_1
+	//RecoveryDomParser drops ignorable blanks
+	const bool keepBlanks=false;
+#else
+	const bool keepBlanks=true;
+#endif
+	if(buildTreeFromSAX(parserQuirks(str), default_ns, keepBlanks))
+	{
+		hasParentNode=true;
+		return;
+	}
+	createTree(buildFromString(str, false, &hasParentNode, default_ns));
+}
+
 void XML::createTree(xmlpp::Node* node)
 {
 	const xmlpp::Node::NodeList& list=node->get_children();
 	xmlpp::Node::NodeList::const_iterator it=list.begin();
 	childrenlist = _MR(Class<XMLList>::getInstanceS());
 	childrenlist->incRef();
+	childrenlist->ownerNode = this;
 
 	this->nodetype = node->cobj()->type;
 	this->nodename = node->get_name();
@@ -26,9 +26,11 @@ namespace lightspark
 {
 class Namespace;
 class XMLList;
+class XMLTreeBuilder;
 class XML: public ASObject, public XMLBase
 {
 friend class XMLList;
+friend class XMLTreeBuilder;
 public:
 	typedef std::vector<_R<XML>> XMLVector;
 	typedef std::vector<_R<Namespace>> NSVector;
@@ -42,8 +44,42 @@ private:
 	tiny_string nodenamespace_prefix;
 	_NR<XMLList> attributelist;
 	NSVector namespacedefs;
+	/*
+	 * All the descendants grouped by the id of their name, in document order.
+	 * It's built when a node is queried twice without modifications to its
+	 * document in between. The version of a document is kept by its root and
+	 * taken from a global counter, so that it also changes when a subtree is
+	 * moved to another document. The nodes are referenced, so a modification
+	 * which does not change the version gives stale results but never
+	 * dangling nodes
+	 */
+	typedef std::map<uint32_t, XMLVector> DescendantIndex;
+	DescendantIndex* descendantIndex;
+	uint32_t descendantQueryVersion;
+	uint32_t documentVersion;
+	static ATOMIC_INT32(versionCounter);
+	XML* getRootNode();
+	void documentModified();
+	/*
+	 * Every change to the parent or to the children of an existing node goes
+	 * through these or through the mutators of its childrenlist, which know
+	 * their owner. Only the parsers link the nodes of a new tree directly
+	 */
+	void setParentNode(XML* parent);
+	//For direct changes to childrenlist->nodes
+	XMLList* modifyChildren();
+	void buildDescendantIndex(DescendantIndex& index);
+	void getDescendantsImpl(const tiny_string& name, const tiny_string& ns, bool bIsAttribute, XMLVector& ret);
 
 	void createTree(xmlpp::Node* node);
+	/*
+	 * Builds the tree from the root element of str using the SAX interface
+	 * of libxml2, without an intermediate DOM. Returns false if the input needs
+	 * the quirks and the recovery mode of the DOM based buildFromString
+	 */
+	bool buildTreeFromSAX(const std::string& str, const tiny_string& default_ns, bool keepBlanks);
+	//Tries buildTreeFromSAX first and falls back to buildFromString
+	void buildTree(const std::string& str, const tiny_string& default_ns="");
 	tiny_string toString_priv();
 	const char* nodekindString();
 	
@@ -77,6 +113,7 @@ public:
 	XML(Class_base* c);
 	XML(Class_base* c,const std::string& str);
 	XML(Class_base* c,xmlpp::Node* _n);
+	~XML();
 	void finalize();
 	ASFUNCTION(_constructor);
 	ASFUNCTION(_toString);
@@ -167,9 +204,9 @@ public:
 	_R<ASObject> nextName(uint32_t index);
 	_R<ASObject> nextValue(uint32_t index);
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 }
 #endif /* SCRIPTING_TOPLEVEL_XML_H */
@@ -51,26 +51,26 @@ using namespace lightspark;
 		return NULL; \
 	}
 
-XMLList::XMLList(Class_base* c):ASObject(c),nodes(c->memoryAccount),constructed(false),targetobject(NULL),targetproperty(c->memoryAccount)
+XMLList::XMLList(Class_base* c):ASObject(c),nodes(c->memoryAccount),constructed(false),targetobject(NULL),targetproperty(c->memoryAccount),ownerNode(NULL)
 {
 }
 
-XMLList::XMLList(Class_base* cb,bool c):ASObject(cb),nodes(cb->memoryAccount),constructed(c),targetobject(NULL),targetproperty(cb->memoryAccount)
+XMLList::XMLList(Class_base* cb,bool c):ASObject(cb),nodes(cb->memoryAccount),constructed(c),targetobject(NULL),targetproperty(cb->memoryAccount),ownerNode(NULL)
 {
 	assert(c);
 }
 
-XMLList::XMLList(Class_base* c, const std::string& str):ASObject(c),nodes(c->memoryAccount),constructed(true),targetobject(NULL),targetproperty(c->memoryAccount)
+XMLList::XMLList(Class_base* c, const std::string& str):ASObject(c),nodes(c->memoryAccount),constructed(true),targetobject(NULL),targetproperty(c->memoryAccount),ownerNode(NULL)
 {
 	buildFromString(str);
 }
 
 XMLList::XMLList(Class_base* c, const XML::XMLVector& r):
-	ASObject(c),nodes(r.begin(),r.end(),c->memoryAccount),constructed(true),targetobject(NULL),targetproperty(c->memoryAccount)
+	ASObject(c),nodes(r.begin(),r.end(),c->memoryAccount),constructed(true),targetobject(NULL),targetproperty(c->memoryAccount),ownerNode(NULL)
 {
 }
 XMLList::XMLList(Class_base* c, const XML::XMLVector& r, XMLList *targetobject, const multiname &targetproperty):
-	ASObject(c),nodes(r.begin(),r.end(),c->memoryAccount),constructed(true),targetobject(targetobject),targetproperty(c->memoryAccount)
+	ASObject(c),nodes(r.begin(),r.end(),c->memoryAccount),constructed(true),targetobject(targetobject),targetproperty(c->memoryAccount),ownerNode(NULL)
 {
 	if (targetobject)
 		targetobject->incRef();
@@ -83,6 +83,12 @@ XMLList::XMLList(Class_base* c, const XML::XMLVector& r, XMLList *targetobject,
 	}
 }
 
+void XMLList::nodesModified()
+{
+	if (ownerNode)
+		ownerNode->documentModified();
+}
+
 void XMLList::finalize()
 {
 	if (targetobject)
@@ -207,6 +213,18 @@ void XMLList::buildFromString(const std::string& str)
 		"<parent xmlns=\"" + default_ns + "\">" + 
 		XMLBase::parserQuirks(str_without_xmldecl) + 
 		"</parent>";
+	//The fast path doesn't need a DOM, the nodes are the children of the fake parent
+	_R<XML> root=_MR(Class<XML>::getInstanceS());
+	if(root->buildTreeFromSAX(expanded, "", true))
+	{
+		XMLListVector::const_iterator it;
+		for(it=root->childrenlist->nodes.begin(); it!=root->childrenlist->nodes.end(); ++it)
+		{
+			(*it)->parentNode=NullRef;
+			nodes.push_back(*it);
+		}
+		return;
+	}
 	try
 	{
 		parser.parse_memory(expanded);
@@ -564,6 +582,7 @@ ASFUNCTIONBODY(XMLList,_normalize)
 }
 void XMLList::normalize()
 {
+	nodesModified();
 	auto it=nodes.begin();
 	while (it!=nodes.end())
 	{
@@ -600,6 +619,7 @@ void XMLList::normalize()
 
 void XMLList::clear()
 {
+	nodesModified();
 	nodes.clear();
 }
 void XMLList::getTargetVariables(const multiname& name,XML::XMLVector& retnodes)
@@ -830,7 +850,7 @@ bool XMLList::deleteVariableByMultiname(const multiname& name)
 				_R<XML> n = *it;
 				if (n.getPtr() == node.getPtr())
 				{
-					node->parentNode->childrenlist->nodes.erase(it);
+					node->parentNode->modifyChildren()->nodes.erase(it);
 					break;
 				}
 			}
@@ -915,11 +935,13 @@ void XMLList::appendSingleNode(ASObject *x)
 
 void XMLList::append(_R<XML> x)
 {
+	nodesModified();
 	nodes.push_back(x);
 }
 
 void XMLList::append(_R<XMLList> x)
 {
+	nodesModified();
 	nodes.insert(nodes.end(),x->nodes.begin(),x->nodes.end());
 }
 
@@ -927,6 +949,7 @@ void XMLList::replace(unsigned int idx, ASObject *o, const XML::XMLVector &retno
 {
 	if (idx >= nodes.size())
 		return;
+	nodesModified();
 
 	if (nodes[idx]->getNodeKind() == XML_ATTRIBUTE_NODE || nodes[idx]->getNodeKind() == XML_TEXT_NODE)
 	{
@@ -986,8 +1009,7 @@ void XMLList::replace(unsigned int idx, ASObject *o, const XML::XMLVector &retno
 		{
 			nodes[idx]->childrenlist->clear();
 			_R<XML> tmp = _MR<XML>(Class<XML>::getInstanceS());
-			nodes[idx]->incRef();
-			tmp->parentNode = nodes[idx];
+			tmp->setParentNode(nodes[idx].getPtr());
 			tmp->nodetype = XML_TEXT_NODE;
 			tmp->nodename = "text";
 			tmp->nodenamespace_uri = "";
@@ -36,6 +36,11 @@ private:
 	bool constructed;
 	XMLList* targetobject;
 	multiname targetproperty;
+	//The node this is the childrenlist of, if any. It's not referenced,
+	//XML::finalize resets it
+	XML* ownerNode;
+	//Every change to the nodes of a childrenlist changes the document version
+	void nodesModified();
 
 	tiny_string toString_priv();
 	void buildFromString(const std::string& str);
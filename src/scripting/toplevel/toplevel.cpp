@@ -103,9 +103,9 @@ ASObject *Undefined::describeType() const
 	return getSys()->getUndefinedRef();
 }
 
-void Undefined::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Undefined::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	out->writeByte(undefined_marker);
 }
@@ -463,29 +463,9 @@ ASObject* SyntheticFunction::call(ASObject* obj, ASObject* const* args, uint32_t
 		}
 		catch (ASObject* excobj) // Doesn't have to be an ASError at all.
 		{
-			unsigned int pos = cc.exec_pos;
-			bool no_handler = true;
-
-			LOG(LOG_TRACE, "got an " << excobj->toString());
-			LOG(LOG_TRACE, "pos=" << pos);
-			for (unsigned int i=0;i<mi->body->exceptions.size();i++)
-			{
-				exception_info exc=mi->body->exceptions[i];
-				multiname* name=mi->context->getMultiname(exc.exc_type, NULL);
-				LOG(LOG_TRACE, "f=" << exc.from << " t=" << exc.to << " type=" << *name);
-				if (pos >= exc.from && pos <= exc.to && mi->context->isinstance(excobj, name))
-				{
-					no_handler = false;
-					cc.exec_pos = exc.target;
-					cc.runtime_stack_clear();
-					cc.runtime_stack_push(excobj);
-					cc.scope_stack.clear();
-					cc.scope_stack=func_scope;
-					cc.initialScopeStack=func_scope.size();
-					break;
-				}
-			}
-			if (no_handler)
+			//AS3 throws handled in the same method never get here, the interpreters
+			//jump to the handler directly. This deals with exceptions raised by callees and by the runtime
+			if (!ABCVm::findExceptionHandler(this,&cc,excobj))
 			{
 				cur_recursion--; //decrement current recursion depth
 				Log::calls_indent--;
@@ -553,6 +533,34 @@ ASObject* Function::call(ASObject* obj, ASObject* const* args, uint32_t num_args
 	return ret;
 }
 
+ASObject* Function::callNative(ASObject* obj, ASObject* const* args, uint32_t argslen)
+{
+	assert(native.accepts(argslen));
+	ASObject* ret;
+	if(isBound())
+	{
+		obj->decRef();
+		obj=closure_this.getPtr();
+		obj->incRef();
+	}
+	try
+	{
+		ret=native.invoke(native.f,obj,args,argslen);
+	}
+	catch(ASObject* excobj)
+	{
+		for(uint32_t i=0;i<argslen;i++)
+			args[i]->decRef();
+		obj->decRef();
+		throw;
+	}
+
+	for(uint32_t i=0;i<argslen;i++)
+		args[i]->decRef();
+	obj->decRef();
+	return ret;
+}
+
 bool Null::isEqual(ASObject* r)
 {
 	switch(r->getObjectType())
@@ -633,9 +641,9 @@ int Null::toInt()
 	return 0;
 }
 
-void Null::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Null::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	out->writeByte(null_marker);
 }
@@ -1937,6 +1945,125 @@ void Global::registerBuiltin(const char* name, const char* ns, _R<ASObject> o)
 	setVariableByQName(name,nsNameAndKind(ns,NAMESPACE),o.getPtr(),DECLARED_TRAIT);
 }
 
+ActivationScope::ActivationScope(Class_base* c, const std::vector<varName>* n):
+	ASObject(c),names(n),slots(n->size(),variable(NO_CREATE_TRAIT),reporter_allocator<variable>(c->memoryAccount))
+{
+}
+
+ActivationScope::~ActivationScope()
+{
+	finalize();
+}
+
+void ActivationScope::finalize()
+{
+	ASObject::finalize();
+	for(unsigned int i=0;i<slots.size();i++)
+	{
+		if(slots[i].var)
+			slots[i].var->decRef();
+	}
+	slots.clear();
+}
+
+variable* ActivationScope::findSlot(const multiname& name)
+{
+	//Layouts are small, a linear scan is faster than any lookup structure
+	uint32_t nameId=name.normalizedNameId();
+	for(unsigned int i=0;i<slots.size();i++)
+	{
+		const varName& n=(*names)[i];
+		if(n.nameId!=nameId)
+			continue;
+		for(auto it=name.ns.begin();it!=name.ns.end();++it)
+		{
+			if(n.ns==*it)
+				return &slots[i];
+		}
+	}
+	return NULL;
+}
+
+void ActivationScope::initSlotValue(unsigned int n, ASObject* o, multiname* typemname, const Type* type, TRAIT_KIND traitKind)
+{
+	assert_and_throw(n > 0 && n<=slots.size());
+	if(typemname)
+	{
+		/* If type is a builtin type, we coerce o.
+		 * It it's not it must be a user defined class,
+		 * so we only allow Null and Undefined (which are both coerced to Null) */
+		if(type==NULL)
+		{
+			assert_and_throw(o->is<Null>() || o->is<Undefined>());
+			if(o->is<Undefined>())
+			{
+				o->decRef();
+				o=getSys()->getNullRef();
+			}
+		}
+		else
+			o=type->coerce(o);
+	}
+	slots[n-1]=variable(traitKind, o, typemname, type);
+}
+
+ASObject* ActivationScope::getSlot(unsigned int n)
+{
+	assert_and_throw(n > 0 && n<=slots.size());
+	return slots[n-1].var;
+}
+
+void ActivationScope::setSlot(unsigned int n, ASObject* o)
+{
+	if(n == 0 || n>slots.size())
+		throw RunTimeException("setSlot out of bounds");
+	slots[n-1].setVar(o);
+}
+
+void ActivationScope::setSlotNoCoerce(unsigned int n, ASObject* o)
+{
+	if(n == 0 || n>slots.size())
+		throw RunTimeException("setSlot out of bounds");
+	slots[n-1].setVarNoCoerce(o);
+}
+
+_NR<ASObject> ActivationScope::getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION opt)
+{
+	variable* v=findSlot(name);
+	if(v==NULL)
+		return ASObject::getVariableByMultiname(name,opt);
+	v->var->incRef();
+	return _MNR(v->var);
+}
+
+void ActivationScope::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOWED_FLAG allowConst)
+{
+	variable* v=findSlot(name);
+	if(v==NULL)
+	{
+		ASObject::setVariableByMultiname(name,o,allowConst);
+		return;
+	}
+	if(v->kind==CONSTANT_TRAIT && allowConst==CONST_NOT_ALLOWED)
+		throwError<ReferenceError>(kConstWriteError, name.normalizedName(), getClass()->getQualifiedClassName());
+	v->setVar(o);
+}
+
+bool ActivationScope::hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype)
+{
+	if(findSlot(name))
+		return true;
+	return ASObject::hasPropertyByMultiname(name,considerDynamic,considerPrototype);
+}
+
+bool ActivationScope::deleteVariableByMultiname(const multiname& name)
+{
+	//Slots are declared traits, which are not deletable
+	if(findSlot(name))
+		return false;
+	return ASObject::deleteVariableByMultiname(name);
+}
+
 ASFUNCTIONBODY(lightspark,eval)
 {
     // eval is not allowed in AS3, but an exception should be thrown
@@ -1979,7 +2106,12 @@ ASFUNCTIONBODY(lightspark,parseFloat)
 	if (p1) *p1='Y';
 
 	p=str.raw_buf();
-	double d=strtod(p, &end);
+	double d;
+	const char* fastEnd;
+	if (Number::parseDecimalFast(p, &fastEnd, d))
+		end=const_cast<char*>(fastEnd);
+	else
+		d=strtod(p, &end);
 
 	if (end==p)
 		return abstract_d(numeric_limits<double>::quiet_NaN());
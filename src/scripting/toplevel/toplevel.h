@@ -364,6 +364,26 @@ public:
 	virtual ASObject *describeType() const;
 };
 
+/*
+ * Typed entry point of a builtin function, built by makeNativeBinding
+ * (see argconv.h). 'f' is the typed C++ function and 'invoke' converts
+ * exactly 'argc' arguments and the return value around it. Variadic
+ * bindings accept any number of arguments and pass them unconverted.
+ */
+struct native_binding
+{
+	typedef void (*generic_function)();
+	typedef ASObject* (*invoker)(generic_function f, ASObject* obj, ASObject* const* args, uint32_t argslen);
+	generic_function f;
+	invoker invoke;
+	uint32_t argc;
+	bool variadic;
+	native_binding():f(NULL),invoke(NULL),argc(0),variadic(false){}
+	native_binding(generic_function _f, invoker _i, uint32_t _a, bool _v=false):f(_f),invoke(_i),argc(_a),variadic(_v){}
+	bool isValid() const { return invoke!=NULL; }
+	bool accepts(uint32_t argslen) const { return isValid() && (variadic || argc==argslen); }
+};
+
 /*
  * Implements the IFunction interface for functions implemented
  * in c-code.
@@ -376,7 +396,10 @@ public:
 protected:
 	/* Function pointer to the C-function implementation */
 	as_function val;
+	/* Optional typed entry point, used when the call can be resolved early */
+	native_binding native;
 	Function(Class_base* c, as_function v=NULL):IFunction(c),val(v){}
+	Function(Class_base* c, as_function v, const native_binding& n):IFunction(c),val(v),native(n){}
 	Function* clone()
 	{
 		return new (getClass()->memoryAccount) Function(*this);
@@ -384,6 +407,12 @@ protected:
 	method_info* getMethodInfo() const { return NULL; }
 public:
 	ASObject* call(ASObject* obj, ASObject* const* args, uint32_t num_args);
+	const native_binding& getNativeBinding() const { return native; }
+	/*
+	 * Calls the typed entry point. getNativeBinding() must accept argslen
+	 * arguments. References are consumed like in call.
+	 */
+	ASObject* callNative(ASObject* obj, ASObject* const* args, uint32_t argslen);
 	bool isEqual(ASObject* r)
 	{
 		Function* f=dynamic_cast<Function*>(r);
@@ -481,6 +510,13 @@ public:
 		ret->length = len;
 		return ret;
 	}
+	static Function* getFunction(Function::as_function v, int len, const native_binding& n)
+	{
+		Class<IFunction>* c=Class<IFunction>::getClass();
+		Function* ret=new (c->memoryAccount) Function(c, v, n);
+		ret->length = len;
+		return ret;
+	}
 	static SyntheticFunction* getSyntheticFunction(method_info* m)
 	{
 		Class<IFunction>* c=Class<IFunction>::getClass();
@@ -504,9 +540,9 @@ public:
 	TRISTATE isLess(ASObject* r);
 	ASObject *describeType() const;
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	void setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOWED_FLAG allowConst);
 };
 
@@ -522,9 +558,9 @@ public:
 	void setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOWED_FLAG allowConst);
 
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 
 class ASQName: public ASObject
@@ -597,6 +633,37 @@ public:
 	void registerBuiltin(const char* name, const char* ns, _R<ASObject> o);
 };
 
+/*
+ * The scope object built by newactivation and newcatch. Its slots have a
+ * layout computed once per method, so they are kept in an array indexed by
+ * slot id instead of in the variables map. Names which are not slots are
+ * handled by ASObject as usual.
+ */
+class ActivationScope : public ASObject
+{
+private:
+	//names[i] is the name of slot i+1, it is owned by the method_info
+	const std::vector<varName>* names;
+	std::vector<variable, reporter_allocator<variable>> slots;
+	variable* findSlot(const multiname& name);
+public:
+	ActivationScope(Class_base* c, const std::vector<varName>* n);
+	~ActivationScope();
+	void finalize();
+	/*
+	 * Sets the initial value of slot n, coercing it to type. A NULL
+	 * typemname means an untyped slot, like the one of catch scopes
+	 */
+	void initSlotValue(unsigned int n, ASObject* o, multiname* typemname, const Type* type, TRAIT_KIND traitKind);
+	ASObject* getSlot(unsigned int n);
+	void setSlot(unsigned int n, ASObject* o);
+	void setSlotNoCoerce(unsigned int n, ASObject* o);
+	_NR<ASObject> getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION opt=NONE);
+	void setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOWED_FLAG allowConst);
+	bool hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype);
+	bool deleteVariableByMultiname(const multiname& name);
+};
+
 ASObject* eval(ASObject* obj,ASObject* const* args, const unsigned int argslen);
 ASObject* parseInt(ASObject* obj,ASObject* const* args, const unsigned int argslen);
 ASObject* parseFloat(ASObject* obj,ASObject* const* args, const unsigned int argslen);
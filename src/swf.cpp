@@ -72,18 +72,27 @@ ParseThread* lightspark::getParseThread()
 	return pt;
 }
 
+bool lightspark::isParseThread()
+{
+	return tls_get(&parse_thread_tls)!=NULL;
+}
+
 RootMovieClip::RootMovieClip(_NR<LoaderInfo> li, _NR<ApplicationDomain> appDomain, _NR<SecurityDomain> secDomain, Class_base* c):
 	MovieClip(c),
 	parsingIsFailed(false),Background(0xFF,0xFF,0xFF),frameRate(0),
 	finishedLoading(false),applicationDomain(appDomain),securityDomain(secDomain)
 {
 	loaderInfo=li;
+	for(unsigned int i=0;i<256;i++)
+		RELEASE_WRITE(dictionaryIndex[i],NULL);
 }
 
 RootMovieClip::~RootMovieClip()
 {
 	for(auto it=dictionary.begin();it!=dictionary.end();++it)
 		delete *it;
+	for(unsigned int i=0;i<256;i++)
+		delete ACQUIRE_READ(dictionaryIndex[i]);
 }
 
 void RootMovieClip::parsingFailed()
@@ -1172,16 +1181,16 @@ void ThreadProfile::plot(uint32_t maxTime, cairo_t *cr)
 
 ParseThread::ParseThread(istream& in, _R<ApplicationDomain> appDomain, _R<SecurityDomain> secDomain, Loader *_loader, tiny_string srcurl)
   : version(0),applicationDomain(appDomain),securityDomain(secDomain),
-    f(in),uncompressingFilter(NULL),backend(NULL),loader(_loader),
-    parsedObject(NullRef),url(srcurl),fileType(FT_UNKNOWN)
+    f(in),uncompressingFilter(NULL),pipeline(NULL),backend(NULL),loader(_loader),
+    parsedObject(NullRef),url(srcurl),fileType(FT_UNKNOWN),parsingFirstFrame(true)
 {
 	f.exceptions ( istream::eofbit | istream::failbit | istream::badbit );
 }
 
 ParseThread::ParseThread(std::istream& in, RootMovieClip *root)
   : version(0),applicationDomain(NullRef),securityDomain(NullRef), //The domains are not needed since the system state create them itself
-    f(in),uncompressingFilter(NULL),backend(NULL),loader(NULL),
-    parsedObject(NullRef),url(),fileType(FT_UNKNOWN)
+    f(in),uncompressingFilter(NULL),pipeline(NULL),backend(NULL),loader(NULL),
+    parsedObject(NullRef),url(),fileType(FT_UNKNOWN),parsingFirstFrame(true)
 {
 	f.exceptions ( istream::eofbit | istream::failbit | istream::badbit );
 	setRootMovie(root);
@@ -1233,21 +1242,32 @@ void ParseThread::parseSWFHeader(RootMovieClip *root, UI8 ver)
 	{
 		//The file is compressed, create a filtering streambuf
 		backend=f.rdbuf();
+		uncompressing_filter* filter=NULL;
 		if(fileType==FT_COMPRESSED_SWF)
 		{
 			LOG(LOG_INFO, _("zlib compressed SWF file: Version ") << (int)version);
-			uncompressingFilter = new zlib_filter(backend);
+			filter = new zlib_filter(backend);
 		}
 		else if(fileType==FT_LZMA_COMPRESSED_SWF)
 		{
 			LOG(LOG_INFO, _("lzma compressed SWF file: Version ") << (int)version);
-			uncompressingFilter = new liblzma_filter(backend);
+			filter = new liblzma_filter(backend);
 		}
 		else
 		{
 			// not reached
 			assert(false);
 		}
+		//Uncompress ahead of the parser on another thread if enabled. The
+		//buffer does not need to be bigger than the uncompressed file
+		size_t pipelineSize=min(Config::getConfig()->getDecompressionBufferSize(),(size_t)(uint32_t)FileLength);
+		if(pipelineSize)
+		{
+			pipeline = new pipelined_filter(filter, pipelineSize);
+			uncompressingFilter = pipeline;
+		}
+		else
+			uncompressingFilter = filter;
 		f.rdbuf(uncompressingFilter);
 	}
 
@@ -1271,6 +1291,8 @@ void ParseThread::parseSWFHeader(RootMovieClip *root, UI8 ver)
 
 void ParseThread::execute()
 {
+	//ThreadPool threads also run other jobs after this one
+	ParseThread* outer=(ParseThread*)tls_get(&parse_thread_tls);
 	tls_set(&parse_thread_tls,this);
 	try
 	{
@@ -1311,6 +1333,10 @@ void ParseThread::execute()
 	{
 		LOG(LOG_ERROR,_("Stream exception in ParseThread ") << e.what());
 	}
+	//The caller may destroy the input stream as soon as we return
+	if(pipeline)
+		pipeline->stop();
+	tls_set(&parse_thread_tls,outer);
 }
 
 void ParseThread::parseSWF(UI8 ver)
@@ -1352,6 +1378,7 @@ void ParseThread::parseSWF(UI8 ver)
 			getSys()->needsAVM2(false);
 			return; /* no more parsing necessary, handled by fallback */
 		}
+		openAssetBundle(root);
 
 		TagFactory factory(f, true);
 		Tag* tag=factory.readTag(root);
@@ -1403,7 +1430,9 @@ void ParseThread::parseSWF(UI8 ver)
 						root->commitFrame(false);
 					else
 						root->revertFrame();
+					requestDeferredDecoding();
 					RELEASE_WRITE(root->finishedLoading,true);
+					storeAssets(root);
 					done=true;
 					root->check();
 					delete tag;
@@ -1416,9 +1445,14 @@ void ParseThread::parseSWF(UI8 ver)
 					break;
 				}
 				case DISPLAY_LIST_TAG:
-					root->addToFrame(static_cast<const DisplayListTag*>(tag));
+				{
+					const DisplayListTag* l=static_cast<const DisplayListTag*>(tag);
+					root->addToFrame(l);
+					if(parsingFirstFrame)
+						l->requestDecoding();
 					empty=false;
 					break;
+				}
 				case SHOW_TAG:
 					// The whole frame has been parsed, now execute all queued SymbolClass tags,
 					// in the order in which they appeared in the file.
@@ -1431,6 +1465,7 @@ void ParseThread::parseSWF(UI8 ver)
 					}
 
 					root->commitFrame(true);
+					requestDeferredDecoding();
 					empty=true;
 					delete tag;
 					break;
@@ -1492,6 +1527,62 @@ void ParseThread::parseSWF(UI8 ver)
 	LOG(LOG_TRACE,_("End of parsing"));
 }
 
+void ParseThread::openAssetBundle(RootMovieClip* root)
+{
+	if(!AssetBundle::isEnabled())
+		return;
+	//Bundles are keyed by the contents of the file, which are only
+	//known upfront for local files read through a mapping
+	streambuf* raw=backend ? backend : f.rdbuf();
+	mapped_file_buf* mapped=dynamic_cast<mapped_file_buf*>(raw);
+	if(mapped==NULL)
+		return;
+	const uint8_t* contents=(const uint8_t*)g_mapped_file_get_contents(mapped->getMapping());
+	root->assetBundle=AssetBundle::open(contents,mapped->size());
+}
+
+void ParseThread::storeAssets(RootMovieClip* root)
+{
+	if(root->assetBundle.isNull())
+		return;
+	//The dictionary index holds the first definition of each id,
+	//which is the one the bundle is keyed by
+	std::vector<const DictionaryTag*> tags;
+	for(unsigned int i=0;i<256;i++)
+	{
+		RootMovieClip::DictionaryPage* page=ACQUIRE_READ(root->dictionaryIndex[i]);
+		if(page==NULL)
+			continue;
+		for(unsigned int j=0;j<256;j++)
+		{
+			const DictionaryTag* t=ACQUIRE_READ(page->tags[j]);
+			if(dynamic_cast<const BitmapTag*>(t) || dynamic_cast<const DefineShapeTag*>(t) ||
+			   dynamic_cast<const DefineTextTag*>(t))
+				tags.push_back(t);
+		}
+	}
+	root->incRef();
+	root->assetBundle->storeAsync(_MR(root),tags);
+}
+
+void ParseThread::deferDecoding(const DictionaryTag* t)
+{
+	assert(parsingFirstFrame);
+	deferredTags.push_back(t);
+}
+
+void ParseThread::requestDeferredDecoding()
+{
+	if(!parsingFirstFrame)
+		return;
+	//The assets of the first frame have been queued when they were placed,
+	//the others follow in file order
+	parsingFirstFrame=false;
+	for(auto it=deferredTags.begin();it!=deferredTags.end();++it)
+		(*it)->requestDecoding();
+	deferredTags.clear();
+}
+
 void ParseThread::parseBitmap()
 {
 	_NR<LoaderInfo> li;
@@ -1610,24 +1701,37 @@ void RootMovieClip::addToDictionary(DictionaryTag* r)
 {
 	SpinlockLocker l(dictSpinlock);
 	dictionary.push_back(r);
+	int id=r->getId();
+	if(id<0 || id>0xffff)
+		return;
+	DictionaryPage* page=ACQUIRE_READ(dictionaryIndex[id>>8]);
+	if(page==NULL)
+	{
+		//Value initialization clears the entries
+		page=new DictionaryPage();
+		RELEASE_WRITE(dictionaryIndex[id>>8],page);
+	}
+	//If an id is defined more than once the first definition is used
+	if(ACQUIRE_READ(page->tags[id&0xff])==NULL)
+		RELEASE_WRITE(page->tags[id&0xff],r);
 }
 
 /* called in vm's thread context */
 DictionaryTag* RootMovieClip::dictionaryLookup(int id)
 {
-	SpinlockLocker l(dictSpinlock);
-	auto it = dictionary.begin();
-	for(;it!=dictionary.end();++it)
+	DictionaryTag* ret=NULL;
+	if(id>=0 && id<=0xffff)
 	{
-		if((*it)->getId()==id)
-			break;
+		DictionaryPage* page=ACQUIRE_READ(dictionaryIndex[id>>8]);
+		if(page)
+			ret=ACQUIRE_READ(page->tags[id&0xff]);
 	}
-	if(it==dictionary.end())
+	if(ret==NULL)
 	{
 		LOG(LOG_ERROR,_("No such Id on dictionary ") << id << " for " << origin);
 		throw RunTimeException("Could not find an object on the dictionary");
 	}
-	return *it;
+	return ret;
 }
 
 _NR<RootMovieClip> RootMovieClip::getRoot()
@@ -28,6 +28,7 @@
 #include <boost/bimap.hpp>
 #include <string>
 #include "swftypes.h"
+#include "backends/assetcache.h"
 #include "scripting/flash/display/flashdisplay.h"
 #include "scripting/flash/net/flashnet.h"
 #include "scripting/flash/utils/IntervalManager.h"
@@ -35,7 +36,7 @@
 #include "memory_support.h"
 #include "platforms/engineutils.h"
 
-class uncompressing_filter;
+class pipelined_filter;
 
 namespace lightspark
 {
@@ -66,7 +67,17 @@ private:
 	bool parsingIsFailed;
 	RGB Background;
 	Spinlock dictSpinlock;
+	//Owns the tags, in definition order
 	std::list < DictionaryTag* > dictionary;
+	/* Character ids are 16 bit, so the tags are also indexed by id in
+	 * a two level table allocated a page at a time. Entries are never
+	 * changed once published, so lookups do not take dictSpinlock.
+	 */
+	struct DictionaryPage
+	{
+		ACQUIRE_RELEASE_VARIABLE(DictionaryTag*, tags[256]);
+	};
+	ACQUIRE_RELEASE_VARIABLE(DictionaryPage*, dictionaryIndex[256]);
 	//frameSize and frameRate are valid only after the header has been parsed
 	RECT frameSize;
 	float frameRate;
@@ -114,6 +125,12 @@ public:
 	 * The security domain for this clip
 	 */
 	_NR<SecurityDomain> securityDomain;
+	/*
+	 * The cached assets of the file, set by the ParseThread before the
+	 * tags are read. It is null if the file is not a local mapped file
+	 * or the cache is disabled
+	 */
+	_NR<AssetBundle> assetBundle;
 	//DisplayObject interface
 	_NR<RootMovieClip> getRoot();
 	void addBinding(const tiny_string& name, DictionaryTag *tag);
@@ -451,20 +468,33 @@ public:
 	RootMovieClip* getRootMovie() const;
 	static FILE_TYPE recognizeFile(uint8_t c1, uint8_t c2, uint8_t c3, uint8_t c4);
 	void execute();
+	bool isParsingFirstFrame() const { return parsingFirstFrame; }
+	//Holds back the decoding of t until the first frame is committed
+	void deferDecoding(const DictionaryTag* t);
 	_NR<ApplicationDomain> applicationDomain;
 	_NR<SecurityDomain> securityDomain;
 private:
 	std::istream& f;
-	uncompressing_filter* uncompressingFilter;
+	std::streambuf* uncompressingFilter;
+	//Same as uncompressingFilter if the file is uncompressed on another thread
+	pipelined_filter* pipeline;
 	std::streambuf* backend;
 	Loader *loader;
 	_NR<DisplayObject> parsedObject;
 	Spinlock objectSpinlock;
 	tiny_string url;
 	FILE_TYPE fileType;
+	/* Assets are decoded on the ThreadPool. While the first frame
+	 * is parsed, only the ones it places are queued, so that they
+	 * do not wait behind assets of later frames */
+	bool parsingFirstFrame;
+	std::vector<const DictionaryTag*> deferredTags;
+	void requestDeferredDecoding();
 	void threadAbort();
 	void jobFence() {};
 	void parseSWFHeader(RootMovieClip *root, UI8 ver);
+	void openAssetBundle(RootMovieClip *root);
+	void storeAssets(RootMovieClip *root);
 	void parseSWF(UI8 ver);
 	void parseBitmap();
 	void setRootMovie(RootMovieClip *root);
@@ -476,6 +506,8 @@ SystemState* getSys() DLL_PUBLIC;
 void setTLSSys(SystemState* sys) DLL_PUBLIC;
 
 ParseThread* getParseThread();
+//True if the calling thread is parsing a file
+bool isParseThread();
 
 };
 #endif /* SWF_H */
@@ -37,7 +37,8 @@
 using namespace std;
 using namespace lightspark;
 
-multiname::multiname(MemoryAccount* m):name_o(NULL),ns(reporter_allocator<nsNameAndKind>(m)),name_type(NAME_OBJECT),isAttribute(false)
+multiname::multiname(MemoryAccount* m):name_o(NULL),ns(reporter_allocator<nsNameAndKind>(m)),name_type(NAME_OBJECT),isAttribute(false),
+	isStatic(false)
 {
 }
 
@@ -108,14 +109,20 @@ void multiname::setName(ASObject* n)
 	}
 	else if(n->is<UInteger>())
 	{
-		name_i=n->as<UInteger>()->val;
-		name_type = NAME_INT;
+		uint32_t val=n->as<UInteger>()->val;
+		if(val<=INT32_MAX)
+		{
+			name_i=val;
+			name_type = NAME_INT;
+		}
+		else
+		{
+			name_d=val;
+			name_type = NAME_NUMBER;
+		}
 	}
 	else if(n->is<Number>())
-	{
-		name_d=n->as<Number>()->val;
-		name_type = NAME_NUMBER;
-	}
+		setName(n->as<Number>()->val);
 	else if(n->getObjectType()==T_QNAME)
 	{
 		ASQName* qname=static_cast<ASQName*>(n);
@@ -136,6 +143,27 @@ void multiname::setName(ASObject* n)
 	}
 }
 
+void multiname::setName(number_t d)
+{
+	if (name_type==NAME_OBJECT && name_o!=NULL) {
+		name_o->decRef();
+		name_o = NULL;
+	}
+
+	//Integral values are kept as NAME_INT, so that indexed access
+	//to Array/Vector/ByteArray never has to go through strings
+	if(Number::isInteger(d) && d>=INT32_MIN && d<=INT32_MAX)
+	{
+		name_i=d;
+		name_type = NAME_INT;
+	}
+	else
+	{
+		name_d=d;
+		name_type = NAME_NUMBER;
+	}
+}
+
 void multiname::resetNameIfObject()
 {
 	if(name_type==NAME_OBJECT && name_o)
@@ -163,26 +191,29 @@ bool multiname::toUInt(uint32_t& index, bool acceptStringFractions) const
 				return false;
 			index=0;
 			uint64_t parsed = 0;
-			for(auto i=str.begin(); i!=str.end(); ++i)
+			//Indexes are plain ASCII digits, so the bytes can be checked directly
+			const char* cur=str.raw_buf();
+			const char* const end=cur+str.numBytes();
+			for(; cur!=end; ++cur)
 			{
-				if (*i == '.' && acceptStringFractions)
+				if (*cur == '.' && acceptStringFractions)
 				{
-					if (i==str.begin())
+					if (cur==str.raw_buf())
 						return false;
 					
 					// Accept fractional part if it
 					// is all zeros, e.g. "2.00"
-					++i;
-					for (; i!=str.end(); ++i)
-						if (*i != '0')
+					++cur;
+					for (; cur!=end; ++cur)
+						if (*cur != '0')
 							return false;
 					break;
 				}
-				else if(!i.isdigit())
+				else if(*cur < '0' || *cur > '9')
 					return false;
 
 				parsed*=10;
-				parsed+=i.digit_value();
+				parsed+=*cur-'0';
 				if (parsed > UINT32_MAX)
 					break;
 			}
@@ -796,19 +827,25 @@ std::istream& lightspark::operator>>(std::istream& s, FILLSTYLE& v)
 					LOG(LOG_ERROR,"Invalid bitmap ID " << bitmapId);
 					throw ParseException("Invalid ID for bitmap");
 				}
-				v.bitmap = b->getBitmap();
+				//Do not wait for the bitmap here, it would be decoded on the
+				//parse thread. The shape waits for it when it is instanced
+				b->requestDecoding();
+				v.bitmap = b->getBitmapNoWait();
+				v.bitmapTag = b;
 			}
 			catch(RunTimeException& e)
 			{
 				//Thrown if the bitmapId does not exists in dictionary
 				LOG(LOG_ERROR,"Exception in FillStyle parsing: " << e.what());
 				v.bitmap.reset();
+				v.bitmapTag = NULL;
 			}
 		}
 		else
 		{
 			//The bitmap might be invalid, the style should not be used
 			v.bitmap.reset();
+			v.bitmapTag = NULL;
 		}
 	}
 	else
@@ -930,7 +967,7 @@ SHAPERECORD::SHAPERECORD(SHAPE* p,BitStream& bs):parent(p),MoveBits(0),MoveDelta
 			SHAPEWITHSTYLE* ps=dynamic_cast<SHAPEWITHSTYLE*>(parent);
 			if(ps==NULL)
 				throw ParseException("Malformed SWF file");
-			bs.pos=0;
+			bs.align();
 			FILLSTYLEARRAY a(ps->FillStyles.version);
 			bs.f >> a;
 			p->fillOffset=ps->FillStyles.FillStyles.size();
@@ -1393,12 +1430,12 @@ QName::operator multiname() const
 	return ret;
 }
 
-FILLSTYLE::FILLSTYLE(uint8_t v):Gradient(v),version(v)
+FILLSTYLE::FILLSTYLE(uint8_t v):Gradient(v),bitmapTag(NULL),version(v)
 {
 }
 
 FILLSTYLE::FILLSTYLE(const FILLSTYLE& r):Matrix(r.Matrix),Gradient(r.Gradient),FocalGradient(r.FocalGradient),
-	bitmap(r.bitmap),Color(r.Color),FillStyleType(r.FillStyleType),version(r.version)
+	bitmap(r.bitmap),bitmapTag(r.bitmapTag),Color(r.Color),FillStyleType(r.FillStyleType),version(r.version)
 {
 }
 
@@ -1412,6 +1449,7 @@ FILLSTYLE& FILLSTYLE::operator=(FILLSTYLE r)
 	std::swap(Gradient, r.Gradient);
 	std::swap(FocalGradient, r.FocalGradient);
 	std::swap(bitmap, r.bitmap);
+	std::swap(bitmapTag, r.bitmapTag);
 	std::swap(Color, r.Color);
 	std::swap(FillStyleType, r.FillStyleType);
 	std::swap(version, r.version);
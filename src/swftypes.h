@@ -84,6 +84,7 @@ typedef double number_t;
 class ASObject;
 class ABCContext;
 class namespace_info;
+class BitmapTag;
 
 struct multiname;
 class QName
@@ -361,6 +362,8 @@ struct multiname: public memory_reporter
 	enum NAME_TYPE {NAME_STRING,NAME_INT,NAME_NUMBER,NAME_OBJECT};
 	NAME_TYPE name_type;
 	bool isAttribute;
+	/* true for the multinames of an ABCContext that never change their value */
+	bool isStatic;
 	multiname(MemoryAccount* m);
 	/*
 		Returns a string name whatever is the name type
@@ -373,6 +376,8 @@ struct multiname: public memory_reporter
 	tiny_string qualifiedString() const;
 	/* sets name_type, name_s/name_d based on the object n */
 	void setName(ASObject* n);
+	/* sets name_i if d is an integer in the int32 range, name_d otherwise */
+	void setName(number_t d);
 	void resetNameIfObject();
 	bool isQName() const { return ns.size() == 1; }
 	bool toUInt(uint32_t& out, bool acceptStringFractions=false) const;
@@ -642,32 +647,58 @@ class BitStream
 {
 public:
 	std::istream& f;
-	unsigned char buffer;
-	unsigned char pos;
+private:
+	// Bits fetched from the stream and not consumed yet are the low
+	// 'pos' bits of 'buffer'. Whole bytes are pulled straight from the
+	// streambuf, never more than needed, so the stream is left just
+	// after the last byte a field touched.
+	uint64_t buffer;
+	unsigned int pos;
+	void fill(unsigned int num)
+	{
+		std::streambuf* sb=f.rdbuf();
+		while(pos<num)
+		{
+			int c=sb->sbumpc();
+			if(c==EOF)
+			{
+				// Throws if the stream has exceptions enabled
+				f.setstate(std::ios_base::eofbit|std::ios_base::failbit);
+				c=0;
+			}
+			buffer=(buffer<<8)|(uint8_t)c;
+			pos+=8;
+		}
+	}
 public:
 	BitStream(std::istream& in):f(in),buffer(0),pos(0){};
 	unsigned int readBits(unsigned int num)
 	{
-		unsigned int ret=0;
-		while(num)
+		if(num>32)
 		{
-			if(!pos)
-			{
-				pos=8;
-				f.read((char*)&buffer,1);
-			}
-			ret<<=1;
-			ret|=(buffer>>(pos-1))&1;
-			pos--;
-			num--;
+			// Only the last 32 bits fit in the result
+			discard(num-32);
+			num=32;
 		}
-		return ret;
+		fill(num);
+		pos-=num;
+		return (buffer>>pos)&(((uint64_t)1<<num)-1);
 	}
 	// discards 'num' bits (padding)
 	void discard(unsigned int num)
 	{
+		while(num>32)
+		{
+			readBits(32);
+			num-=32;
+		}
 		readBits(num);
 	}
+	// discards the rest of the current byte
+	void align()
+	{
+		pos=0;
+	}
 };
 
 class FB
@@ -681,11 +712,8 @@ public:
 		if(s>32)
 			LOG(LOG_ERROR,_("Fixed point bit field wider than 32 bit not supported"));
 		buf=stream.readBits(s);
-		if(buf>>(s-1)&1)
-		{
-			for(int i=31;i>=s;i--)
-				buf|=(1<<i);
-		}
+		if(s>0 && s<32 && (buf>>(s-1)&1))
+			buf|=(int32_t)(0xffffffffu<<s);
 	}
 	operator float() const
 	{
@@ -708,6 +736,7 @@ class UB
 	uint32_t buf;
 public:
 	UB():buf(0) {}
+	explicit UB(uint32_t v):buf(v) {}
 	UB(int s,BitStream& stream)
 	{
 /*		if(s%8)
@@ -741,11 +770,8 @@ public:
 		if(s>32)
 			LOG(LOG_ERROR,_("Signed bit field wider than 32 bit not supported"));
 		buf=stream.readBits(s);
-		if(buf>>(s-1)&1)
-		{
-			for(int i=31;i>=s;i--)
-				buf|=(1<<i);
-		}
+		if(s>0 && s<32 && (buf>>(s-1)&1))
+			buf|=(int32_t)(0xffffffffu<<s);
 	}
 	operator int() const
 	{
@@ -892,6 +918,9 @@ public:
 	GRADIENT Gradient;
 	FOCALGRADIENT FocalGradient;
 	_NR<BitmapContainer> bitmap;
+	//The tag of a bitmap fill, bitmap may still be decoding until
+	//bitmapTag->waitDecoded() returns
+	const BitmapTag* bitmapTag;
 	RGBA Color;
 	FILL_STYLE_TYPE FillStyleType;
 	uint8_t version;
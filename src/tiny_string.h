@@ -24,6 +24,7 @@
 #include <cstdint>
 #include <ostream>
 #include <list>
+#include <functional>
 /* for utf8 handling */
 #include <glib.h>
 #include "compat.h"
@@ -188,4 +189,25 @@ public:
 };
 
 };
+
+namespace std
+{
+/* FNV-1a hash of the bytes, to use tiny_string as key of hash based containers */
+template<>
+struct hash<lightspark::tiny_string>
+{
+	size_t operator()(const lightspark::tiny_string& s) const
+	{
+		const unsigned char* p=reinterpret_cast<const unsigned char*>(s.raw_buf());
+		const uint32_t len=s.numBytes();
+		uint32_t h=2166136261u;
+		for(uint32_t i=0;i<len;i++)
+		{
+			h^=p[i];
+			h*=16777619u;
+		}
+		return h;
+	}
+};
+}
 #endif /* TINY_STRING_H */
@@ -0,0 +1,16 @@
+package
+{
+
+// Overrides a builtin method that the optimizer binds natively,
+// calls through an Array typed reference must still reach it
+public dynamic class NativeCallArray extends Array
+{
+	public var pushed:int = 0;
+	override AS3 function push(...args):uint
+	{
+		pushed+=args.length;
+		return 42;
+	}
+}
+
+}
@@ -0,0 +1,10 @@
+package
+{
+
+// Inherits the builtin methods unchanged, but is not of the class
+// seen by the optimizer
+public dynamic class NativeCallPlainArray extends Array
+{
+}
+
+}
@@ -0,0 +1,30 @@
+package
+{
+import flash.utils.IExternalizable;
+import flash.utils.IDataOutput;
+import flash.utils.IDataInput;
+public class NestedExternalizableClass implements IExternalizable
+{
+	public var name:String;
+	public var payload:Object;
+	public var tail:int;
+	function NestedExternalizableClass(n:String = null, p:Object = null, t:int = 0)
+	{
+		name=n;
+		payload=p;
+		tail=t;
+	}
+	public function writeExternal(output:IDataOutput):void
+	{
+		output.writeUTF(name);
+		output.writeObject(payload);
+		output.writeInt(tail);
+	}
+	public function readExternal(input:IDataInput):void
+	{
+		name=input.readUTF();
+		payload=input.readObject();
+		tail=input.readInt();
+	}
+}
+}